@@ -47,6 +47,7 @@ u32 gWindowTileAutoAllocEnabled;
 static const struct BgConfig sZeroedBgControlStruct = { 0 };
 
 static u32 GetBgType(u8 bg);
+static u8 LoadBgVramWithPriority(u8 bg, const void *src, u16 size, u16 destOffset, u8 mode, u8 priority);
 
 void ResetBgs(void)
 {
@@ -170,7 +171,14 @@ static u16 GetBgControlAttribute(u8 bg, u8 attributeId)
     return 0xFF;
 }
 
+// Tilemaps are copied before tiles, since a tilemap that's late leaves the
+// screen wrong for longer than late tiles do.
 u8 LoadBgVram(u8 bg, const void *src, u16 size, u16 destOffset, u8 mode)
+{
+    return LoadBgVramWithPriority(bg, src, size, destOffset, mode, mode == DISPCNT_MODE_2 ? DMA3_PRIORITY_HIGH : DMA3_PRIORITY_BULK);
+}
+
+static u8 LoadBgVramWithPriority(u8 bg, const void *src, u16 size, u16 destOffset, u8 mode, u8 priority)
 {
     u16 offset;
     s8 cursor;
@@ -183,14 +191,14 @@ u8 LoadBgVram(u8 bg, const void *src, u16 size, u16 destOffset, u8 mode)
     case 0x1:
         offset = sGpuBgConfigs.configs[bg].charBaseIndex * BG_CHAR_SIZE;
         offset = destOffset + offset;
-        cursor = RequestDma3Copy(src, (void *)(offset + BG_VRAM), size, 0);
+        cursor = RequestDma3CopyWithPriority(src, (void *)(offset + BG_VRAM), size, 0, priority);
         if (cursor == -1)
             return -1;
         break;
     case 0x2:
         offset = sGpuBgConfigs.configs[bg].mapBaseIndex * BG_SCREEN_SIZE;
         offset = destOffset + offset;
-        cursor = RequestDma3Copy(src, (void *)(offset + BG_VRAM), size, 0);
+        cursor = RequestDma3CopyWithPriority(src, (void *)(offset + BG_VRAM), size, 0, priority);
         if (cursor == -1)
             return -1;
         break;
@@ -373,6 +381,11 @@ void SetBgMode(u8 bgMode)
 }
 
 u16 LoadBgTiles(u8 bg, const void *src, u16 size, u16 destOffset)
+{
+    return LoadBgTilesWithPriority(bg, src, size, destOffset, DMA3_PRIORITY_BULK);
+}
+
+u16 LoadBgTilesWithPriority(u8 bg, const void *src, u16 size, u16 destOffset, u8 priority)
 {
     u16 tileOffset;
     u8 cursor;
@@ -386,7 +399,7 @@ u16 LoadBgTiles(u8 bg, const void *src, u16 size, u16 destOffset)
         tileOffset = (sGpuBgConfigs2[bg].baseTile + destOffset) * 0x40;
     }
 
-    cursor = LoadBgVram(bg, src, size, tileOffset, DISPCNT_MODE_1);
+    cursor = LoadBgVramWithPriority(bg, src, size, tileOffset, DISPCNT_MODE_1, priority);
 
     if (cursor == 0xFF)
     {
@@ -63,6 +63,7 @@ void InitBgsFromTemplates(u8 bgMode, const struct BgTemplate *templates, u8 numT
 void InitBgFromTemplate(const struct BgTemplate *template);
 void SetBgMode(u8 bgMode);
 u16 LoadBgTiles(u8 bg, const void *src, u16 size, u16 destOffset);
+u16 LoadBgTilesWithPriority(u8 bg, const void *src, u16 size, u16 destOffset, u8 priority);
 u16 LoadBgTilemap(u8 bg, const void *src, u16 size, u16 destOffset);
 u16 Unused_LoadBgPalette(u8 bg, const void *src, u16 size, u16 destOffset);
 bool8 IsDma3ManagerBusyWithBgCopy(void);
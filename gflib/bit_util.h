@@ -0,0 +1,29 @@
+#ifndef GUARD_BIT_UTIL_H
+#define GUARD_BIT_UTIL_H
+
+// Bit scans for code that searches bitmaps. The CPU has no instruction for
+// them, so they multiply by a De Bruijn sequence and look the index up.
+
+extern const u8 gLowestBitIndices[32];
+extern const u8 gHighestBitIndices[32];
+
+// Returns the index of the lowest set bit of a nonzero value.
+static inline u32 GetLowestBitIndex(u32 value)
+{
+    return gLowestBitIndices[((value & -value) * 0x077CB531) >> 27];
+}
+
+// Returns the index of the highest set bit of a nonzero value.
+static inline u32 GetHighestBitIndex(u32 value)
+{
+    // Set every bit below the highest one.
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+
+    return gHighestBitIndices[(value * 0x07C4ACDD) >> 27];
+}
+
+#endif // GUARD_BIT_UTIL_H
@@ -46,10 +46,31 @@
 #define Dma3FillLarge16_(value, dest, size) Dma3FillLarge_(value, dest, size, 16)
 #define Dma3FillLarge32_(value, dest, size) Dma3FillLarge_(value, dest, size, 32)
 
+// Priority classes for DMA requests. ProcessDma3Requests does the requests
+// of one class before starting on the next.
+#define DMA3_PRIORITY_HIGH   0 // Palettes and tilemaps, which show up wrong if they're late.
+#define DMA3_PRIORITY_WINDOW 1 // Window graphics, like text being printed.
+#define DMA3_PRIORITY_BULK   2 // Everything else, like tilesets and sprite graphics.
+#define DMA3_PRIORITY_COUNT  3
+
+struct Dma3Stats
+{
+    u32 totalBytes; // Bytes transferred since ResetDma3Stats.
+    u32 deferredRequests; // Requests left waiting at the end of a VBlank, counted again for every VBlank they wait.
+    u32 mergedRequests; // Requests that were added onto the end of the request before them.
+    u16 lastVBlankBytes; // Bytes transferred in the last VBlank.
+    u16 peakVBlankBytes; // Most bytes transferred in one VBlank since ResetDma3Stats.
+    u8 numQueuedRequests; // Requests waiting right now.
+};
+
 void ClearDma3Requests(void);
 void ProcessDma3Requests(void);
 s16 RequestDma3Copy(const void *src, void *dest, u16 size, u8 mode);
+s16 RequestDma3CopyWithPriority(const void *src, void *dest, u16 size, u8 mode, u8 priority);
 s16 RequestDma3Fill(s32 value, void *dest, u16 size, u8 mode);
+s16 RequestDma3FillWithPriority(s32 value, void *dest, u16 size, u8 mode, u8 priority);
 s16 CheckForSpaceForDma3Request(s16 index);
+void GetDma3Stats(struct Dma3Stats *stats);
+void ResetDma3Stats(void);
 
 #endif // GUARD_DMA3_H
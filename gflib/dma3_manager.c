@@ -3,24 +3,53 @@
 
 #define MAX_DMA_REQUESTS 128
 
+// Don't transfer more than this in one VBlank.
+#define MAX_DMA_BYTES_PER_VBLANK (40 * 1024)
+
 #define DMA_REQUEST_COPY32 1
 #define DMA_REQUEST_FILL32 2
 #define DMA_REQUEST_COPY16 3
 #define DMA_REQUEST_FILL16 4
 
+#define NO_DMA_REQUEST 0xFF
+
+#define IS_DMA_REQUEST_COPY(mode) ((mode) == DMA_REQUEST_COPY32 || (mode) == DMA_REQUEST_COPY16)
+#define IS_DMA_REQUEST_32BIT(mode) ((mode) == DMA_REQUEST_COPY32 || (mode) == DMA_REQUEST_FILL32)
+
 struct Dma3Request
 {
     const u8 *src;
     u8 *dest;
-    u16 size;
-    u16 mode;
+    u16 size; // What's left to transfer. 0 if the request is free.
+    u8 mode;
+    u8 next; // The request after this one in its queue.
     u32 value;
 };
 
 static struct Dma3Request sDma3Requests[MAX_DMA_REQUESTS];
 
+// A queue of requests for each priority class, linked through their next
+// fields. Each queue is processed in order, and a queue is only processed
+// when the ones before it are empty.
+static u8 sDma3QueueHeads[DMA3_PRIORITY_COUNT];
+static u8 sDma3QueueTails[DMA3_PRIORITY_COUNT];
+
 static vbool8 sDma3ManagerLocked;
-static u8 sDma3RequestCursor;
+static u8 sDma3RequestCursor; // Where to start looking for a free request.
+static u8 sNumQueuedDma3Requests;
+static struct Dma3Stats sDma3Stats;
+
+static void ResetDma3Queues(void)
+{
+    int i;
+
+    for (i = 0; i < DMA3_PRIORITY_COUNT; i++)
+    {
+        sDma3QueueHeads[i] = NO_DMA_REQUEST;
+        sDma3QueueTails[i] = NO_DMA_REQUEST;
+    }
+    sNumQueuedDma3Requests = 0;
+}
 
 void ClearDma3Requests(void)
 {
@@ -35,119 +64,199 @@ void ClearDma3Requests(void)
         sDma3Requests[i].src = NULL;
         sDma3Requests[i].dest = NULL;
     }
+    ResetDma3Queues();
 
     sDma3ManagerLocked = FALSE;
 }
 
+// Transfers the first size bytes of a request, and moves the request past them.
+static void TransferDma3Block(struct Dma3Request *request, u16 size)
+{
+    switch (request->mode)
+    {
+    case DMA_REQUEST_COPY32: // regular 32-bit copy
+        Dma3CopyLarge32_(request->src, request->dest, size);
+        break;
+    case DMA_REQUEST_FILL32: // repeat a single 32-bit value across RAM
+        Dma3FillLarge32_(request->value, request->dest, size);
+        break;
+    case DMA_REQUEST_COPY16: // regular 16-bit copy
+        Dma3CopyLarge16_(request->src, request->dest, size);
+        break;
+    case DMA_REQUEST_FILL16: // repeat a single 16-bit value across RAM
+        Dma3FillLarge16_(request->value, request->dest, size);
+        break;
+    }
+
+    if (IS_DMA_REQUEST_COPY(request->mode))
+        request->src += size;
+    request->dest += size;
+    request->size -= size;
+}
+
+// Transfers the queued requests, highest priority first. A request that
+// doesn't fit in what's left of this VBlank waits whole for the next one, so
+// it never shows up half-written. Only a request that is too big for any
+// VBlank is split, and it carries on from where it stopped in the next one.
 void ProcessDma3Requests(void)
 {
-    u16 bytesTransferred;
+    u32 bytesLeft;
+    u32 bytesTransferred;
+    int priority;
 
     if (sDma3ManagerLocked)
         return;
 
-    bytesTransferred = 0;
+    bytesLeft = MAX_DMA_BYTES_PER_VBLANK;
 
-    // as long as there are DMA requests to process (unless size or vblank is an issue), do not exit
-    while (sDma3Requests[sDma3RequestCursor].size != 0)
+    for (priority = 0; priority < DMA3_PRIORITY_COUNT; priority++)
     {
-        bytesTransferred += sDma3Requests[sDma3RequestCursor].size;
+        while (sDma3QueueHeads[priority] != NO_DMA_REQUEST)
+        {
+            u8 cursor = sDma3QueueHeads[priority];
+            struct Dma3Request *request = &sDma3Requests[cursor];
+            u32 size = request->size;
 
-        if (bytesTransferred > 40 * 1024)
-            return; // don't transfer more than 40 KiB
-        if (*(u8 *)REG_ADDR_VCOUNT > 224)
-            return; // we're about to leave vblank, stop
+            if (*(u8 *)REG_ADDR_VCOUNT > 224)
+                goto done; // we're about to leave vblank, stop
 
-        switch (sDma3Requests[sDma3RequestCursor].mode)
-        {
-        case DMA_REQUEST_COPY32: // regular 32-bit copy
-            Dma3CopyLarge32_(sDma3Requests[sDma3RequestCursor].src,
-                             sDma3Requests[sDma3RequestCursor].dest,
-                             sDma3Requests[sDma3RequestCursor].size);
-            break;
-        case DMA_REQUEST_FILL32: // repeat a single 32-bit value across RAM
-            Dma3FillLarge32_(sDma3Requests[sDma3RequestCursor].value,
-                             sDma3Requests[sDma3RequestCursor].dest,
-                             sDma3Requests[sDma3RequestCursor].size);
-            break;
-        case DMA_REQUEST_COPY16:    // regular 16-bit copy
-            Dma3CopyLarge16_(sDma3Requests[sDma3RequestCursor].src,
-                             sDma3Requests[sDma3RequestCursor].dest,
-                             sDma3Requests[sDma3RequestCursor].size);
-            break;
-        case DMA_REQUEST_FILL16: // repeat a single 16-bit value across RAM
-            Dma3FillLarge16_(sDma3Requests[sDma3RequestCursor].value,
-                             sDma3Requests[sDma3RequestCursor].dest,
-                             sDma3Requests[sDma3RequestCursor].size);
-            break;
-        }
+            if (size > bytesLeft)
+            {
+                if (size <= MAX_DMA_BYTES_PER_VBLANK)
+                    goto done; // wait for the next VBlank
+                size = bytesLeft & (IS_DMA_REQUEST_32BIT(request->mode) ? ~3 : ~1);
+                if (size == 0)
+                    goto done;
+            }
 
-        // Free the request
-        sDma3Requests[sDma3RequestCursor].src = NULL;
-        sDma3Requests[sDma3RequestCursor].dest = NULL;
-        sDma3Requests[sDma3RequestCursor].size = 0;
-        sDma3Requests[sDma3RequestCursor].mode = 0;
-        sDma3Requests[sDma3RequestCursor].value = 0;
-        sDma3RequestCursor++;
+            TransferDma3Block(request, size);
+            bytesLeft -= size;
 
-        if (sDma3RequestCursor >= MAX_DMA_REQUESTS) // loop back to the first DMA request
-            sDma3RequestCursor = 0;
+            if (request->size == 0)
+            {
+                // Free the request
+                sDma3QueueHeads[priority] = request->next;
+                if (request->next == NO_DMA_REQUEST)
+                    sDma3QueueTails[priority] = NO_DMA_REQUEST;
+                request->src = NULL;
+                request->dest = NULL;
+                request->mode = 0;
+                request->value = 0;
+                sNumQueuedDma3Requests--;
+            }
+        }
     }
+
+done:
+    bytesTransferred = MAX_DMA_BYTES_PER_VBLANK - bytesLeft;
+    sDma3Stats.lastVBlankBytes = bytesTransferred;
+    if (bytesTransferred > sDma3Stats.peakVBlankBytes)
+        sDma3Stats.peakVBlankBytes = bytesTransferred;
+    sDma3Stats.totalBytes += bytesTransferred;
+    sDma3Stats.deferredRequests += sNumQueuedDma3Requests;
 }
 
-s16 RequestDma3Copy(const void *src, void *dest, u16 size, u8 mode)
+static bool32 DoRangesOverlap(const u8 *a, u32 aSize, const u8 *b, u32 bSize)
 {
-    int cursor;
-    int i = 0;
+    return a < b + bSize && b < a + aSize;
+}
 
-    sDma3ManagerLocked = TRUE;
-    cursor = sDma3RequestCursor;
+// Returns whether a new request has to wait for a queued one, because one of
+// them writes memory the other reads or writes.
+static bool32 DoesDma3RequestConflict(struct Dma3Request *request, const u8 *src, u8 *dest, u16 size, u8 mode)
+{
+    if (DoRangesOverlap(dest, size, request->dest, request->size))
+        return TRUE;
+    if (IS_DMA_REQUEST_COPY(request->mode) && DoRangesOverlap(dest, size, request->src, request->size))
+        return TRUE;
+    if (IS_DMA_REQUEST_COPY(mode) && DoRangesOverlap(src, size, request->dest, request->size))
+        return TRUE;
+    return FALSE;
+}
 
-    while (i < MAX_DMA_REQUESTS)
+// Requests are queued by priority, unless that would let them overtake an
+// earlier request they conflict with. Then they're queued behind it.
+static u8 GetDma3RequestQueue(const u8 *src, u8 *dest, u16 size, u8 mode, u8 priority)
+{
+    int queue;
+    u8 cursor;
+
+    for (queue = DMA3_PRIORITY_COUNT - 1; queue > priority; queue--)
     {
-        if (sDma3Requests[cursor].size == 0) // an empty request was found.
+        for (cursor = sDma3QueueHeads[queue]; cursor != NO_DMA_REQUEST; cursor = sDma3Requests[cursor].next)
         {
-            sDma3Requests[cursor].src = src;
-            sDma3Requests[cursor].dest = dest;
-            sDma3Requests[cursor].size = size;
-
-            if (mode == 1)
-                sDma3Requests[cursor].mode = DMA_REQUEST_COPY32;
-            else
-                sDma3Requests[cursor].mode = DMA_REQUEST_COPY16;
-
-            sDma3ManagerLocked = FALSE;
-            return cursor;
+            if (DoesDma3RequestConflict(&sDma3Requests[cursor], src, dest, size, mode))
+                return queue;
         }
-        if (++cursor >= MAX_DMA_REQUESTS) // loop back to start.
-            cursor = 0;
-        i++;
     }
-    sDma3ManagerLocked = FALSE;
-    return -1;  // no free DMA request was found
+
+    return priority;
 }
 
-s16 RequestDma3Fill(s32 value, void *dest, u16 size, u8 mode)
+// Returns whether a new request carries on right where a queued one ends, so
+// they can be done as one transfer. The merged request must still fit in one
+// VBlank, or ProcessDma3Requests would split it.
+static bool32 CanMergeDma3Requests(struct Dma3Request *request, const u8 *src, u8 *dest, u16 size, u8 mode, u32 value)
+{
+    if (request->mode != mode || request->dest + request->size != dest)
+        return FALSE;
+    if (request->size + size > MAX_DMA_BYTES_PER_VBLANK)
+        return FALSE;
+    if (IS_DMA_REQUEST_COPY(mode))
+        return request->src + request->size == src;
+    else
+        return request->value == value;
+}
+
+static s16 AddDma3Request(const u8 *src, u8 *dest, u16 size, u8 mode, u32 value, u8 priority)
 {
     int cursor;
     int i = 0;
+    u8 queue = priority;
+    u8 tail;
 
-    cursor = sDma3RequestCursor;
     sDma3ManagerLocked = TRUE;
 
+    if (size != 0)
+    {
+        queue = GetDma3RequestQueue(src, dest, size, mode, priority);
+        tail = sDma3QueueTails[queue];
+        if (tail != NO_DMA_REQUEST && CanMergeDma3Requests(&sDma3Requests[tail], src, dest, size, mode, value))
+        {
+            // The merged request finishes when this one would have.
+            sDma3Requests[tail].size += size;
+            sDma3Stats.mergedRequests++;
+            sDma3ManagerLocked = FALSE;
+            return tail;
+        }
+    }
+
+    cursor = sDma3RequestCursor;
+
     while (i < MAX_DMA_REQUESTS)
     {
         if (sDma3Requests[cursor].size == 0) // an empty request was found.
         {
-            sDma3Requests[cursor].dest = dest;
-            sDma3Requests[cursor].size = size;
-            sDma3Requests[cursor].mode = mode;
-            sDma3Requests[cursor].value = value;
+            sDma3RequestCursor = cursor + 1;
+            if (sDma3RequestCursor >= MAX_DMA_REQUESTS)
+                sDma3RequestCursor = 0;
+
+            if (size != 0)
+            {
+                sDma3Requests[cursor].src = src;
+                sDma3Requests[cursor].dest = dest;
+                sDma3Requests[cursor].size = size;
+                sDma3Requests[cursor].mode = mode;
+                sDma3Requests[cursor].value = value;
+                sDma3Requests[cursor].next = NO_DMA_REQUEST;
 
-            if(mode == 1)
-                sDma3Requests[cursor].mode = DMA_REQUEST_FILL32;
-            else
-                sDma3Requests[cursor].mode = DMA_REQUEST_FILL16;
+                if (sDma3QueueTails[queue] == NO_DMA_REQUEST)
+                    sDma3QueueHeads[queue] = cursor;
+                else
+                    sDma3Requests[sDma3QueueTails[queue]].next = cursor;
+                sDma3QueueTails[queue] = cursor;
+                sNumQueuedDma3Requests++;
+            }
 
             sDma3ManagerLocked = FALSE;
             return cursor;
@@ -160,6 +269,34 @@ s16 RequestDma3Fill(s32 value, void *dest, u16 size, u8 mode)
     return -1;  // no free DMA request was found
 }
 
+// Palettes are needed right away, everything else can wait behind them.
+static u8 GetDefaultDma3Priority(void *dest)
+{
+    if ((u32)dest >= PLTT && (u32)dest < PLTT + PLTT_SIZE)
+        return DMA3_PRIORITY_HIGH;
+    return DMA3_PRIORITY_BULK;
+}
+
+s16 RequestDma3Copy(const void *src, void *dest, u16 size, u8 mode)
+{
+    return RequestDma3CopyWithPriority(src, dest, size, mode, GetDefaultDma3Priority(dest));
+}
+
+s16 RequestDma3CopyWithPriority(const void *src, void *dest, u16 size, u8 mode, u8 priority)
+{
+    return AddDma3Request(src, dest, size, mode == 1 ? DMA_REQUEST_COPY32 : DMA_REQUEST_COPY16, 0, priority);
+}
+
+s16 RequestDma3Fill(s32 value, void *dest, u16 size, u8 mode)
+{
+    return RequestDma3FillWithPriority(value, dest, size, mode, GetDefaultDma3Priority(dest));
+}
+
+s16 RequestDma3FillWithPriority(s32 value, void *dest, u16 size, u8 mode, u8 priority)
+{
+    return AddDma3Request(NULL, dest, size, mode == 1 ? DMA_REQUEST_FILL32 : DMA_REQUEST_FILL16, value, priority);
+}
+
 s16 CheckForSpaceForDma3Request(s16 index)
 {
     int i = 0;
@@ -181,3 +318,14 @@ s16 CheckForSpaceForDma3Request(s16 index)
         return 0;
     }
 }
+
+void GetDma3Stats(struct Dma3Stats *stats)
+{
+    *stats = sDma3Stats;
+    stats->numQueuedRequests = sNumQueuedDma3Requests;
+}
+
+void ResetDma3Stats(void)
+{
+    CpuFill32(0, &sDma3Stats, sizeof(sDma3Stats));
+}
@@ -1,10 +1,23 @@
 #include "global.h"
+#include "malloc.h"
+#include "bit_util.h"
 
 static void *sHeapStart;
 static u32 sHeapSize;
 
 #define MALLOC_SYSTEM_ID 0xA3A3
 
+// Block sizes are multiples of 8. Free blocks smaller than 128 bytes are kept
+// in one list per size, and bigger ones in one list per power of 2. Every
+// block in a small list fits equally well, so those are stacks, and freeing
+// or allocating a small block takes constant time. The big lists are sorted
+// by address, so an allocation takes the first block that fits in the
+// smallest list that has one. That keeps fragmentation about as low as a
+// first fit search through the whole heap.
+#define NUM_SMALL_FREE_LISTS 16
+#define SMALL_FREE_LIST_SHIFT 3
+#define NUM_FREE_LISTS 32
+
 struct MemBlock {
     // Whether this block is currently allocated.
     bool16 flag;
@@ -25,6 +38,134 @@ struct MemBlock {
     u8 data[0];
 };
 
+// Free blocks keep their free list links at the end of their data, so every
+// block has to be big enough to hold them. The end is used because some code
+// still reads the start of a block after freeing it (see struct Sprite). A
+// block freed in front of a free block, as the last one allocated usually is,
+// keeps all of its data until it's allocated again.
+struct FreeListLinks {
+    struct MemBlock *prev;
+    struct MemBlock *next;
+};
+
+#define FREE_LIST_LINKS(block) ((struct FreeListLinks *)((block)->data + (block)->size - sizeof(struct FreeListLinks)))
+#define MIN_BLOCK_SIZE sizeof(struct FreeListLinks)
+
+static struct MemBlock *sFreeLists[NUM_FREE_LISTS];
+static u32 sNonEmptyFreeLists; // Bit n is set if sFreeLists[n] has a block.
+static u32 sUsedSize;
+static u32 sPeakUsedSize;
+
+static u32 GetFreeListIndex(u32 size)
+{
+    u32 index;
+
+    if (size < (NUM_SMALL_FREE_LISTS << SMALL_FREE_LIST_SHIFT))
+        return size >> SMALL_FREE_LIST_SHIFT;
+
+    // The first big list starts at 1 << (SMALL_FREE_LIST_SHIFT + 4).
+    index = NUM_SMALL_FREE_LISTS + GetHighestBitIndex(size) - (SMALL_FREE_LIST_SHIFT + 4);
+    if (index >= NUM_FREE_LISTS)
+        index = NUM_FREE_LISTS - 1;
+
+    return index;
+}
+
+// Whether blocks of the two sizes belong in the same free list, without
+// working out which one. The big lists hold one power of 2 each, so sizes
+// share a list when their highest set bits are the same. Sizes past the last
+// list are counted as different, which only costs a needless move.
+static bool32 AreInSameFreeList(u32 size1, u32 size2)
+{
+    if (size1 < (NUM_SMALL_FREE_LISTS << SMALL_FREE_LIST_SHIFT) || size2 < (NUM_SMALL_FREE_LISTS << SMALL_FREE_LIST_SHIFT))
+        return (size1 >> SMALL_FREE_LIST_SHIFT) == (size2 >> SMALL_FREE_LIST_SHIFT);
+
+    return (size1 ^ size2) < (size1 & size2);
+}
+
+static void AddToFreeList(struct MemBlock *block)
+{
+    u32 index = GetFreeListIndex(block->size);
+    struct FreeListLinks *links = FREE_LIST_LINKS(block);
+    struct MemBlock *prev = NULL;
+    struct MemBlock *next = sFreeLists[index];
+
+    if (index >= NUM_SMALL_FREE_LISTS) {
+        while (next != NULL && next < block) {
+            prev = next;
+            next = FREE_LIST_LINKS(next)->next;
+        }
+    }
+
+    links->prev = prev;
+    links->next = next;
+    if (next != NULL)
+        FREE_LIST_LINKS(next)->prev = block;
+
+    if (prev != NULL)
+        FREE_LIST_LINKS(prev)->next = block;
+    else
+        sFreeLists[index] = block;
+
+    sNonEmptyFreeLists |= 1u << index;
+}
+
+static void RemoveFromFreeList(struct MemBlock *block)
+{
+    u32 index = GetFreeListIndex(block->size);
+    struct FreeListLinks *links = FREE_LIST_LINKS(block);
+
+    if (links->prev != NULL)
+        FREE_LIST_LINKS(links->prev)->next = links->next;
+    else
+        sFreeLists[index] = links->next;
+
+    if (links->next != NULL)
+        FREE_LIST_LINKS(links->next)->prev = links->prev;
+
+    if (sFreeLists[index] == NULL)
+        sNonEmptyFreeLists &= ~(1u << index);
+}
+
+// Gives block the free list place of a free block that ends at the same
+// address, and so has its links in the same place. The two have to belong in
+// the same list, and no other free block can lie between them.
+static void ReplaceInFreeList(struct MemBlock *block)
+{
+    struct FreeListLinks *links = FREE_LIST_LINKS(block);
+
+    if (links->prev != NULL)
+        FREE_LIST_LINKS(links->prev)->next = block;
+    else
+        sFreeLists[GetFreeListIndex(block->size)] = block;
+
+    if (links->next != NULL)
+        FREE_LIST_LINKS(links->next)->prev = block;
+}
+
+// Finds a free block of at least size bytes. The small lists only hold blocks
+// of one size, so the search through the size's own list only goes past the
+// first block for bigger sizes. Every block in a later list is big enough.
+static struct MemBlock *FindFreeBlock(u32 size)
+{
+    u32 index = GetFreeListIndex(size);
+    u32 biggerLists;
+    struct MemBlock *block;
+
+    block = sFreeLists[index];
+    while (block != NULL && block->size < size)
+        block = FREE_LIST_LINKS(block)->next;
+
+    if (block != NULL)
+        return block;
+
+    biggerLists = sNonEmptyFreeLists & ~((2u << index) - 1);
+    if (biggerLists == 0)
+        return NULL;
+
+    return sFreeLists[GetLowestBitIndex(biggerLists)];
+}
+
 void PutMemBlockHeader(void *block, struct MemBlock *prev, struct MemBlock *next, u32 size)
 {
     struct MemBlock *header = (struct MemBlock *)block;
@@ -43,54 +184,64 @@ void PutFirstMemBlockHeader(void *block, u32 size)
 
 void *AllocInternal(void *heapStart, u32 size)
 {
-    struct MemBlock *pos = (struct MemBlock *)heapStart;
-    struct MemBlock *head = pos;
+    struct MemBlock *head = (struct MemBlock *)heapStart;
+    struct MemBlock *pos;
     struct MemBlock *splitBlock;
     u32 foundBlockSize;
+    bool32 sameFreeList;
 
     // Alignment
-    if (size & 3)
-        size = 4 * ((size / 4) + 1);
+    size = (size + 7) & ~7;
 
-    for (;;) {
-        // Loop through the blocks looking for unused block that's big enough.
+    if (size < MIN_BLOCK_SIZE)
+        size = MIN_BLOCK_SIZE;
 
-        if (!pos->flag) {
-            foundBlockSize = pos->size;
+    pos = FindFreeBlock(size);
+    if (pos == NULL)
+        return NULL;
 
-            if (foundBlockSize >= size) {
-                if (foundBlockSize - size < 2 * sizeof(struct MemBlock)) {
-                    // The block isn't much bigger than the requested size,
-                    // so just use it.
-                    pos->flag = TRUE;
-                } else {
-                    // The block is significantly bigger than the requested
-                    // size, so split the rest into a separate block.
-                    foundBlockSize -= sizeof(struct MemBlock);
-                    foundBlockSize -= size;
+    foundBlockSize = pos->size;
 
-                    splitBlock = (struct MemBlock *)(pos->data + size);
+    if (foundBlockSize - size < 2 * sizeof(struct MemBlock)) {
+        // The block isn't much bigger than the requested size,
+        // so just use it.
+        RemoveFromFreeList(pos);
+        pos->flag = TRUE;
+    } else {
+        // The block is significantly bigger than the requested
+        // size, so split the rest into a separate block.
+        foundBlockSize -= sizeof(struct MemBlock);
+        foundBlockSize -= size;
 
-                    pos->flag = TRUE;
-                    pos->size = size;
+        // The rest ends where the block did, so if it stays in the
+        // same free list it can just take the block's place there.
+        sameFreeList = AreInSameFreeList(foundBlockSize, pos->size);
+        if (!sameFreeList)
+            RemoveFromFreeList(pos);
 
-                    PutMemBlockHeader(splitBlock, pos, pos->next, foundBlockSize);
+        splitBlock = (struct MemBlock *)(pos->data + size);
 
-                    pos->next = splitBlock;
+        pos->flag = TRUE;
+        pos->size = size;
 
-                    if (splitBlock->next != head)
-                        splitBlock->next->prev = splitBlock;
-                }
+        PutMemBlockHeader(splitBlock, pos, pos->next, foundBlockSize);
 
-                return pos->data;
-            }
-        }
+        pos->next = splitBlock;
 
-        if (pos->next == head)
-            return NULL;
+        if (splitBlock->next != head)
+            splitBlock->next->prev = splitBlock;
 
-        pos = pos->next;
+        if (sameFreeList)
+            ReplaceInFreeList(splitBlock);
+        else
+            AddToFreeList(splitBlock);
     }
+
+    sUsedSize += sizeof(struct MemBlock) + pos->size;
+    if (sUsedSize > sPeakUsedSize)
+        sPeakUsedSize = sUsedSize;
+
+    return pos->data;
 }
 
 void FreeInternal(void *heapStart, void *pointer)
@@ -98,12 +249,15 @@ void FreeInternal(void *heapStart, void *pointer)
     if (pointer) {
         struct MemBlock *head = (struct MemBlock *)heapStart;
         struct MemBlock *block = (struct MemBlock *)((u8 *)pointer - sizeof(struct MemBlock));
+        struct MemBlock *mergedNext = NULL;
         block->flag = FALSE;
+        sUsedSize -= sizeof(struct MemBlock) + block->size;
 
         // If the freed block isn't the last one, merge with the next block
         // if it's not in use.
         if (block->next != head) {
             if (!block->next->flag) {
+                mergedNext = block->next;
                 block->size += sizeof(struct MemBlock) + block->next->size;
                 block->next->magic = 0;
                 block->next = block->next->next;
@@ -116,6 +270,7 @@ void FreeInternal(void *heapStart, void *pointer)
         // if it's not in use.
         if (block != head) {
             if (!block->prev->flag) {
+                RemoveFromFreeList(block->prev);
                 block->prev->next = block->next;
 
                 if (block->next != head)
@@ -123,6 +278,21 @@ void FreeInternal(void *heapStart, void *pointer)
 
                 block->magic = 0;
                 block->prev->size += sizeof(struct MemBlock) + block->size;
+                block = block->prev;
+            }
+        }
+
+        // A merged next block is still in its free list. The merged block
+        // ends where it did, so it can take its place if it stays in the
+        // same list.
+        if (mergedNext == NULL) {
+            AddToFreeList(block);
+        } else {
+            if (AreInSameFreeList(block->size, mergedNext->size)) {
+                ReplaceInFreeList(block);
+            } else {
+                RemoveFromFreeList(mergedNext);
+                AddToFreeList(block);
             }
         }
     }
@@ -168,11 +338,42 @@ bool32 CheckMemBlockInternal(void *heapStart, void *pointer)
     return TRUE;
 }
 
+// Checks that a free block is linked into the right free list.
+static bool32 CheckFreeListLinks(struct MemBlock *block)
+{
+    struct FreeListLinks *links = FREE_LIST_LINKS(block);
+
+    if (links->prev == NULL) {
+        if (sFreeLists[GetFreeListIndex(block->size)] != block)
+            return FALSE;
+    } else if (links->prev->magic != MALLOC_SYSTEM_ID || links->prev->flag
+            || FREE_LIST_LINKS(links->prev)->next != block) {
+        return FALSE;
+    }
+
+    if (links->next != NULL) {
+        if (links->next->magic != MALLOC_SYSTEM_ID || links->next->flag
+         || FREE_LIST_LINKS(links->next)->prev != block)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
 void InitHeap(void *heapStart, u32 heapSize)
 {
+    u32 i;
+
     sHeapStart = heapStart;
     sHeapSize = heapSize;
+    for (i = 0; i < NUM_FREE_LISTS; i++)
+        sFreeLists[i] = NULL;
+    sNonEmptyFreeLists = 0;
+    sUsedSize = 0;
+    sPeakUsedSize = 0;
+
     PutFirstMemBlockHeader(heapStart, heapSize);
+    AddToFreeList((struct MemBlock *)heapStart);
 }
 
 void *Alloc(u32 size)
@@ -195,15 +396,104 @@ bool32 CheckMemBlock(void *pointer)
     return CheckMemBlockInternal(sHeapStart, pointer);
 }
 
-bool32 CheckHeap()
+bool32 CheckHeap(void)
 {
     struct MemBlock *pos = (struct MemBlock *)sHeapStart;
 
     do {
         if (!CheckMemBlockInternal(sHeapStart, pos->data))
             return FALSE;
+        if (!pos->flag && !CheckFreeListLinks(pos))
+            return FALSE;
         pos = pos->next;
     } while (pos != (struct MemBlock *)sHeapStart);
 
     return TRUE;
 }
+
+void GetHeapStats(struct HeapStats *stats)
+{
+    struct MemBlock *pos = (struct MemBlock *)sHeapStart;
+    u32 freeSize = 0;
+
+    stats->size = sHeapSize;
+    stats->usedSize = sUsedSize;
+    stats->peakUsedSize = sPeakUsedSize;
+    stats->largestFreeBlock = 0;
+    stats->numAllocatedBlocks = 0;
+    stats->numFreeBlocks = 0;
+
+    do {
+        if (pos->flag) {
+            stats->numAllocatedBlocks++;
+        } else {
+            stats->numFreeBlocks++;
+            freeSize += pos->size;
+            if (pos->size > stats->largestFreeBlock)
+                stats->largestFreeBlock = pos->size;
+        }
+        pos = pos->next;
+    } while (pos != (struct MemBlock *)sHeapStart);
+
+    if (freeSize != 0)
+        stats->fragmentation = 100 - stats->largestFreeBlock * 100 / freeSize;
+    else
+        stats->fragmentation = 0;
+}
+
+void ResetHeapPeakUsage(void)
+{
+    sPeakUsedSize = sUsedSize;
+}
+
+struct Arena {
+    u32 size;
+    u32 used;
+    u8 data[0];
+};
+
+// Returns NULL if the heap has no room for the arena, like Alloc. Allocating
+// from a NULL arena fails too, and ending it does nothing.
+struct Arena *ArenaBegin(u32 size)
+{
+    struct Arena *arena = Alloc(sizeof(struct Arena) + size);
+
+    if (arena != NULL) {
+        arena->size = size;
+        arena->used = 0;
+    }
+
+    return arena;
+}
+
+void *ArenaAlloc(struct Arena *arena, u32 size)
+{
+    void *mem;
+
+    if (arena == NULL)
+        return NULL;
+
+    size = ARENA_ALLOC_SIZE(size);
+    AGB_WARNING(size <= arena->size - arena->used);
+    if (size > arena->size - arena->used)
+        return NULL;
+
+    mem = arena->data + arena->used;
+    arena->used += size;
+    return mem;
+}
+
+void *ArenaAllocZeroed(struct Arena *arena, u32 size)
+{
+    void *mem = ArenaAlloc(arena, size);
+
+    if (mem != NULL)
+        CpuFill32(0, mem, ARENA_ALLOC_SIZE(size));
+
+    return mem;
+}
+
+void ArenaEnd(struct Arena *arena)
+{
+    Free(arena);
+}
@@ -11,11 +11,45 @@
 
 #define TRY_FREE_AND_SET_NULL(ptr) if (ptr != NULL) FREE_AND_SET_NULL(ptr)
 
+// How much of an arena an allocation of size bytes takes.
+#define ARENA_ALLOC_SIZE(size) (((size) + 3) & ~3)
+
+#define ARENA_END_AND_SET_NULL(arena)   \
+{                                       \
+    ArenaEnd(arena);                    \
+    arena = NULL;                       \
+}
+
+struct HeapStats
+{
+    u32 size;
+    u32 usedSize; // Allocated blocks, including their headers.
+    u32 peakUsedSize; // Highest usedSize since InitHeap or ResetHeapPeakUsage.
+    u32 largestFreeBlock; // The biggest size Alloc can currently return.
+    u16 numAllocatedBlocks;
+    u16 numFreeBlocks;
+    u8 fragmentation; // Percentage of free memory outside the largest free block.
+};
+
 extern u8 gHeap[];
 
 void *Alloc(u32 size);
 void *AllocZeroed(u32 size);
 void Free(void *pointer);
 void InitHeap(void *pointer, u32 size);
+bool32 CheckHeap(void);
+void GetHeapStats(struct HeapStats *stats);
+void ResetHeapPeakUsage(void);
+
+// An arena hands out memory from a single heap block, for buffers that are
+// allocated together and freed together, like the ones a screen uses while
+// it's open. ArenaEnd frees them all at once. The arena's size has to cover
+// the ARENA_ALLOC_SIZE of everything allocated from it.
+struct Arena;
+
+struct Arena *ArenaBegin(u32 size);
+void *ArenaAlloc(struct Arena *arena, u32 size);
+void *ArenaAllocZeroed(struct Arena *arena, u32 size);
+void ArenaEnd(struct Arena *arena);
 
 #endif // GUARD_ALLOC_H
@@ -1,7 +1,9 @@
 #include "global.h"
 #include "sprite.h"
+#include "bit_util.h"
 #include "main.h"
 #include "palette.h"
+#include "profiler.h"
 
 #define MAX_SPRITE_COPY_REQUESTS 64
 
@@ -16,18 +18,68 @@
     (sSpriteTileRanges + 1)[index * 2] = count;    \
 }
 
-#define ALLOC_SPRITE_TILE(n)                             \
-{                                                        \
-    sSpriteTileAllocBitmap[(n) / 8] |= (1 << ((n) % 8)); \
-}
+#define SPRITE_SORT_KEY_Y_BITS 9
+
+// SortSprites radix sorts the 19 bits of the sort keys in 3 digits.
+#define SPRITE_SORT_KEY_DIGIT_BITS 7
+#define SPRITE_SORT_KEY_DIGITS 3
+#define GET_SPRITE_SORT_KEY_DIGIT(key, n) (((key) >> ((n) * SPRITE_SORT_KEY_DIGIT_BITS)) & ((1 << SPRITE_SORT_KEY_DIGIT_BITS) - 1))
+
+// An insertion sort is quicker than a radix sort when only a few sprites have
+// to move.
+#define MAX_SPRITES_OUT_OF_ORDER_FOR_INSERTION_SORT 8
+
+#ifdef OAM_SNAPSHOTS
+// An OamData read as words, to compare its attributes in two loads. attr0 and
+// attr1 are the first word, and attr2 is the low half of the second; the high
+// half is the affine parameter, which is copied from gOamMatrices instead.
+// Going through a copy in a union keeps this within the aliasing rules.
+union OamWords
+{
+    struct OamData oam;
+    u32 words[2];
+};
+
+#define OAM_WORDS_ATTR01(oamWords) ((oamWords).words[0])
+#define OAM_WORDS_ATTR2(oamWords) ((oamWords).words[1] & 0xFFFF)
 
-#define FREE_SPRITE_TILE(n)                               \
-{                                                         \
-    sSpriteTileAllocBitmap[(n) / 8] &= ~(1 << ((n) % 8)); \
+#define MARK_OAM_ENTRY_DIRTY(index)         \
+{                                           \
+    if ((index) < sOamDirtyStart)           \
+        sOamDirtyStart = (index);           \
+    if ((index) >= sOamDirtyEnd)            \
+        sOamDirtyEnd = (index) + 1;         \
 }
+#else
+#define MARK_OAM_ENTRY_DIRTY(index)
+#endif
+
+// Tile n's bit is bit n % 32 of word n / 32.
+#define SPRITE_TILE_BITMAP_WORDS (TOTAL_OBJ_TILE_COUNT / 32)
+
+#define SPRITE_TILE_IS_ALLOCATED(n) ((sSpriteTileAllocBitmap[(n) / 32] >> ((n) % 32)) & 1)
 
-#define SPRITE_TILE_IS_ALLOCATED(n) ((sSpriteTileAllocBitmap[(n) / 8] >> ((n) % 8)) & 1)
+// AllocSpriteTiles picks the smallest run of free tiles that fits from this
+// list. When OBJ VRAM has more runs than it holds, the largest ones are kept,
+// so a request that fits none of them only needs a new list if one of the
+// others could be big enough.
+#define MAX_FREE_SPRITE_TILE_RUNS 16
+
+struct SpriteTileRun
+{
+    u16 start;
+    u16 count;
+};
 
+// What a sprite added to the OAM buffer when it was last built. If no sprite's
+// snapshot changes, BuildOamBuffer can leave the buffer as it is.
+struct SpriteOamSnapshot
+{
+    u32 attr01;
+    u32 attr2; // Bit 16 is set if the sprite was drawn.
+    const struct SubspriteTable *subspriteTables;
+    u32 state; // subpriority, subspriteTableNum, subspriteMode and centerToCornerVec.
+};
 
 struct SpriteCopyRequest
 {
@@ -51,12 +103,25 @@ struct OamDimensions
 static void UpdateOamCoords(void);
 static void BuildSpritePriorities(void);
 static void SortSprites(void);
+static void InsertionSortSprites(void);
+static void RadixSortSprites(void);
 static void CopyMatricesToOamBuffer(void);
+#ifdef OAM_SNAPSHOTS
+static bool32 UpdateSpriteOamSnapshots(void);
+#endif
+static void CopyOamAttributes(struct OamData *dest, const struct OamData *src, u8 oamIndex);
 static void AddSpritesToOamBuffer(void);
 static u8 CreateSpriteAt(u8 index, const struct SpriteTemplate *template, s16 x, s16 y, u8 subpriority);
 static void ResetOamMatrices(void);
 static void ResetSprite(struct Sprite *sprite);
 static s16 AllocSpriteTiles(u16 tileCount);
+static void SetSpriteTileBits(u16 start, u16 count, bool32 allocated);
+static void FreeSpriteTileBits(u16 start, u16 count);
+static u16 FindSpriteTile(u16 tile, bool32 allocated);
+static u16 FindFreeSpriteTileRunStart(u16 tile);
+static void AddFreeSpriteTileRun(u16 start, u16 count);
+static void BuildFreeSpriteTileRuns(void);
+static u8 FindBestFreeSpriteTileRun(u16 tileCount);
 static void RequestSpriteFrameImageCopy(u16 index, u16 tileNum, const struct SpriteFrameImage *images);
 static void ResetAllSprites(void);
 static void BeginAnim(struct Sprite *sprite);
@@ -280,14 +345,27 @@ u32 gOamMatrixAllocBitmap;
 u8 gReservedSpritePaletteCount;
 
 EWRAM_DATA struct Sprite gSprites[MAX_SPRITES + 1] = {0};
-EWRAM_DATA static u16 sSpritePriorities[MAX_SPRITES] = {0};
+EWRAM_DATA static u32 sSpriteSortKeys[MAX_SPRITES] = {0};
 EWRAM_DATA static u8 sSpriteOrder[MAX_SPRITES] = {0};
 EWRAM_DATA static bool8 sShouldProcessSpriteCopyRequests = 0;
 EWRAM_DATA static u8 sSpriteCopyRequestCount = 0;
 EWRAM_DATA static struct SpriteCopyRequest sSpriteCopyRequests[MAX_SPRITES] = {0};
+#ifdef OAM_SNAPSHOTS
+EWRAM_DATA static struct SpriteOamSnapshot sSpriteOamSnapshots[MAX_SPRITES] = {0};
+EWRAM_DATA static struct OamMatrix sCopiedOamMatrices[OAM_MATRIX_COUNT] = {0}; // What CopyMatricesToOamBuffer last copied.
+EWRAM_DATA static bool8 sOamBufferUpToDate = FALSE; // Cleared when something else writes to the buffer.
+EWRAM_DATA static u8 sLastOamLimit = 0;
+EWRAM_DATA static u8 sOamDirtyStart = 0; // The buffer entries from sOamDirtyStart to sOamDirtyEnd
+EWRAM_DATA static u8 sOamDirtyEnd = 0;   // changed since LoadOam last copied them.
+#endif
 EWRAM_DATA u8 gOamLimit = 0;
 EWRAM_DATA u16 gReservedSpriteTileCount = 0;
-EWRAM_DATA static u8 sSpriteTileAllocBitmap[128] = {0};
+EWRAM_DATA static u32 sSpriteTileAllocBitmap[SPRITE_TILE_BITMAP_WORDS] = {0};
+EWRAM_DATA static struct SpriteTileRun sFreeSpriteTileRuns[MAX_FREE_SPRITE_TILE_RUNS] = {0};
+EWRAM_DATA static u8 sFreeSpriteTileRunCount = 0;
+EWRAM_DATA static bool8 sFreeSpriteTileRunsValid = FALSE;
+EWRAM_DATA static u16 sLargestUnlistedFreeSpriteTileRun = 0; // At least as big as any free run that didn't fit in the list.
+EWRAM_DATA static u16 sFreeSpriteTileRunsReservedCount = 0; // gReservedSpriteTileCount when the runs were listed.
 EWRAM_DATA s16 gSpriteCoordOffsetX = 0;
 EWRAM_DATA s16 gSpriteCoordOffsetY = 0;
 EWRAM_DATA struct OamMatrix gOamMatrices[OAM_MATRIX_COUNT] = {0};
@@ -310,6 +388,7 @@ void ResetSpriteData(void)
 void AnimateSprites(void)
 {
     u8 i;
+    PROFILER_BEGIN(AnimateSprites);
     for (i = 0; i < MAX_SPRITES; i++)
     {
         struct Sprite *sprite = &gSprites[i];
@@ -322,20 +401,37 @@ void AnimateSprites(void)
                 AnimateSprite(sprite);
         }
     }
+    PROFILER_END();
 }
 
 void BuildOamBuffer(void)
 {
     u8 temp;
+    PROFILER_BEGIN(BuildOamBuffer);
     UpdateOamCoords();
-    BuildSpritePriorities();
-    SortSprites();
     temp = gMain.oamLoadDisabled;
     gMain.oamLoadDisabled = TRUE;
-    AddSpritesToOamBuffer();
     CopyMatricesToOamBuffer();
+
+#ifdef OAM_SNAPSHOTS
+    // Only rebuild the sprites' entries if a sprite changed how it's drawn.
+    if (UpdateSpriteOamSnapshots() || !sOamBufferUpToDate || sLastOamLimit != gOamLimit)
+    {
+        BuildSpritePriorities();
+        SortSprites();
+        AddSpritesToOamBuffer();
+        sOamBufferUpToDate = TRUE;
+        sLastOamLimit = gOamLimit;
+    }
+#else
+    BuildSpritePriorities();
+    SortSprites();
+    AddSpritesToOamBuffer();
+#endif
+
     gMain.oamLoadDisabled = temp;
     sShouldProcessSpriteCopyRequests = TRUE;
+    PROFILER_END();
 }
 
 void UpdateOamCoords(void)
@@ -360,6 +456,12 @@ void UpdateOamCoords(void)
     }
 }
 
+// A sprite's sort key is its priority and subpriority, then its y flipped so
+// that sprites lower on the screen come first, like this:
+//   bits 9-18: priority << 8 | subpriority
+//   bits 0-8:  DISPLAY_HEIGHT - 1 - y
+// OAM y wraps around, so sprites below the screen count as above it, and so do
+// the double size 64x64 and 32x64 sprites whose top is in the lower half.
 void BuildSpritePriorities(void)
 {
     u16 i;
@@ -367,117 +469,197 @@ void BuildSpritePriorities(void)
     {
         struct Sprite *sprite = &gSprites[i];
         u16 priority = sprite->subpriority | (sprite->oam.priority << 8);
-        sSpritePriorities[i] = priority;
+        s16 y = sprite->oam.y;
+
+        if (y >= DISPLAY_HEIGHT)
+            y = y - 256;
+
+        if (sprite->oam.affineMode == ST_OAM_AFFINE_DOUBLE
+         && sprite->oam.size == ST_OAM_SIZE_3)
+        {
+            u32 shape = sprite->oam.shape;
+            if (shape == ST_OAM_SQUARE || shape == ST_OAM_V_RECTANGLE)
+            {
+                if (y > 128)
+                    y = y - 256;
+            }
+        }
+
+        sSpriteSortKeys[i] = (priority << SPRITE_SORT_KEY_Y_BITS) | (DISPLAY_HEIGHT - 1 - y);
     }
 }
 
+// Sorts sSpriteOrder by sort key, keeping sprites with the same key in the
+// order they had last frame. That order usually changes little from frame to
+// frame, so a few sprites out of place are moved with an insertion sort, and
+// anything more is radix sorted.
 void SortSprites(void)
 {
     u8 i;
+    u8 numOutOfOrder = 0;
+
     for (i = 1; i < MAX_SPRITES; i++)
     {
-        u8 j = i;
-        struct Sprite *sprite1 = &gSprites[sSpriteOrder[i - 1]];
-        struct Sprite *sprite2 = &gSprites[sSpriteOrder[i]];
-        u16 sprite1Priority = sSpritePriorities[sSpriteOrder[i - 1]];
-        u16 sprite2Priority = sSpritePriorities[sSpriteOrder[i]];
-        s16 sprite1Y = sprite1->oam.y;
-        s16 sprite2Y = sprite2->oam.y;
+        if (sSpriteSortKeys[sSpriteOrder[i - 1]] > sSpriteSortKeys[sSpriteOrder[i]])
+            numOutOfOrder++;
+    }
 
-        if (sprite1Y >= DISPLAY_HEIGHT)
-            sprite1Y = sprite1Y - 256;
+    if (numOutOfOrder == 0)
+        return;
 
-        if (sprite2Y >= DISPLAY_HEIGHT)
-            sprite2Y = sprite2Y - 256;
+    if (numOutOfOrder <= MAX_SPRITES_OUT_OF_ORDER_FOR_INSERTION_SORT)
+        InsertionSortSprites();
+    else
+        RadixSortSprites();
+}
 
-        if (sprite1->oam.affineMode == ST_OAM_AFFINE_DOUBLE
-         && sprite1->oam.size == ST_OAM_SIZE_3)
-        {
-            u32 shape = sprite1->oam.shape;
-            if (shape == ST_OAM_SQUARE || shape == ST_OAM_V_RECTANGLE)
-            {
-                if (sprite1Y > 128)
-                    sprite1Y = sprite1Y - 256;
-            }
-        }
+static void InsertionSortSprites(void)
+{
+    u8 i, j;
+
+    for (i = 1; i < MAX_SPRITES; i++)
+    {
+        u8 spriteId = sSpriteOrder[i];
+        u32 key = sSpriteSortKeys[spriteId];
+
+        for (j = i; j > 0 && sSpriteSortKeys[sSpriteOrder[j - 1]] > key; j--)
+            sSpriteOrder[j] = sSpriteOrder[j - 1];
+
+        sSpriteOrder[j] = spriteId;
+    }
+}
+
+static void RadixSortSprites(void)
+{
+    u8 i;
+    u8 digit;
+    u8 pass;
+    union
+    {
+        u32 words[SPRITE_SORT_KEY_DIGITS << SPRITE_SORT_KEY_DIGIT_BITS >> 2]; // Aligned for CpuFill32
+        u8 digits[SPRITE_SORT_KEY_DIGITS][1 << SPRITE_SORT_KEY_DIGIT_BITS];
+    } counts;
+    u8 buffer[MAX_SPRITES];
+    u8 *src = sSpriteOrder;
+    u8 *dest = buffer;
+
+    CpuFill32(0, counts.words, sizeof(counts));
+    for (i = 0; i < MAX_SPRITES; i++)
+    {
+        u32 key = sSpriteSortKeys[i];
+        for (pass = 0; pass < SPRITE_SORT_KEY_DIGITS; pass++)
+            counts.digits[pass][GET_SPRITE_SORT_KEY_DIGIT(key, pass)]++;
+    }
+
+    for (pass = 0; pass < SPRITE_SORT_KEY_DIGITS; pass++)
+    {
+        u8 *passCounts = counts.digits[pass];
+        u8 numSorted = 0;
+        u8 *temp;
+
+        // Skip the digit if every key has the same one.
+        if (passCounts[GET_SPRITE_SORT_KEY_DIGIT(sSpriteSortKeys[0], pass)] == MAX_SPRITES)
+            continue;
 
-        if (sprite2->oam.affineMode == ST_OAM_AFFINE_DOUBLE
-         && sprite2->oam.size == ST_OAM_SIZE_3)
+        // Turn the counts into where each digit's sprites start.
+        for (digit = 0; digit < (1 << SPRITE_SORT_KEY_DIGIT_BITS) - 1; digit++)
         {
-            u32 shape = sprite2->oam.shape;
-            if (shape == ST_OAM_SQUARE || shape == ST_OAM_V_RECTANGLE)
-            {
-                if (sprite2Y > 128)
-                    sprite2Y = sprite2Y - 256;
-            }
+            u8 count = passCounts[digit];
+            passCounts[digit] = numSorted;
+            numSorted += count;
         }
+        passCounts[digit] = numSorted;
 
-        while (j > 0
-            && ((sprite1Priority > sprite2Priority)
-             || (sprite1Priority == sprite2Priority && sprite1Y < sprite2Y)))
+        for (i = 0; i < MAX_SPRITES; i++)
         {
-            u8 temp = sSpriteOrder[j];
-            sSpriteOrder[j] = sSpriteOrder[j - 1];
-            sSpriteOrder[j - 1] = temp;
+            u8 spriteId = src[i];
+            dest[passCounts[GET_SPRITE_SORT_KEY_DIGIT(sSpriteSortKeys[spriteId], pass)]++] = spriteId;
+        }
 
-            // UB: If j equals 1, then j-- makes j equal 0.
-            // Then, sSpriteOrder[-1] gets accessed below.
-            // Although this doesn't result in a bug in the ROM,
-            // the behavior is undefined.
-            j--;
-#ifdef UBFIX
-            if (j == 0)
-                break;
-#endif
+        temp = src;
+        src = dest;
+        dest = temp;
+    }
 
-            sprite1 = &gSprites[sSpriteOrder[j - 1]];
-            sprite2 = &gSprites[sSpriteOrder[j]];
-            sprite1Priority = sSpritePriorities[sSpriteOrder[j - 1]];
-            sprite2Priority = sSpritePriorities[sSpriteOrder[j]];
-            sprite1Y = sprite1->oam.y;
-            sprite2Y = sprite2->oam.y;
+    if (src != sSpriteOrder)
+    {
+        for (i = 0; i < MAX_SPRITES; i++)
+            sSpriteOrder[i] = src[i];
+    }
+}
 
-            if (sprite1Y >= DISPLAY_HEIGHT)
-                sprite1Y = sprite1Y - 256;
+#ifdef OAM_SNAPSHOTS
+// Saves what each sprite will add to the OAM buffer, and returns whether any
+// of it changed since the last call. Sprites that aren't drawn are saved too,
+// since their sort keys still move them around in sSpriteOrder, which decides
+// the order of sprites with the same key.
+static bool32 UpdateSpriteOamSnapshots(void)
+{
+    u8 i;
+    bool32 changed = FALSE;
 
-            if (sprite2Y >= DISPLAY_HEIGHT)
-                sprite2Y = sprite2Y - 256;
+    for (i = 0; i < MAX_SPRITES; i++)
+    {
+        struct Sprite *sprite = &gSprites[i];
+        struct SpriteOamSnapshot *snapshot = &sSpriteOamSnapshots[i];
+        union OamWords oamWords;
+        u32 attr01, attr2;
+        u32 state = sprite->subpriority
+                  | (sprite->subspriteTableNum << 8)
+                  | (sprite->subspriteMode << 14)
+                  | ((u8)sprite->centerToCornerVecX << 16)
+                  | ((u8)sprite->centerToCornerVecY << 24);
+
+        oamWords.oam = sprite->oam;
+        attr01 = OAM_WORDS_ATTR01(oamWords);
+        attr2 = OAM_WORDS_ATTR2(oamWords);
 
-            if (sprite1->oam.affineMode == ST_OAM_AFFINE_DOUBLE
-             && sprite1->oam.size == ST_OAM_SIZE_3)
-            {
-                u32 shape = sprite1->oam.shape;
-                if (shape == ST_OAM_SQUARE || shape == ST_OAM_V_RECTANGLE)
-                {
-                    if (sprite1Y > 128)
-                        sprite1Y = sprite1Y - 256;
-                }
-            }
+        if (sprite->inUse && !sprite->invisible)
+            attr2 |= 1 << 16;
 
-            if (sprite2->oam.affineMode == ST_OAM_AFFINE_DOUBLE
-             && sprite2->oam.size == ST_OAM_SIZE_3)
-            {
-                u32 shape = sprite2->oam.shape;
-                if (shape == ST_OAM_SQUARE || shape == ST_OAM_V_RECTANGLE)
-                {
-                    if (sprite2Y > 128)
-                        sprite2Y = sprite2Y - 256;
-                }
-            }
+        if (snapshot->attr01 != attr01
+         || snapshot->attr2 != attr2
+         || snapshot->subspriteTables != sprite->subspriteTables
+         || snapshot->state != state)
+        {
+            snapshot->attr01 = attr01;
+            snapshot->attr2 = attr2;
+            snapshot->subspriteTables = sprite->subspriteTables;
+            snapshot->state = state;
+            changed = TRUE;
         }
     }
+
+    return changed;
 }
+#endif
 
 void CopyMatricesToOamBuffer(void)
 {
     u8 i;
     for (i = 0; i < OAM_MATRIX_COUNT; i++)
     {
+        struct OamMatrix *matrix = &gOamMatrices[i];
         u32 base = 4 * i;
-        gMain.oamBuffer[base + 0].affineParam = gOamMatrices[i].a;
-        gMain.oamBuffer[base + 1].affineParam = gOamMatrices[i].b;
-        gMain.oamBuffer[base + 2].affineParam = gOamMatrices[i].c;
-        gMain.oamBuffer[base + 3].affineParam = gOamMatrices[i].d;
+
+#ifdef OAM_SNAPSHOTS
+        struct OamMatrix *copied = &sCopiedOamMatrices[i];
+
+        if (sOamBufferUpToDate
+         && matrix->a == copied->a
+         && matrix->b == copied->b
+         && matrix->c == copied->c
+         && matrix->d == copied->d)
+            continue;
+
+        *copied = *matrix;
+#endif
+        gMain.oamBuffer[base + 0].affineParam = matrix->a;
+        gMain.oamBuffer[base + 1].affineParam = matrix->b;
+        gMain.oamBuffer[base + 2].affineParam = matrix->c;
+        gMain.oamBuffer[base + 3].affineParam = matrix->d;
+        MARK_OAM_ENTRY_DIRTY(base);
+        MARK_OAM_ENTRY_DIRTY(base + 3);
     }
 }
 
@@ -496,11 +678,31 @@ void AddSpritesToOamBuffer(void)
 
     while (oamIndex < gOamLimit)
     {
-        gMain.oamBuffer[oamIndex] = gDummyOamData;
+        CopyOamAttributes(&gMain.oamBuffer[oamIndex], &gDummyOamData, oamIndex);
         oamIndex++;
     }
 }
 
+// Copies the attributes of an OAM buffer entry. With OAM_SNAPSHOTS, only
+// entries that are different are written and marked as dirty.
+static void CopyOamAttributes(struct OamData *dest, const struct OamData *src, u8 oamIndex)
+{
+    u16 affineParam;
+#ifdef OAM_SNAPSHOTS
+    union OamWords destWords, srcWords;
+
+    destWords.oam = *dest;
+    srcWords.oam = *src;
+    if (OAM_WORDS_ATTR01(destWords) == OAM_WORDS_ATTR01(srcWords)
+     && OAM_WORDS_ATTR2(destWords) == OAM_WORDS_ATTR2(srcWords))
+        return;
+#endif
+    affineParam = dest->affineParam;
+    *dest = *src;
+    dest->affineParam = affineParam;
+    MARK_OAM_ENTRY_DIRTY(oamIndex);
+}
+
 u8 CreateSprite(const struct SpriteTemplate *template, s16 x, s16 y, u8 subpriority)
 {
     u8 i;
@@ -623,10 +825,7 @@ void DestroySprite(struct Sprite *sprite)
     {
         if (!sprite->usingSheet)
         {
-            u16 i;
-            u16 tileEnd = (sprite->images->size / TILE_SIZE_4BPP) + sprite->oam.tileNum;
-            for (i = sprite->oam.tileNum; i < tileEnd; i++)
-                FREE_SPRITE_TILE(i);
+            FreeSpriteTileBits(sprite->oam.tileNum, sprite->images->size / TILE_SIZE_4BPP);
         }
         ResetSprite(sprite);
     }
@@ -637,12 +836,42 @@ void ResetOamRange(u8 start, u8 end)
     u8 i;
     for (i = start; i < end; i++)
         gMain.oamBuffer[i] = *(struct OamData *)&gDummyOamData;
+    MarkOamBufferDirty(start, end);
+}
+
+// Makes LoadOam copy the entries from start up to end, and BuildOamBuffer
+// rebuild the sprites' entries. Code that writes to gMain.oamBuffer or OAM
+// itself has to call this. Without OAM_SNAPSHOTS, the whole buffer is
+// rebuilt and copied every frame, so there is nothing to do.
+void MarkOamBufferDirty(u8 start, u8 end)
+{
+#ifdef OAM_SNAPSHOTS
+    u8 temp = gMain.oamLoadDisabled;
+
+    // Keep LoadOam from running in the middle of this in VBlank.
+    gMain.oamLoadDisabled = TRUE;
+    if (start < sOamDirtyStart)
+        sOamDirtyStart = start;
+    if (end > sOamDirtyEnd)
+        sOamDirtyEnd = end;
+    sOamBufferUpToDate = FALSE;
+    gMain.oamLoadDisabled = temp;
+#endif
 }
 
 void LoadOam(void)
 {
+#ifdef OAM_SNAPSHOTS
+    if (!gMain.oamLoadDisabled && sOamDirtyStart < sOamDirtyEnd)
+    {
+        CpuCopy32(&gMain.oamBuffer[sOamDirtyStart], (struct OamData *)OAM + sOamDirtyStart, (sOamDirtyEnd - sOamDirtyStart) * sizeof(struct OamData));
+        sOamDirtyStart = ARRAY_COUNT(gMain.oamBuffer);
+        sOamDirtyEnd = 0;
+    }
+#else
     if (!gMain.oamLoadDisabled)
         CpuCopy32(gMain.oamBuffer, (void *)OAM, sizeof(gMain.oamBuffer));
+#endif
 }
 
 void ClearSpriteCopyRequests(void)
@@ -701,83 +930,275 @@ void CalcCenterToCornerVec(struct Sprite *sprite, u8 shape, u8 size, u8 affineMo
     sprite->centerToCornerVecY = y;
 }
 
-s16 AllocSpriteTiles(u16 tileCount)
+// Sets or clears the bits of count tiles, a word at a time.
+static void SetSpriteTileBits(u16 start, u16 count, bool32 allocated)
 {
-    u16 i;
-    s16 start;
-    u16 numTilesFound;
+    u32 *word = &sSpriteTileAllocBitmap[start / 32];
+    u32 shift = start % 32;
 
-    if (tileCount == 0)
+    while (count != 0)
     {
-        // Free all unreserved tiles if the tile count is 0.
-        for (i = gReservedSpriteTileCount; i < TOTAL_OBJ_TILE_COUNT; i++)
-            FREE_SPRITE_TILE(i);
+        u32 mask;
+        u32 numBits = 32 - shift;
 
-        return 0;
+        if (numBits > count)
+            numBits = count;
+
+        mask = (0xFFFFFFFF >> (32 - numBits)) << shift;
+
+        if (allocated)
+            *word |= mask;
+        else
+            *word &= ~mask;
+
+        word++;
+        shift = 0;
+        count -= numBits;
     }
+}
+
+// Frees the tiles and merges them with the free runs around them.
+static void FreeSpriteTileBits(u16 start, u16 count)
+{
+    u8 i;
+    u16 end = start + count;
 
-    i = gReservedSpriteTileCount;
+    SetSpriteTileBits(start, count, FALSE);
+    if (!sFreeSpriteTileRunsValid || count == 0)
+        return;
+
+    start = FindFreeSpriteTileRunStart(start);
+    end = FindSpriteTile(end, TRUE);
+    if (start < gReservedSpriteTileCount)
+        start = gReservedSpriteTileCount;
+    if (start >= end)
+        return;
 
-    for (;;)
+    // Drop the runs that the new one takes in.
+    for (i = 0; i < sFreeSpriteTileRunCount;)
     {
-        while (SPRITE_TILE_IS_ALLOCATED(i))
-        {
+        if (sFreeSpriteTileRuns[i].start >= start && sFreeSpriteTileRuns[i].start < end)
+            sFreeSpriteTileRuns[i] = sFreeSpriteTileRuns[--sFreeSpriteTileRunCount];
+        else
             i++;
+    }
 
-            if (i == TOTAL_OBJ_TILE_COUNT)
-                return -1;
-        }
+    AddFreeSpriteTileRun(start, end - start);
+}
 
-        start = i;
-        numTilesFound = 1;
+// Returns the first tile from tile on that is allocated (or free, if allocated
+// is FALSE), or TOTAL_OBJ_TILE_COUNT if there isn't one.
+static u16 FindSpriteTile(u16 tile, bool32 allocated)
+{
+    u32 wordIndex = tile / 32;
+    u32 bits;
 
-        while (numTilesFound != tileCount)
-        {
-            i++;
+    if (tile >= TOTAL_OBJ_TILE_COUNT)
+        return TOTAL_OBJ_TILE_COUNT;
 
-            if (i == TOTAL_OBJ_TILE_COUNT)
-                return -1;
+    bits = sSpriteTileAllocBitmap[wordIndex];
+    if (!allocated)
+        bits = ~bits;
+    bits &= 0xFFFFFFFF << (tile % 32);
 
-            if (!SPRITE_TILE_IS_ALLOCATED(i))
-                numTilesFound++;
-            else
-                break;
-        }
+    while (bits == 0)
+    {
+        if (++wordIndex == SPRITE_TILE_BITMAP_WORDS)
+            return TOTAL_OBJ_TILE_COUNT;
 
-        if (numTilesFound == tileCount)
-            break;
+        bits = sSpriteTileAllocBitmap[wordIndex];
+        if (!allocated)
+            bits = ~bits;
+    }
+
+    return wordIndex * 32 + GetLowestBitIndex(bits);
+}
+
+// Returns the first tile of the free run that tile is in, or that ends just
+// before tile.
+static u16 FindFreeSpriteTileRunStart(u16 tile)
+{
+    u32 wordIndex;
+    u32 bits;
+
+    if (tile == 0)
+        return 0;
+
+    wordIndex = (tile - 1) / 32;
+    bits = sSpriteTileAllocBitmap[wordIndex] & (0xFFFFFFFF >> (31 - (tile - 1) % 32));
+
+    while (bits == 0)
+    {
+        if (wordIndex == 0)
+            return 0;
+
+        bits = sSpriteTileAllocBitmap[--wordIndex];
+    }
+
+    return wordIndex * 32 + GetHighestBitIndex(bits) + 1;
+}
+
+static void AddFreeSpriteTileRun(u16 start, u16 count)
+{
+    u8 i;
+    u8 smallest;
+    u16 unlisted;
+
+    if (sFreeSpriteTileRunCount < MAX_FREE_SPRITE_TILE_RUNS)
+    {
+        sFreeSpriteTileRuns[sFreeSpriteTileRunCount].start = start;
+        sFreeSpriteTileRuns[sFreeSpriteTileRunCount].count = count;
+        sFreeSpriteTileRunCount++;
+        return;
+    }
+
+    // The list is full, so leave out whichever run is smallest.
+    smallest = 0;
+    for (i = 1; i < MAX_FREE_SPRITE_TILE_RUNS; i++)
+    {
+        if (sFreeSpriteTileRuns[i].count < sFreeSpriteTileRuns[smallest].count)
+            smallest = i;
+    }
+
+    if (count > sFreeSpriteTileRuns[smallest].count)
+    {
+        unlisted = sFreeSpriteTileRuns[smallest].count;
+        sFreeSpriteTileRuns[smallest].start = start;
+        sFreeSpriteTileRuns[smallest].count = count;
+    }
+    else
+    {
+        unlisted = count;
+    }
+
+    if (unlisted > sLargestUnlistedFreeSpriteTileRun)
+        sLargestUnlistedFreeSpriteTileRun = unlisted;
+}
+
+static void BuildFreeSpriteTileRuns(void)
+{
+    u16 start = FindSpriteTile(gReservedSpriteTileCount, FALSE);
+
+    sFreeSpriteTileRunCount = 0;
+    sLargestUnlistedFreeSpriteTileRun = 0;
+
+    while (start < TOTAL_OBJ_TILE_COUNT)
+    {
+        u16 end = FindSpriteTile(start, TRUE);
+
+        AddFreeSpriteTileRun(start, end - start);
+        start = FindSpriteTile(end, FALSE);
+    }
+
+    sFreeSpriteTileRunsReservedCount = gReservedSpriteTileCount;
+    sFreeSpriteTileRunsValid = TRUE;
+}
+
+// Returns the smallest listed run that fits (the first one of those), or
+// MAX_FREE_SPRITE_TILE_RUNS if none does.
+static u8 FindBestFreeSpriteTileRun(u16 tileCount)
+{
+    u8 i;
+    u8 best = MAX_FREE_SPRITE_TILE_RUNS;
+
+    for (i = 0; i < sFreeSpriteTileRunCount; i++)
+    {
+        struct SpriteTileRun *run = &sFreeSpriteTileRuns[i];
+
+        if (run->count < tileCount)
+            continue;
+
+        if (best == MAX_FREE_SPRITE_TILE_RUNS
+         || run->count < sFreeSpriteTileRuns[best].count
+         || (run->count == sFreeSpriteTileRuns[best].count && run->start < sFreeSpriteTileRuns[best].start))
+            best = i;
     }
 
-    for (i = start; i < tileCount + start; i++)
-        ALLOC_SPRITE_TILE(i);
+    return best;
+}
+
+s16 AllocSpriteTiles(u16 tileCount)
+{
+    u8 best;
+    u16 start;
+
+    if (tileCount == 0)
+    {
+        // Free all unreserved tiles if the tile count is 0.
+        if (gReservedSpriteTileCount < TOTAL_OBJ_TILE_COUNT)
+            SetSpriteTileBits(gReservedSpriteTileCount, TOTAL_OBJ_TILE_COUNT - gReservedSpriteTileCount, FALSE);
+
+        sFreeSpriteTileRunsValid = FALSE;
+        return 0;
+    }
+
+    if (!sFreeSpriteTileRunsValid || sFreeSpriteTileRunsReservedCount != gReservedSpriteTileCount)
+        BuildFreeSpriteTileRuns();
+
+    best = FindBestFreeSpriteTileRun(tileCount);
+    if (best == MAX_FREE_SPRITE_TILE_RUNS && sLargestUnlistedFreeSpriteTileRun >= tileCount)
+    {
+        BuildFreeSpriteTileRuns();
+        best = FindBestFreeSpriteTileRun(tileCount);
+    }
+
+    if (best == MAX_FREE_SPRITE_TILE_RUNS)
+        return -1;
+
+    start = sFreeSpriteTileRuns[best].start;
+    SetSpriteTileBits(start, tileCount, TRUE);
+
+    sFreeSpriteTileRuns[best].start += tileCount;
+    sFreeSpriteTileRuns[best].count -= tileCount;
+    if (sFreeSpriteTileRuns[best].count == 0)
+        sFreeSpriteTileRuns[best] = sFreeSpriteTileRuns[--sFreeSpriteTileRunCount];
 
     return start;
 }
 
 u8 SpriteTileAllocBitmapOp(u16 bit, u8 op)
 {
-    u8 index = bit / 8;
-    u8 shift = bit % 8;
-    u8 val = bit % 8;
-    u8 retVal = 0;
-
     if (op == 0)
     {
-        val = ~(1 << val);
-        sSpriteTileAllocBitmap[index] &= val;
+        FreeSpriteTileBits(bit, 1);
     }
     else if (op == 1)
     {
-        val = (1 << val);
-        sSpriteTileAllocBitmap[index] |= val;
+        SetSpriteTileBits(bit, 1, TRUE);
+        sFreeSpriteTileRunsValid = FALSE;
     }
     else
     {
-        retVal = 1 << shift;
-        retVal &= sSpriteTileAllocBitmap[index];
+        return SPRITE_TILE_IS_ALLOCATED(bit) << (bit % 8);
     }
 
-    return retVal;
+    return 0;
+}
+
+void GetSpriteTileStats(struct SpriteTileStats *stats)
+{
+    u16 start = FindSpriteTile(gReservedSpriteTileCount, FALSE);
+
+    stats->freeTiles = 0;
+    stats->largestFreeRun = 0;
+    stats->numFreeRuns = 0;
+
+    while (start < TOTAL_OBJ_TILE_COUNT)
+    {
+        u16 end = FindSpriteTile(start, TRUE);
+
+        stats->freeTiles += end - start;
+        stats->numFreeRuns++;
+        if (end - start > stats->largestFreeRun)
+            stats->largestFreeRun = end - start;
+
+        start = FindSpriteTile(end, FALSE);
+    }
+
+    if (stats->freeTiles != 0)
+        stats->fragmentation = 100 - stats->largestFreeRun * 100 / stats->freeTiles;
+    else
+        stats->fragmentation = 0;
 }
 
 void SpriteCallbackDummy(struct Sprite *sprite)
@@ -1509,7 +1930,6 @@ void FreeSpriteTilesByTag(u16 tag)
     u8 index = IndexOfSpriteTileTag(tag);
     if (index != 0xFF)
     {
-        u16 i;
         u16 *rangeStarts;
         u16 *rangeCounts;
         u16 start;
@@ -1519,8 +1939,7 @@ void FreeSpriteTilesByTag(u16 tag)
         rangeCounts = sSpriteTileRanges + 1;
         count = rangeCounts[index * 2];
 
-        for (i = start; i < start + count; i++)
-            FREE_SPRITE_TILE(i);
+        FreeSpriteTileBits(start, count);
 
         sSpriteTileRangeTags[index] = TAG_NONE;
     }
@@ -1668,7 +2087,7 @@ bool8 AddSpriteToOamBuffer(struct Sprite *sprite, u8 *oamIndex)
 
     if (!sprite->subspriteTables || sprite->subspriteMode == SUBSPRITES_OFF)
     {
-        gMain.oamBuffer[*oamIndex] = sprite->oam;
+        CopyOamAttributes(&gMain.oamBuffer[*oamIndex], &sprite->oam, *oamIndex);
         (*oamIndex)++;
         return 0;
     }
@@ -1691,12 +2110,13 @@ bool8 AddSubspritesToOamBuffer(struct Sprite *sprite, struct OamData *destOam, u
 
     if (!subspriteTable || !subspriteTable->subsprites)
     {
-        *destOam = *oam;
+        CopyOamAttributes(destOam, oam, *oamIndex);
         (*oamIndex)++;
         return 0;
     }
     else
     {
+        struct OamData subspriteOam;
         u16 tileNum;
         u16 baseX;
         u16 baseY;
@@ -1741,15 +2161,17 @@ bool8 AddSubspritesToOamBuffer(struct Sprite *sprite, struct OamData *destOam, u
                 y = ~y + 1;
             }
 
-            destOam[i] = *oam;
-            destOam[i].shape = subspriteTable->subsprites[i].shape;
-            destOam[i].size = subspriteTable->subsprites[i].size;
-            destOam[i].x = (s16)baseX + (s16)x;
-            destOam[i].y = baseY + y;
-            destOam[i].tileNum = tileNum + subspriteTable->subsprites[i].tileOffset;
+            subspriteOam = *oam;
+            subspriteOam.shape = subspriteTable->subsprites[i].shape;
+            subspriteOam.size = subspriteTable->subsprites[i].size;
+            subspriteOam.x = (s16)baseX + (s16)x;
+            subspriteOam.y = baseY + y;
+            subspriteOam.tileNum = tileNum + subspriteTable->subsprites[i].tileOffset;
 
             if (sprite->subspriteMode != SUBSPRITES_IGNORE_PRIORITY)
-                destOam[i].priority = subspriteTable->subsprites[i].priority;
+                subspriteOam.priority = subspriteTable->subsprites[i].priority;
+
+            CopyOamAttributes(&destOam[i], &subspriteOam, *oamIndex);
         }
     }
 
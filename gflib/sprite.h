@@ -248,6 +248,16 @@ struct OamMatrix
     s16 d;
 };
 
+// How the OBJ VRAM tiles after the reserved ones are used. Meant for
+// debugging, since GetSpriteTileStats goes through all of them.
+struct SpriteTileStats
+{
+    u16 freeTiles;
+    u16 largestFreeRun; // The most tiles a sprite sheet loaded now could have.
+    u16 numFreeRuns;
+    u8 fragmentation; // Percentage of free tiles outside the largest free run.
+};
+
 extern const struct OamData gDummyOamData;
 extern const union AnimCmd *const gDummySpriteAnimTable[];
 extern const union AffineAnimCmd *const gDummySpriteAffineAnimTable[];
@@ -271,6 +281,7 @@ u8 CreateInvisibleSprite(void (*callback)(struct Sprite *));
 u8 CreateSpriteAndAnimate(const struct SpriteTemplate *template, s16 x, s16 y, u8 subpriority);
 void DestroySprite(struct Sprite *sprite);
 void ResetOamRange(u8 start, u8 end);
+void MarkOamBufferDirty(u8 start, u8 end);
 void LoadOam(void);
 void SetOamMatrix(u8 matrixNum, u16 a, u16 b, u16 c, u16 d);
 void CalcCenterToCornerVec(struct Sprite *sprite, u8 shape, u8 size, u8 affineMode);
@@ -320,6 +331,7 @@ bool8 AddSubspritesToOamBuffer(struct Sprite *sprite, struct OamData *destOam, u
 void CopyToSprites(u8 *src);
 void CopyFromSprites(u8 *dest);
 u8 SpriteTileAllocBitmapOp(u16 bit, u8 op);
+void GetSpriteTileStats(struct SpriteTileStats *stats);
 void ClearSpriteCopyRequests(void);
 void ResetAffineAnimData(void);
 
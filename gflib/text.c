@@ -12,6 +12,7 @@
 #include "menu.h"
 #include "dynamic_placeholder_text_util.h"
 #include "fonts.h"
+#include "profiler.h"
 
 static u16 RenderText(struct TextPrinter *);
 static u32 RenderFont(struct TextPrinter *);
@@ -29,6 +30,7 @@ static void DecompressGlyph_Short(u16, bool32);
 static void DecompressGlyph_Narrow(u16, bool32);
 static void DecompressGlyph_SmallNarrow(u16, bool32);
 static void DecompressGlyph_Bold(u16);
+static void DecompressGlyph(u32, u16, bool32);
 static u32 GetGlyphWidth_Small(u16, bool32);
 static u32 GetGlyphWidth_Normal(u16, bool32);
 static u32 GetGlyphWidth_Short(u16, bool32);
@@ -43,6 +45,39 @@ static u16 sLastTextBgColor;
 static u16 sLastTextFgColor;
 static u16 sLastTextShadowColor;
 
+#ifdef GLYPH_CACHE
+// Glyphs that RenderText decompressed recently, so drawing the same letter in
+// the same colors again is a copy instead. A glyph goes in the set picked by
+// its id and replaces the least recently used glyph there. Only glyphs up to 8
+// pixels wide are kept, which is most Latin ones, so an entry only holds the
+// left tile column and takes 72 bytes of EWRAM.
+#define GLYPH_CACHE_SETS 8
+#define GLYPH_CACHE_WAYS 4
+
+#define GLYPH_CACHE_KEY(fontId, glyphId, isJapanese) ((glyphId) | ((isJapanese) << 9) | ((fontId) << 10))
+
+// The current text colors as a cache key. The valid bit stops empty entries
+// from matching, and colors that don't fit in 4 bits aren't cached.
+#define GLYPH_CACHE_COLORS_VALID 0x8000
+#define GLYPH_CACHE_NO_COLORS    0
+
+struct GlyphCacheEntry
+{
+    u32 gfxBufferTop[8];
+    u32 gfxBufferBottom[8];
+    u16 key;
+    u16 colors;
+    u16 lastUse; // Entries are compared by age, so the clock can wrap around.
+    u8 width;
+    u8 height;
+};
+
+static EWRAM_DATA struct GlyphCacheEntry sGlyphCache[GLYPH_CACHE_SETS][GLYPH_CACHE_WAYS] = {0};
+static EWRAM_DATA u16 sGlyphCacheClock = 0;
+static EWRAM_DATA struct GlyphCacheStats sGlyphCacheStats = {0};
+static u16 sGlyphCacheColors;
+#endif
+
 const struct FontInfo *gFonts;
 bool8 gDisableTextPrinters;
 struct TextGlyph gCurGlyph;
@@ -295,6 +330,10 @@ bool16 AddTextPrinter(struct TextPrinterTemplate *printerTemplate, u8 speed, voi
     {
         --sTempTextPrinter.textSpeed;
         sTextPrinters[printerTemplate->windowId] = sTempTextPrinter;
+
+        // The printer only copies the tiles it draws, so make its first copy
+        // bring along whatever was drawn in the window before it started.
+        MarkWindowDirty(printerTemplate->windowId);
     }
     else
     {
@@ -320,6 +359,8 @@ void RunTextPrinters(void)
 {
     int i;
 
+    PROFILER_BEGIN(RunTextPrinters);
+
     if (!gDisableTextPrinters)
     {
         for (i = 0; i < WINDOWS_MAX; ++i)
@@ -330,7 +371,7 @@ void RunTextPrinters(void)
                 switch (renderCmd)
                 {
                 case RENDER_PRINT:
-                    CopyWindowToVram(sTextPrinters[i].printerTemplate.windowId, COPYWIN_GFX);
+                    CopyWindowToVram(sTextPrinters[i].printerTemplate.windowId, COPYWIN_DIRTY_GFX);
                 case RENDER_UPDATE:
                     if (sTextPrinters[i].callback != NULL)
                         sTextPrinters[i].callback(&sTextPrinters[i].printerTemplate, renderCmd);
@@ -342,6 +383,8 @@ void RunTextPrinters(void)
             }
         }
     }
+
+    PROFILER_END();
 }
 
 bool16 IsTextPrinterActive(u8 id)
@@ -371,6 +414,13 @@ void GenerateFontHalfRowLookupTable(u8 fgColor, u8 bgColor, u8 shadowColor)
     sLastTextFgColor = fgColor;
     sLastTextShadowColor = shadowColor;
 
+#ifdef GLYPH_CACHE
+    if (fgColor < 16 && bgColor < 16 && shadowColor < 16)
+        sGlyphCacheColors = GLYPH_CACHE_COLORS_VALID | fgColor | (bgColor << 4) | (shadowColor << 8);
+    else
+        sGlyphCacheColors = GLYPH_CACHE_NO_COLORS;
+#endif
+
     bg12 = bgColor << 12;
     fg12 = fgColor << 12;
     shadow12 = shadowColor << 12;
@@ -645,6 +695,9 @@ void CopyGlyphToWindow(struct TextPrinter *textPrinter)
             GLYPH_COPY(windowTiles, widthOffset, currX + 8, currY + 8, glyphPixels + 24, glyphWidth - 8, glyphHeight - 8);
         }
     }
+
+    if (glyphWidth > 0 && glyphHeight > 0)
+        MarkWindowRectDirty(textPrinter->printerTemplate.windowId, currX, currY, glyphWidth, glyphHeight);
 }
 
 void ClearTextSpan(struct TextPrinter *textPrinter, u32 width)
@@ -671,6 +724,7 @@ void ClearTextSpan(struct TextPrinter *textPrinter, u32 width)
             width,
             *glyphHeight,
             sLastTextBgColor);
+        MarkWindowRectDirty(textPrinter->printerTemplate.windowId, textPrinter->printerTemplate.currentX, textPrinter->printerTemplate.currentY, width, *glyphHeight);
     }
 }
 
@@ -828,7 +882,7 @@ void TextPrinterDrawDownArrow(struct TextPrinter *textPrinter)
                 textPrinter->printerTemplate.currentY,
                 8,
                 16);
-            CopyWindowToVram(textPrinter->printerTemplate.windowId, COPYWIN_GFX);
+            CopyWindowToVram(textPrinter->printerTemplate.windowId, COPYWIN_DIRTY_GFX);
 
             subStruct->downArrowDelay = 8;
             subStruct->downArrowYPosIdx++;
@@ -845,7 +899,7 @@ void TextPrinterClearDownArrow(struct TextPrinter *textPrinter)
         textPrinter->printerTemplate.currentY,
         8,
         16);
-    CopyWindowToVram(textPrinter->printerTemplate.windowId, COPYWIN_GFX);
+    CopyWindowToVram(textPrinter->printerTemplate.windowId, COPYWIN_DIRTY_GFX);
 }
 
 bool8 TextPrinterWaitAutoMode(struct TextPrinter *textPrinter)
@@ -925,7 +979,7 @@ void DrawDownArrow(u8 windowId, u16 x, u16 y, u8 bgColor, bool8 drawArrow, u8 *c
             }
 
             BlitBitmapRectToWindow(windowId, arrowTiles, 0, sDownArrowYCoords[*yCoordIndex & 3], 8, 16, x, y - 2, 8, 16);
-            CopyWindowToVram(windowId, COPYWIN_GFX);
+            CopyWindowToVram(windowId, COPYWIN_DIRTY_GFX);
             *counter = 8;
             ++*yCoordIndex;
         }
@@ -1121,30 +1175,7 @@ static u16 RenderText(struct TextPrinter *textPrinter)
             return RENDER_FINISH;
         }
 
-        switch (subStruct->fontId)
-        {
-        case FONT_SMALL:
-            DecompressGlyph_Small(currChar, textPrinter->japanese);
-            break;
-        case FONT_NORMAL:
-            DecompressGlyph_Normal(currChar, textPrinter->japanese);
-            break;
-        case FONT_SHORT:
-        case FONT_SHORT_COPY_1:
-        case FONT_SHORT_COPY_2:
-        case FONT_SHORT_COPY_3:
-            DecompressGlyph_Short(currChar, textPrinter->japanese);
-            break;
-        case FONT_NARROW:
-            DecompressGlyph_Narrow(currChar, textPrinter->japanese);
-            break;
-        case FONT_SMALL_NARROW:
-            DecompressGlyph_SmallNarrow(currChar, textPrinter->japanese);
-            break;
-        case FONT_BRAILLE:
-            break;
-        }
-
+        DecompressGlyph(subStruct->fontId, currChar, textPrinter->japanese);
         CopyGlyphToWindow(textPrinter);
 
         if (textPrinter->minLetterSpacing)
@@ -1173,6 +1204,7 @@ static u16 RenderText(struct TextPrinter *textPrinter)
         if (TextPrinterWaitWithDownArrow(textPrinter))
         {
             FillWindowPixelBuffer(textPrinter->printerTemplate.windowId, PIXEL_FILL(textPrinter->printerTemplate.bgColor));
+            CopyWindowToVram(textPrinter->printerTemplate.windowId, COPYWIN_DIRTY_GFX);
             textPrinter->printerTemplate.currentX = textPrinter->printerTemplate.x;
             textPrinter->printerTemplate.currentY = textPrinter->printerTemplate.y;
             textPrinter->state = RENDER_STATE_HANDLE_CHAR;
@@ -1894,6 +1926,115 @@ static u32 GetGlyphWidth_Normal(u16 glyphId, bool32 isJapanese)
         return gFontNormalLatinGlyphWidths[glyphId];
 }
 
+#ifdef GLYPH_CACHE
+// Copies the left tile column of a glyph, which is all of one that is up to 8
+// pixels wide, between the cache and gCurGlyph.
+static void CopyGlyphToCache(struct GlyphCacheEntry *entry)
+{
+    u32 i;
+
+    for (i = 0; i < 8; i++)
+    {
+        entry->gfxBufferTop[i] = gCurGlyph.gfxBufferTop[i];
+        entry->gfxBufferBottom[i] = gCurGlyph.gfxBufferBottom[i];
+    }
+    entry->width = gCurGlyph.width;
+    entry->height = gCurGlyph.height;
+}
+
+static void CopyGlyphFromCache(const struct GlyphCacheEntry *entry)
+{
+    u32 i;
+
+    for (i = 0; i < 8; i++)
+    {
+        gCurGlyph.gfxBufferTop[i] = entry->gfxBufferTop[i];
+        gCurGlyph.gfxBufferBottom[i] = entry->gfxBufferBottom[i];
+    }
+    gCurGlyph.width = entry->width;
+    gCurGlyph.height = entry->height;
+}
+#endif
+
+// Puts a glyph into gCurGlyph in the current text colors, from the glyph
+// cache if it's there.
+static void DecompressGlyph(u32 fontId, u16 glyphId, bool32 isJapanese)
+{
+#ifdef GLYPH_CACHE
+    struct GlyphCacheEntry *set = sGlyphCache[glyphId % GLYPH_CACHE_SETS];
+    struct GlyphCacheEntry *entry = set;
+    u32 key = GLYPH_CACHE_KEY(fontId, glyphId, isJapanese == TRUE);
+    u32 colors = sGlyphCacheColors;
+    u32 i;
+
+    if (colors != GLYPH_CACHE_NO_COLORS)
+    {
+        for (i = 0; i < GLYPH_CACHE_WAYS; i++)
+        {
+            if (set[i].key == key && set[i].colors == colors)
+            {
+                set[i].lastUse = ++sGlyphCacheClock;
+                sGlyphCacheStats.hits++;
+                CopyGlyphFromCache(&set[i]);
+                return;
+            }
+            if ((u16)(sGlyphCacheClock - set[i].lastUse) > (u16)(sGlyphCacheClock - entry->lastUse))
+                entry = &set[i];
+        }
+    }
+#endif
+
+    switch (fontId)
+    {
+    case FONT_SMALL:
+        DecompressGlyph_Small(glyphId, isJapanese);
+        break;
+    case FONT_NORMAL:
+        DecompressGlyph_Normal(glyphId, isJapanese);
+        break;
+    case FONT_SHORT:
+    case FONT_SHORT_COPY_1:
+    case FONT_SHORT_COPY_2:
+    case FONT_SHORT_COPY_3:
+        DecompressGlyph_Short(glyphId, isJapanese);
+        break;
+    case FONT_NARROW:
+        DecompressGlyph_Narrow(glyphId, isJapanese);
+        break;
+    case FONT_SMALL_NARROW:
+        DecompressGlyph_SmallNarrow(glyphId, isJapanese);
+        break;
+    default:
+        return;
+    }
+
+#ifdef GLYPH_CACHE
+    if (colors != GLYPH_CACHE_NO_COLORS)
+    {
+        sGlyphCacheStats.misses++;
+        if (gCurGlyph.width <= 8)
+        {
+            entry->key = key;
+            entry->colors = colors;
+            entry->lastUse = ++sGlyphCacheClock;
+            CopyGlyphToCache(entry);
+        }
+    }
+#endif
+}
+
+#ifdef GLYPH_CACHE
+void GetGlyphCacheStats(struct GlyphCacheStats *stats)
+{
+    *stats = sGlyphCacheStats;
+}
+
+void ResetGlyphCacheStats(void)
+{
+    CpuFill32(0, &sGlyphCacheStats, sizeof(sGlyphCacheStats));
+}
+#endif
+
 static void DecompressGlyph_Bold(u16 glyphId)
 {
     const u16 *glyphs;
@@ -130,6 +130,14 @@ struct TextGlyph
     u8 height;
 };
 
+#ifdef GLYPH_CACHE
+struct GlyphCacheStats
+{
+    u32 hits;
+    u32 misses;
+};
+#endif
+
 extern TextFlags gTextFlags;
 
 extern u8 gDisableTextPrinters;
@@ -163,6 +171,10 @@ u8 GetKeypadIconHeight(u8 keypadIconId);
 void SetDefaultFontsPointer(void);
 u8 GetFontAttribute(u8 fontId, u8 attributeId);
 u8 GetMenuCursorDimensionByFont(u8 fontId, u8 whichDimension);
+#ifdef GLYPH_CACHE
+void GetGlyphCacheStats(struct GlyphCacheStats *stats);
+void ResetGlyphCacheStats(void);
+#endif
 
 // braille.c
 u16 FontFunc_Braille(struct TextPrinter *textPrinter);
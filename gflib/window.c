@@ -3,6 +3,7 @@
 #include "malloc.h"
 #include "bg.h"
 #include "blit.h"
+#include "dma3.h"
 
 // This global is set to 0 and never changed.
 u8 gTransparentTileNumber;
@@ -13,6 +14,19 @@ EWRAM_DATA struct Window gWindows[WINDOWS_MAX] = {0};
 EWRAM_DATA static struct Window* sWindowPtr = NULL;
 EWRAM_DATA static u16 sWindowSize = 0;
 
+// The tiles of each window that changed since COPYWIN_DIRTY_GFX last copied
+// them to VRAM. right and bottom are exclusive, and right is 0 when nothing
+// changed.
+struct WindowDirtyRect
+{
+    u8 left;
+    u8 top;
+    u8 right;
+    u8 bottom;
+};
+
+EWRAM_DATA static struct WindowDirtyRect sWindowDirtyRects[WINDOWS_MAX] = {0};
+
 static u8 GetNumActiveWindowsOnBg(u8 bgId);
 static u8 GetNumActiveWindowsOnBg8Bit(u8 bgId);
 
@@ -94,6 +108,7 @@ bool16 InitWindows(const struct WindowTemplate *templates)
 
         gWindows[i].tileData = allocatedTilemapBuffer;
         gWindows[i].window = templates[i];
+        MarkWindowDirty(i);
 
         if (gWindowTileAutoAllocEnabled == TRUE)
         {
@@ -168,6 +183,7 @@ u16 AddWindow(const struct WindowTemplate *template)
 
     gWindows[win].tileData = allocatedTilemapBuffer;
     gWindows[win].window = *template;
+    MarkWindowDirty(win);
 
     if (gWindowTileAutoAllocEnabled == TRUE)
     {
@@ -263,6 +279,90 @@ void FreeAllWindowBuffers(void)
     }
 }
 
+// Adds a rectangle of pixels to the part of a window that COPYWIN_DIRTY_GFX
+// copies. Anything that writes a window's tiles without going through the
+// functions here or the text printers has to call this.
+void MarkWindowRectDirty(u8 windowId, u16 x, u16 y, u16 width, u16 height)
+{
+    struct WindowDirtyRect *rect = &sWindowDirtyRects[windowId];
+    u32 left = x / 8;
+    u32 top = y / 8;
+    u32 right = (x + width + 7) / 8;
+    u32 bottom = (y + height + 7) / 8;
+
+    if (right > gWindows[windowId].window.width)
+        right = gWindows[windowId].window.width;
+    if (bottom > gWindows[windowId].window.height)
+        bottom = gWindows[windowId].window.height;
+    if (width == 0 || height == 0 || left >= right || top >= bottom)
+        return;
+
+    if (rect->right == 0)
+    {
+        rect->left = left;
+        rect->top = top;
+        rect->right = right;
+        rect->bottom = bottom;
+    }
+    else
+    {
+        if (left < rect->left)
+            rect->left = left;
+        if (top < rect->top)
+            rect->top = top;
+        if (right > rect->right)
+            rect->right = right;
+        if (bottom > rect->bottom)
+            rect->bottom = bottom;
+    }
+}
+
+void MarkWindowDirty(u8 windowId)
+{
+    MarkWindowRectDirty(windowId, 0, 0, gWindows[windowId].window.width * 8, gWindows[windowId].window.height * 8);
+}
+
+// Copies the dirty tiles to VRAM. When the tiles between the dirty rows are
+// no more than the dirty ones, the rows go in one request that copies those
+// as well; otherwise they go one row at a time, so a few letters in a wide
+// text box don't drag the rest of their rows along. Rows that don't fit in
+// the DMA queue stay dirty for the next copy.
+static void CopyWindowDirtyRectToVram(u8 windowId)
+{
+    struct Window *window = &gWindows[windowId];
+    struct WindowDirtyRect *rect = &sWindowDirtyRects[windowId];
+    u32 width = window->window.width;
+    u32 rowSize, tile, y;
+
+    if (rect->right == 0)
+        return;
+
+    tile = rect->top * width + rect->left;
+    rowSize = rect->right - rect->left;
+
+    if (width - rowSize <= rowSize)
+    {
+        // Rows are next to each other in the window and in VRAM.
+        u32 size = (rect->bottom - rect->top - 1) * width + rowSize;
+
+        if (LoadBgTilesWithPriority(window->window.bg, window->tileData + tile * 32, size * 32, window->window.baseBlock + tile, DMA3_PRIORITY_WINDOW) == (u16)-1)
+            return;
+    }
+    else
+    {
+        for (y = rect->top; y < rect->bottom; y++, tile += width)
+        {
+            if (LoadBgTilesWithPriority(window->window.bg, window->tileData + tile * 32, rowSize * 32, window->window.baseBlock + tile, DMA3_PRIORITY_WINDOW) == (u16)-1)
+            {
+                rect->top = y;
+                return;
+            }
+        }
+    }
+
+    rect->right = 0;
+}
+
 void CopyWindowToVram(u8 windowId, u8 mode)
 {
     struct Window windowLocal = gWindows[windowId];
@@ -274,12 +374,17 @@ void CopyWindowToVram(u8 windowId, u8 mode)
         CopyBgTilemapBufferToVram(windowLocal.window.bg);
         break;
     case COPYWIN_GFX:
-        LoadBgTiles(windowLocal.window.bg, windowLocal.tileData, windowSize, windowLocal.window.baseBlock);
+        if (LoadBgTilesWithPriority(windowLocal.window.bg, windowLocal.tileData, windowSize, windowLocal.window.baseBlock, DMA3_PRIORITY_WINDOW) != (u16)-1)
+            sWindowDirtyRects[windowId].right = 0;
         break;
     case COPYWIN_FULL:
-        LoadBgTiles(windowLocal.window.bg, windowLocal.tileData, windowSize, windowLocal.window.baseBlock);
+        if (LoadBgTilesWithPriority(windowLocal.window.bg, windowLocal.tileData, windowSize, windowLocal.window.baseBlock, DMA3_PRIORITY_WINDOW) != (u16)-1)
+            sWindowDirtyRects[windowId].right = 0;
         CopyBgTilemapBufferToVram(windowLocal.window.bg);
         break;
+    case COPYWIN_DIRTY_GFX:
+        CopyWindowDirtyRectToVram(windowId);
+        break;
     }
 }
 
@@ -306,10 +411,10 @@ void CopyWindowRectToVram(u32 windowId, u32 mode, u32 x, u32 y, u32 w, u32 h)
             CopyBgTilemapBufferToVram(windowLocal.window.bg);
             break;
         case COPYWIN_GFX:
-            LoadBgTiles(windowLocal.window.bg, windowLocal.tileData + (rectPos * 32), rectSize, windowLocal.window.baseBlock + rectPos);
+            LoadBgTilesWithPriority(windowLocal.window.bg, windowLocal.tileData + (rectPos * 32), rectSize, windowLocal.window.baseBlock + rectPos, DMA3_PRIORITY_WINDOW);
             break;
         case COPYWIN_FULL:
-            LoadBgTiles(windowLocal.window.bg, windowLocal.tileData + (rectPos * 32), rectSize, windowLocal.window.baseBlock + rectPos);
+            LoadBgTilesWithPriority(windowLocal.window.bg, windowLocal.tileData + (rectPos * 32), rectSize, windowLocal.window.baseBlock + rectPos, DMA3_PRIORITY_WINDOW);
             CopyBgTilemapBufferToVram(windowLocal.window.bg);
             break;
         }
@@ -409,6 +514,7 @@ void BlitBitmapRectToWindow(u8 windowId, const u8 *pixels, u16 srcX, u16 srcY, u
     destRect.height = 8 * gWindows[windowId].window.height;
 
     BlitBitmapRect4Bit(&sourceRect, &destRect, srcX, srcY, destX, destY, rectWidth, rectHeight, 0);
+    MarkWindowRectDirty(windowId, destX, destY, rectWidth, rectHeight);
 }
 
 static void BlitBitmapRectToWindowWithColorKey(u8 windowId, const u8 *pixels, u16 srcX, u16 srcY, u16 srcWidth, int srcHeight, u16 destX, u16 destY, u16 rectWidth, u16 rectHeight, u8 colorKey)
@@ -425,6 +531,7 @@ static void BlitBitmapRectToWindowWithColorKey(u8 windowId, const u8 *pixels, u1
     destRect.height = 8 * gWindows[windowId].window.height;
 
     BlitBitmapRect4Bit(&sourceRect, &destRect, srcX, srcY, destX, destY, rectWidth, rectHeight, colorKey);
+    MarkWindowRectDirty(windowId, destX, destY, rectWidth, rectHeight);
 }
 
 void FillWindowPixelRect(u8 windowId, u8 fillValue, u16 x, u16 y, u16 width, u16 height)
@@ -436,6 +543,7 @@ void FillWindowPixelRect(u8 windowId, u8 fillValue, u16 x, u16 y, u16 width, u16
     pixelRect.height = 8 * gWindows[windowId].window.height;
 
     FillBitmapRect4Bit(&pixelRect, x, y, width, height, fillValue);
+    MarkWindowRectDirty(windowId, x, y, width, height);
 }
 
 void CopyToWindowPixelBuffer(u8 windowId, const void *src, u16 size, u16 tileOffset)
@@ -444,6 +552,7 @@ void CopyToWindowPixelBuffer(u8 windowId, const void *src, u16 size, u16 tileOff
         CpuCopy16(src, gWindows[windowId].tileData + (32 * tileOffset), size);
     else
         LZ77UnCompWram(src, gWindows[windowId].tileData + (32 * tileOffset));
+    MarkWindowDirty(windowId);
 }
 
 // Sets all pixels within the window to the fillValue color.
@@ -451,6 +560,7 @@ void FillWindowPixelBuffer(u8 windowId, u8 fillValue)
 {
     int fillSize = gWindows[windowId].window.width * gWindows[windowId].window.height;
     CpuFastFill8(fillValue, gWindows[windowId].tileData, 32 * fillSize);
+    MarkWindowDirty(windowId);
 }
 
 #define MOVE_TILES_DOWN(a)                                                      \
@@ -520,6 +630,7 @@ void ScrollWindow(u8 windowId, u8 direction, u8 distance, u8 fillValue)
     case 2:
         break;
     }
+    MarkWindowDirty(windowId);
 }
 
 void CallWindowFunction(u8 windowId, void ( *func)(u8, u8, u8, u8, u8, u8))
@@ -543,9 +654,11 @@ bool8 SetWindowAttribute(u8 windowId, u8 attributeId, u32 value)
         return FALSE;
     case WINDOW_BASE_BLOCK:
         gWindows[windowId].window.baseBlock = value;
+        MarkWindowDirty(windowId);
         return FALSE;
     case WINDOW_TILE_DATA:
         gWindows[windowId].tileData = (u8 *)(value);
+        MarkWindowDirty(windowId);
         return TRUE;
     case WINDOW_BG:
     case WINDOW_WIDTH:
@@ -574,6 +687,8 @@ u32 GetWindowAttribute(u8 windowId, u8 attributeId)
     case WINDOW_BASE_BLOCK:
         return gWindows[windowId].window.baseBlock;
     case WINDOW_TILE_DATA:
+        // The caller is probably going to draw in it.
+        MarkWindowDirty(windowId);
         return (u32)(gWindows[windowId].tileData);
     default:
         return 0;
@@ -692,10 +807,10 @@ void CopyWindowToVram8Bit(u8 windowId, u8 mode)
         CopyBgTilemapBufferToVram(sWindowPtr->window.bg);
         break;
     case COPYWIN_GFX:
-        LoadBgTiles(sWindowPtr->window.bg, sWindowPtr->tileData, sWindowSize, sWindowPtr->window.baseBlock);
+        LoadBgTilesWithPriority(sWindowPtr->window.bg, sWindowPtr->tileData, sWindowSize, sWindowPtr->window.baseBlock, DMA3_PRIORITY_WINDOW);
         break;
     case COPYWIN_FULL:
-        LoadBgTiles(sWindowPtr->window.bg, sWindowPtr->tileData, sWindowSize, sWindowPtr->window.baseBlock);
+        LoadBgTilesWithPriority(sWindowPtr->window.bg, sWindowPtr->tileData, sWindowSize, sWindowPtr->window.baseBlock, DMA3_PRIORITY_WINDOW);
         CopyBgTilemapBufferToVram(sWindowPtr->window.bg);
         break;
     }
@@ -22,6 +22,7 @@ enum {
     COPYWIN_MAP,
     COPYWIN_GFX,
     COPYWIN_FULL,
+    COPYWIN_DIRTY_GFX, // Only the tiles drawn since the last copy. CopyWindowToVram only.
 };
 
 struct WindowTemplate
@@ -55,6 +56,8 @@ void RemoveWindow(u8 windowId);
 void FreeAllWindowBuffers(void);
 void CopyWindowToVram(u8 windowId, u8 mode);
 void CopyWindowRectToVram(u32 windowId, u32 mode, u32 x, u32 y, u32 w, u32 h);
+void MarkWindowRectDirty(u8 windowId, u16 x, u16 y, u16 width, u16 height);
+void MarkWindowDirty(u8 windowId);
 void PutWindowTilemap(u8 windowId);
 void PutWindowRectTilemapOverridePalette(u8 windowId, u8 x, u8 y, u8 width, u8 height, u8 palette);
 void ClearWindowTilemap(u8 windowId);
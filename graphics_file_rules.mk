@@ -61,6 +61,17 @@ $(CASTFORMGFXDIR)/shiny.gbapal: $(CASTFORMGFXDIR)/shiny_normal_form.gbapal \
 
 
 
+### Pokémon pics ###
+
+# Front, back and animated front pics are only used compressed, so convert
+# them straight from .png to .4bpp.lz without an intermediate .4bpp file.
+MONPICS := $(patsubst %.png,%.4bpp.lz,$(wildcard graphics/pokemon/*/front.png graphics/pokemon/*/back.png graphics/pokemon/*/anim_front.png))
+
+$(MONPICS): %.4bpp.lz: %.png
+	$(GFX) $< $@
+
+
+
 ### Tilesets ###
 
 $(TILESETGFXDIR)/secondary/petalburg/tiles.4bpp: %.4bpp: %.png
@@ -0,0 +1,47 @@
+# Host build of the engine hot paths, for timing them without an emulator.
+# "make host-bench" compiles the engine files below and the benchmarks in
+# host_bench/ for the machine running make, then runs the benchmarks. Options
+# for the benchmark program can be passed with HOST_BENCH_ARGS, e.g.
+#   make host-bench HOST_BENCH_ARGS=--filter=RenderText
+#
+# The engine files are built with HOST_BUILD defined, which only changes how
+# DMA transfers are done (see include/gba/macro.h). What they need from the
+# rest of the game comes from host_bench/stubs.c.
+
+HOST_CC ?= cc
+HOST_BENCH_BUILDDIR := $(dir $(HOST_BENCH))
+
+HOST_BENCH_ENGINE_SRCS := $(addprefix $(GFLIB_SUBDIR)/,bit_util.c malloc.c sprite.c text.c window.c bg.c blit.c dma3_manager.c gpu_regs.c string_util.c) \
+                          $(addprefix $(C_SUBDIR)/,task.c palette.c util.c fonts.c)
+HOST_BENCH_SRCS := $(HOST_BENCH_ENGINE_SRCS) $(wildcard host_bench/*.c)
+HOST_BENCH_OBJS := $(patsubst %.c,$(HOST_BENCH_BUILDDIR)%.o,$(HOST_BENCH_SRCS))
+
+HOST_BENCH_CPPFLAGS := -iquote include -iquote $(GFLIB_SUBDIR) -Wno-trigraphs -DMODERN=1 -DHOST_BUILD
+# The engine sources have unused statics and mix char/u8 pointers as they came
+# out of the decompilation; everything else -Wall flags is worth seeing.
+HOST_BENCH_CFLAGS := -O2 -g -std=gnu99 -Wall -Wno-unused-function -Wno-unused-variable -Wno-pointer-sign -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast
+# The engine keeps pointers in 32-bit variables in a few places (e.g. the task
+# follow-up functions), which only works if everything is linked low.
+HOST_BENCH_LDFLAGS := -no-pie
+
+# preproc reads the INCBIN data, so it has to be built first. Only scan for it
+# when the bench is actually being built, so other builds don't pay for it.
+ifneq (,$(filter host-bench $(HOST_BENCH),$(MAKECMDGOALS)))
+define HOST_BENCH_INCBIN_DEPS
+$(HOST_BENCH_BUILDDIR)$(1:.c=.o): $(shell sed -n 's/.*INCBIN_[SU][0-9]*("\([^"]*\)").*/\1/p' $(1))
+endef
+$(foreach src,$(HOST_BENCH_ENGINE_SRCS),$(eval $(call HOST_BENCH_INCBIN_DEPS,$(src))))
+endif
+
+$(HOST_BENCH_BUILDDIR)%.o: %.c | $(CHARMAP)
+	@mkdir -p $(@D)
+	$(HOST_CC) -E $(HOST_BENCH_CPPFLAGS) -MMD -MP -MT $@ -MF $(@:.o=.d) $< | $(PREPROC) $< $(CHARMAP) -i | $(HOST_CC) $(HOST_BENCH_CFLAGS) -x c -c -o $@ -
+
+$(HOST_BENCH): $(HOST_BENCH_OBJS)
+	$(HOST_CC) $(HOST_BENCH_LDFLAGS) -o $@ $^
+
+host-bench: tools
+	@$(MAKE) $(HOST_BENCH)
+	$(HOST_BENCH) $(HOST_BENCH_ARGS)
+
+-include $(HOST_BENCH_OBJS:.o=.d)
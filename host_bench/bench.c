@@ -0,0 +1,122 @@
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "global.h"
+#include "host.h"
+#include "bench.h"
+
+// Runs the benchmarks in gBenchmarks the way Google Benchmark does: each case
+// is run with more and more iterations until one run takes at least the
+// minimum time, and the time per iteration of that run is reported.
+
+#define MAX_ITERATIONS 1000000000
+
+static double GetTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double TimeRun(const struct Benchmark *benchmark, u32 iterations)
+{
+    double start;
+
+    if (benchmark->setUp != NULL)
+        benchmark->setUp();
+
+    start = GetTime();
+    benchmark->run(iterations);
+    return GetTime() - start;
+}
+
+static void RunBenchmark(const struct Benchmark *benchmark, double minTime)
+{
+    u32 iterations = 1;
+    double elapsed;
+
+    for (;;)
+    {
+        double multiplier;
+
+        elapsed = TimeRun(benchmark, iterations);
+
+        if (elapsed >= minTime || iterations >= MAX_ITERATIONS)
+            break;
+
+        // Aim a bit past the minimum time, but don't grow by more than 10x
+        // at a time when the last run was too short to tell much.
+        multiplier = elapsed / minTime > 0.1 ? minTime * 1.4 / elapsed : 10.0;
+
+        if (iterations * multiplier >= MAX_ITERATIONS)
+            iterations = MAX_ITERATIONS;
+        else
+            iterations = iterations * multiplier + 1;
+    }
+
+    printf("%-36s %13.1f ns %14u\n", benchmark->name, elapsed * 1e9 / iterations, iterations);
+    fflush(stdout);
+}
+
+static void PrintUsage(void)
+{
+    fputs("Usage: bench [--filter=REGEX] [--min-time=SECONDS] [--list]\n"
+          "--filter only runs the benchmarks whose name matches REGEX\n"
+          "--min-time is how long each benchmark runs at least (default: 0.5)\n"
+          "--list prints the benchmark names without running them\n",
+          stderr);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    double minTime = 0.5;
+    bool32 listOnly = FALSE;
+    regex_t regex;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--filter=", 9) == 0)
+            filter = argv[i] + 9;
+        else if (strncmp(argv[i], "--min-time=", 11) == 0)
+            minTime = atof(argv[i] + 11);
+        else if (strcmp(argv[i], "--list") == 0)
+            listOnly = TRUE;
+        else
+            PrintUsage();
+    }
+
+    if (minTime <= 0)
+        PrintUsage();
+
+    if (filter != NULL && regcomp(&regex, filter, REG_EXTENDED | REG_NOSUB) != 0)
+    {
+        fprintf(stderr, "error: invalid filter \"%s\"\n", filter);
+        return 1;
+    }
+
+    HostInitMemory();
+
+    if (!listOnly)
+    {
+        printf("%-36s %16s %14s\n", "Benchmark", "Time", "Iterations");
+        printf("%.68s\n", "--------------------------------------------------------------------------------");
+    }
+
+    for (i = 0; gBenchmarks[i].name != NULL; i++)
+    {
+        if (filter != NULL && regexec(&regex, gBenchmarks[i].name, 0, NULL, 0) != 0)
+            continue;
+
+        if (listOnly)
+            puts(gBenchmarks[i].name);
+        else
+            RunBenchmark(&gBenchmarks[i], minTime);
+    }
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef GUARD_BENCH_H
+#define GUARD_BENCH_H
+
+// One benchmark case. setUp runs before each timed run and may be NULL.
+// run does the measured operation `iterations` times, so the reported time
+// is the time of one operation.
+struct Benchmark
+{
+    const char *name;
+    void (*setUp)(void);
+    void (*run)(u32 iterations);
+};
+
+// Terminated by an entry with a NULL name.
+extern const struct Benchmark gBenchmarks[];
+
+#endif // GUARD_BENCH_H
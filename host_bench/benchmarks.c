@@ -0,0 +1,541 @@
+#include "global.h"
+#include "bg.h"
+#include "dma3.h"
+#include "malloc.h"
+#include "main.h"
+#include "palette.h"
+#include "sprite.h"
+#include "task.h"
+#include "text.h"
+#include "window.h"
+#include "constants/rgb.h"
+#include "bench.h"
+
+// The benchmark cases. Each one sets up a typical scene for one engine
+// routine; the numbers are meant for comparing changes to that routine, not
+// for predicting GBA cycle counts.
+
+#define TAG_BENCH_SPRITE 0x1000
+
+static u32 sRandom;
+
+static u32 Random32(void)
+{
+    sRandom = sRandom * 1103515245 + 24691;
+    return sRandom >> 16;
+}
+
+// malloc.c
+
+static const u16 sAllocSizes[] = {16, 64, 24, 256, 8, 128, 40, 512};
+
+static void *sLiveBlocks[256];
+
+static void SetUp_Heap(void)
+{
+    InitHeap(gHeap, HEAP_SIZE);
+}
+
+static void Run_AllocFree(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        Free(Alloc(sAllocSizes[i % ARRAY_COUNT(sAllocSizes)]));
+}
+
+// Leaves a free block between each pair of live ones, so allocations that
+// don't fit in the holes have to walk past all of them.
+static void SetUp_FragmentedHeap(void)
+{
+    u32 i;
+
+    InitHeap(gHeap, HEAP_SIZE);
+
+    for (i = 0; i < ARRAY_COUNT(sLiveBlocks); i++)
+        sLiveBlocks[i] = Alloc(sAllocSizes[i % 4]);
+    for (i = 0; i < ARRAY_COUNT(sLiveBlocks); i += 2)
+        Free(sLiveBlocks[i]);
+}
+
+static void Run_AllocFreeLarge(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        Free(Alloc(1024));
+}
+
+// Like entering a menu: a screen allocates its buffers while blocks of
+// earlier screens are still around, then frees them all when it closes.
+static const u16 sScreenAllocSizes[] = {0x800, 0x2000, 60, 0x1000, 12, 0x800, 200, 32, 0x800, 600, 16, 0x400};
+
+static void SetUp_ScreenHeap(void)
+{
+    u32 i;
+
+    SetUp_FragmentedHeap();
+    for (i = 1; i < ARRAY_COUNT(sLiveBlocks); i += 4)
+        Free(sLiveBlocks[i]);
+}
+
+static void Run_AllocFreeScreen(u32 iterations)
+{
+    void *blocks[ARRAY_COUNT(sScreenAllocSizes) * 3];
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < ARRAY_COUNT(blocks); j++)
+            blocks[j] = Alloc(sScreenAllocSizes[j % ARRAY_COUNT(sScreenAllocSizes)]);
+        for (j = 0; j < ARRAY_COUNT(blocks); j++)
+            Free(blocks[j]);
+    }
+}
+
+// The Pokédex pages' BG tilemap buffers, allocated one by one and from an
+// arena.
+static void Run_AllocFreeTilemaps(u32 iterations)
+{
+    void *blocks[4];
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < ARRAY_COUNT(blocks); j++)
+            blocks[j] = AllocZeroed(BG_SCREEN_SIZE);
+        for (j = 0; j < ARRAY_COUNT(blocks); j++)
+            Free(blocks[j]);
+    }
+}
+
+static void Run_ArenaTilemaps(u32 iterations)
+{
+    struct Arena *arena;
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        arena = ArenaBegin(4 * BG_SCREEN_SIZE);
+        for (j = 0; j < 4; j++)
+            ArenaAllocZeroed(arena, BG_SCREEN_SIZE);
+        ArenaEnd(arena);
+    }
+}
+
+// sprite.c
+
+static const u8 sSpriteTiles[TILE_SIZE_4BPP * 4];
+
+static const struct SpriteSheet sSpriteSheet = {sSpriteTiles, sizeof(sSpriteTiles), TAG_BENCH_SPRITE};
+
+static const struct OamData sOam_16x16 =
+{
+    .shape = SPRITE_SHAPE(16x16),
+    .size = SPRITE_SIZE(16x16),
+};
+
+static const struct SpriteTemplate sSpriteTemplate =
+{
+    .tileTag = TAG_BENCH_SPRITE,
+    .paletteTag = TAG_NONE,
+    .oam = &sOam_16x16,
+    .anims = gDummySpriteAnimTable,
+    .images = NULL,
+    .affineAnims = gDummySpriteAffineAnimTable,
+    .callback = SpriteCallbackDummy,
+};
+
+static void CreateSprites(u32 count)
+{
+    u32 i;
+
+    sRandom = 0;
+    ResetSpriteData();
+    LoadSpriteSheet(&sSpriteSheet);
+
+    for (i = 0; i < count; i++)
+    {
+        u8 spriteId = CreateSprite(&sSpriteTemplate, Random32() % DISPLAY_WIDTH, Random32() % DISPLAY_HEIGHT, Random32() % 256);
+
+        gSprites[spriteId].oam.priority = Random32() % 4;
+    }
+}
+
+static void SetUp_16Sprites(void)
+{
+    CreateSprites(16);
+}
+
+static void SetUp_64Sprites(void)
+{
+    CreateSprites(64);
+}
+
+static void Run_BuildOamBuffer(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        BuildOamBuffer();
+}
+
+// Moves every sprite before each rebuild, so SortSprites can't rely on the
+// order of the last frame.
+static void Run_BuildOamBufferMoving(u32 iterations)
+{
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < MAX_SPRITES; j++)
+        {
+            if (gSprites[j].inUse)
+                gSprites[j].y = Random32() % DISPLAY_HEIGHT;
+        }
+        BuildOamBuffer();
+    }
+}
+
+#define TAG_BENCH_SHEETS 0x2000
+#define NUM_BENCH_SHEETS 48
+
+static const u8 sSheetTiles[TILE_SIZE_4BPP * 32];
+
+static void LoadBenchSheet(u16 tag, u16 numTiles)
+{
+    struct SpriteSheet sheet;
+
+    sheet.data = sSheetTiles;
+    sheet.size = numTiles * TILE_SIZE_4BPP;
+    sheet.tag = tag;
+    LoadSpriteSheet(&sheet);
+}
+
+// Fills OBJ VRAM with sheets of different sizes, then frees every other one,
+// like a battle scene after a few move animations.
+static void SetUp_FragmentedSpriteTiles(void)
+{
+    u32 i;
+
+    sRandom = 0;
+    ResetSpriteData();
+    for (i = 0; i < NUM_BENCH_SHEETS; i++)
+        LoadBenchSheet(TAG_BENCH_SHEETS + i, 4 + Random32() % 16);
+    for (i = 0; i < NUM_BENCH_SHEETS; i += 2)
+        FreeSpriteTilesByTag(TAG_BENCH_SHEETS + i);
+}
+
+static void Run_LoadFreeSpriteSheet(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        LoadBenchSheet(TAG_BENCH_SPRITE, 8 + i % 16);
+        FreeSpriteTilesByTag(TAG_BENCH_SPRITE);
+    }
+}
+
+// 64 sprites with the same priority and subpriority, like a crowd of object
+// events, so only their y decides the order.
+static void SetUp_64SpritesSamePriority(void)
+{
+    u32 i;
+
+    CreateSprites(64);
+    for (i = 0; i < MAX_SPRITES; i++)
+    {
+        gSprites[i].oam.priority = 2;
+        gSprites[i].subpriority = 0;
+    }
+    BuildOamBuffer();
+}
+
+// Moves 4 sprites before each rebuild, like a menu with a few animated icons.
+static void Run_BuildOamBufferFewMoving(u32 iterations)
+{
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < 4; j++)
+            gSprites[Random32() % MAX_SPRITES].y = Random32() % DISPLAY_HEIGHT;
+        BuildOamBuffer();
+    }
+}
+
+// Flips every sprite vertically before each rebuild, which reverses the order
+// of sprites with the same priority. That's the worst case for an insertion
+// sort.
+static void Run_BuildOamBufferFlipped(u32 iterations)
+{
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < MAX_SPRITES; j++)
+            gSprites[j].y = DISPLAY_HEIGHT - 1 - gSprites[j].y;
+        BuildOamBuffer();
+    }
+}
+
+// A frame of the main loop and VBlank handler with nothing on screen
+// changing, like a menu waiting for input.
+static void Run_BuildAndLoadOam(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        BuildOamBuffer();
+        LoadOam();
+    }
+}
+
+// Like above, but with one sprite moving, like a cursor.
+static void Run_BuildAndLoadOamOneMoving(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        gSprites[0].x = i % DISPLAY_WIDTH;
+        BuildOamBuffer();
+        LoadOam();
+    }
+}
+
+// text.c
+
+static const struct BgTemplate sBgTemplate =
+{
+    .bg = 0,
+    .charBaseIndex = 0,
+    .mapBaseIndex = 31,
+    .screenSize = 0,
+    .paletteMode = 0,
+    .priority = 0,
+    .baseTile = 0,
+};
+
+static const struct WindowTemplate sWindowTemplates[] =
+{
+    {
+        .bg = 0,
+        .tilemapLeft = 1,
+        .tilemapTop = 15,
+        .width = 28,
+        .height = 4,
+        .paletteNum = 15,
+        .baseBlock = 1,
+    },
+    {
+        .bg = 0,
+        .tilemapLeft = 1,
+        .tilemapTop = 1,
+        .width = 28,
+        .height = 12,
+        .paletteNum = 15,
+        .baseBlock = 113,
+    },
+    DUMMY_WIN_TEMPLATE
+};
+
+static const u8 sText_Sentence[] = _("The quick brown fox jumps over the lazy dog.");
+static const u8 sText_Glyph[] = _("W");
+static const u8 sText_Page[] = _(
+    "The quick brown fox jumps over the lazy\n"
+    "dog. Pack my box with five dozen liquor\n"
+    "jugs. How vexingly quick daft zebras\n"
+    "jump! The five boxing wizards jump\n"
+    "quickly. Sphinx of black quartz, judge\n"
+    "my vow. Waltz, bad nymph, for quick jigs.");
+
+static struct TextPrinter sTextPrinter;
+
+static void SetUp_Window(void)
+{
+    InitHeap(gHeap, HEAP_SIZE);
+    InitBgsFromTemplates(0, &sBgTemplate, 1);
+    InitWindows(sWindowTemplates);
+    DeactivateAllTextPrinters();
+    SetDefaultFontsPointer();
+}
+
+static void Run_RenderTextNormal(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        AddTextPrinterParameterized(0, FONT_NORMAL, sText_Sentence, 0, 1, TEXT_SKIP_DRAW, NULL);
+}
+
+static void Run_RenderTextSmall(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        AddTextPrinterParameterized(0, FONT_SMALL, sText_Sentence, 0, 1, TEXT_SKIP_DRAW, NULL);
+}
+
+// Clears a whole text box and prints a page of text in it, the way menus
+// redraw after a change.
+static void Run_RenderTextPage(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        FillWindowPixelBuffer(1, PIXEL_FILL(1));
+        AddTextPrinterParameterized(1, FONT_NORMAL, sText_Page, 0, 1, TEXT_SKIP_DRAW, NULL);
+    }
+}
+
+static void SetUp_TextPrinter(void)
+{
+    SetUp_Window();
+    ClearDma3Requests();
+    FillWindowPixelBuffer(1, PIXEL_FILL(1));
+    CopyWindowToVram(1, COPYWIN_GFX);
+    ProcessDma3Requests();
+}
+
+// One frame of a text printer typing out a page, including copying what it
+// drew to VRAM.
+static void Run_TextPrinterFrame(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (!IsTextPrinterActive(1))
+            AddTextPrinterParameterized(1, FONT_NORMAL, sText_Page, 0, 1, 1, NULL);
+        RunTextPrinters();
+        ProcessDma3Requests();
+    }
+}
+
+// Renders one character so that gCurGlyph holds a glyph to copy.
+static void SetUp_Glyph(void)
+{
+    SetUp_Window();
+    AddTextPrinterParameterized(0, FONT_NORMAL, sText_Glyph, 0, 1, TEXT_SKIP_DRAW, NULL);
+    sTextPrinter.printerTemplate.windowId = 0;
+    sTextPrinter.printerTemplate.currentY = 1;
+}
+
+static void Run_CopyGlyphToWindow(u32 iterations)
+{
+    u32 i;
+
+    // Walk the glyph across the window, so it lands at every alignment
+    // within a tile.
+    for (i = 0; i < iterations; i++)
+    {
+        sTextPrinter.printerTemplate.currentX = i % (sWindowTemplates[0].width * 8 - 16);
+        CopyGlyphToWindow(&sTextPrinter);
+    }
+}
+
+// task.c
+
+static void Task_Bench(u8 taskId)
+{
+    gTasks[taskId].data[0]++;
+}
+
+static void SetUp_16Tasks(void)
+{
+    u32 i;
+
+    sRandom = 0;
+    ResetTasks();
+    for (i = 0; i < 16; i++)
+        CreateTask(Task_Bench, Random32() % 256);
+}
+
+static void Run_RunTasks(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+        RunTasks();
+}
+
+// palette.c
+
+static void SetUp_PaletteFade(void)
+{
+    u32 i;
+
+    sRandom = 0;
+    ResetPaletteFade();
+    for (i = 0; i < PLTT_BUFFER_SIZE; i++)
+        gPlttBufferUnfaded[i] = Random32() & 0x7FFF;
+    BeginNormalPaletteFade(PALETTES_ALL, 0, 0, 16, RGB_BLACK);
+}
+
+// One frame of a fade of all palettes. The faded buffer is copied to palette
+// RAM each frame like the VBlank callback does, since the fade waits for it.
+static void Run_UpdatePaletteFade(u32 iterations)
+{
+    u32 i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (!gPaletteFade.active)
+            BeginNormalPaletteFade(PALETTES_ALL, 0, 0, 16, RGB_BLACK);
+        UpdatePaletteFade();
+        TransferPlttBuffer();
+    }
+}
+
+// dma3_manager.c
+
+static const u8 sDma3Src[TILE_SIZE_4BPP * 32];
+
+static void SetUp_Dma3(void)
+{
+    ClearDma3Requests();
+}
+
+// A one-tile-high window that's copied to VRAM a tile at a time while text is
+// printed into it, then the VBlank that does the copies.
+static void Run_ProcessDma3Requests(u32 iterations)
+{
+    u32 i, j;
+
+    for (i = 0; i < iterations; i++)
+    {
+        for (j = 0; j < 32; j++)
+            RequestDma3Copy(&sDma3Src[j * TILE_SIZE_4BPP], (void *)BG_CHAR_ADDR(0) + j * TILE_SIZE_4BPP, TILE_SIZE_4BPP, 0);
+        ProcessDma3Requests();
+    }
+}
+
+const struct Benchmark gBenchmarks[] =
+{
+    {"AllocFree",                     SetUp_Heap,            Run_AllocFree},
+    {"AllocFree/Fragmented",          SetUp_FragmentedHeap,  Run_AllocFreeLarge},
+    {"AllocFree/Screen",              SetUp_ScreenHeap,      Run_AllocFreeScreen},
+    {"AllocFree/Tilemaps",            SetUp_ScreenHeap,      Run_AllocFreeTilemaps},
+    {"Arena/Tilemaps",                SetUp_ScreenHeap,      Run_ArenaTilemaps},
+    {"LoadSpriteSheet/Fragmented",    SetUp_FragmentedSpriteTiles, Run_LoadFreeSpriteSheet},
+    {"BuildOamBuffer/16",             SetUp_16Sprites,       Run_BuildOamBuffer},
+    {"BuildOamBuffer/64",             SetUp_64Sprites,       Run_BuildOamBuffer},
+    {"BuildOamBuffer/64/Moving",      SetUp_64Sprites,       Run_BuildOamBufferMoving},
+    {"BuildOamBuffer/64/FewMoving",   SetUp_64SpritesSamePriority, Run_BuildOamBufferFewMoving},
+    {"BuildOamBuffer/64/Flipped",     SetUp_64SpritesSamePriority, Run_BuildOamBufferFlipped},
+    {"BuildAndLoadOam/64",            SetUp_64Sprites,       Run_BuildAndLoadOam},
+    {"BuildAndLoadOam/64/OneMoving",  SetUp_64Sprites,       Run_BuildAndLoadOamOneMoving},
+    {"RenderText/Normal",             SetUp_Window,          Run_RenderTextNormal},
+    {"RenderText/Small",              SetUp_Window,          Run_RenderTextSmall},
+    {"RenderText/Page",               SetUp_Window,          Run_RenderTextPage},
+    {"RunTextPrinters/Page",          SetUp_TextPrinter,     Run_TextPrinterFrame},
+    {"CopyGlyphToWindow",             SetUp_Glyph,           Run_CopyGlyphToWindow},
+    {"RunTasks/16",                   SetUp_16Tasks,         Run_RunTasks},
+    {"ProcessDma3Requests/Tiles",     SetUp_Dma3,            Run_ProcessDma3Requests},
+    {"UpdatePaletteFade/All",         SetUp_PaletteFade,     Run_UpdatePaletteFade},
+    {NULL},
+};
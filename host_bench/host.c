@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "global.h"
+#include "host.h"
+
+// Host replacements for the parts of the GBA the benchmarked engine code
+// touches. The memory areas are plain RAM, the BIOS copy routines are done in
+// C, and DMA transfers happen as soon as they are started.
+
+struct MemoryArea
+{
+    const char *name;
+    uintptr_t address;
+    size_t size;
+};
+
+static const struct MemoryArea sMemoryAreas[] =
+{
+    {"EWRAM", EWRAM_START, EWRAM_END - EWRAM_START},
+    {"IWRAM", IWRAM_START, IWRAM_END - IWRAM_START},
+    {"I/O",   REG_BASE,    0x400},
+    {"PLTT",  PLTT,        PLTT_SIZE},
+    {"VRAM",  VRAM,        VRAM_SIZE},
+    {"OAM",   OAM,         OAM_SIZE},
+};
+
+void HostInitMemory(void)
+{
+    int i;
+
+    for (i = 0; i < (int)ARRAY_COUNT(sMemoryAreas); i++)
+    {
+        const struct MemoryArea *area = &sMemoryAreas[i];
+        void *mem = mmap((void *)area->address, area->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        // Without MAP_FIXED the address is only a hint. MAP_FIXED would
+        // silently replace whatever is mapped there already, so check instead.
+        if (mem != (void *)area->address)
+        {
+            fprintf(stderr, "error: couldn't map %s at 0x%08lX\n", area->name, (unsigned long)area->address);
+            exit(1);
+        }
+    }
+}
+
+void HostUnsupported(const char *name)
+{
+    fprintf(stderr, "error: %s isn't supported in the host build\n", name);
+    abort();
+}
+
+void CpuSet(const void *src, void *dest, u32 control)
+{
+    u32 count = control & 0x1FFFFF;
+    bool32 fixedSrc = (control & CPU_SET_SRC_FIXED) != 0;
+    u32 i;
+
+    if (control & CPU_SET_32BIT)
+    {
+        const u32 *src32 = src;
+        u32 *dest32 = dest;
+
+        for (i = 0; i < count; i++)
+            dest32[i] = fixedSrc ? src32[0] : src32[i];
+    }
+    else
+    {
+        const u16 *src16 = src;
+        u16 *dest16 = dest;
+
+        for (i = 0; i < count; i++)
+            dest16[i] = fixedSrc ? src16[0] : src16[i];
+    }
+}
+
+void CpuFastSet(const void *src, void *dest, u32 control)
+{
+    // CpuFastSet always moves blocks of 8 words.
+    u32 count = ((control & 0x1FFFFF) + 7) & ~7;
+    const u32 *src32 = src;
+    u32 *dest32 = dest;
+    u32 i;
+
+    for (i = 0; i < count; i++)
+        dest32[i] = (control & CPU_FAST_SET_SRC_FIXED) ? src32[0] : src32[i];
+}
+
+static s32 GetDmaAddressStep(u32 mode, u32 unitSize)
+{
+    switch (mode)
+    {
+    case 1:
+        return -(s32)unitSize;
+    case 2:
+        return 0;
+    default:
+        return unitSize;
+    }
+}
+
+void HostDmaSet(int dmaNum, const void *src, void *dest, u32 control)
+{
+    u32 flags = control >> 16;
+    u32 count = control & 0xFFFF;
+    u32 unitSize = (flags & DMA_32BIT) ? 4 : 2;
+    s32 srcStep, destStep;
+    const u8 *srcPos = src;
+    u8 *destPos = dest;
+    u32 i;
+
+    // Transfers that wait for VBlank, HBlank or the sound FIFO have nothing
+    // to wait for here, and aren't part of what is measured.
+    if (!(flags & DMA_ENABLE) || (flags & DMA_START_MASK) != DMA_START_NOW)
+        return;
+
+    if (count == 0)
+        count = dmaNum == 3 ? 0x10000 : 0x4000;
+
+    srcStep = GetDmaAddressStep((flags >> 7) & 3, unitSize);
+    destStep = GetDmaAddressStep((flags >> 5) & 3, unitSize);
+
+    for (i = 0; i < count; i++)
+    {
+        if (unitSize == 4)
+            *(u32 *)destPos = *(const u32 *)srcPos;
+        else
+            *(u16 *)destPos = *(const u16 *)srcPos;
+
+        srcPos += srcStep;
+        destPos += destStep;
+    }
+}
+
+void BgAffineSet(struct BgAffineSrcData *src, struct BgAffineDstData *dest, s32 count)
+{
+    HostUnsupported("BgAffineSet");
+}
+
+void ObjAffineSet(struct ObjAffineSrcData *src, void *dest, s32 count, s32 offset)
+{
+    HostUnsupported("ObjAffineSet");
+}
+
+void LZ77UnCompWram(const u32 *src, void *dest)
+{
+    HostUnsupported("LZ77UnCompWram");
+}
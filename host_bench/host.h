@@ -0,0 +1,13 @@
+#ifndef GUARD_HOST_H
+#define GUARD_HOST_H
+
+// Maps the GBA memory areas the engine writes to (I/O registers, palette RAM,
+// VRAM, OAM) at their real addresses, so the REG_* and VRAM macros can be
+// used as they are. Must be called before any engine code runs.
+void HostInitMemory(void);
+
+// Stops the program for a BIOS call or engine function that the host build
+// doesn't provide.
+void HostUnsupported(const char *name) __attribute__((noreturn));
+
+#endif // GUARD_HOST_H
@@ -0,0 +1,86 @@
+#include "global.h"
+#include "battle.h"
+#include "decompress.h"
+#include "dynamic_placeholder_text_util.h"
+#include "m4a.h"
+#include "main.h"
+#include "malloc.h"
+#include "menu.h"
+#include "sound.h"
+#include "strings.h"
+#include "text.h"
+#include "constants/songs.h"
+#include "host.h"
+
+// Definitions of what the benchmarked files use from the rest of the game,
+// which isn't built for the host. Sound does nothing, and anything whose
+// result would matter stops the program.
+
+struct Main gMain;
+u8 gHeap[HEAP_SIZE];
+u32 gBattleTypeFlags;
+struct MusicPlayerInfo gMPlayInfo_BGM;
+
+static struct SaveBlock2 sSaveBlock2;
+struct SaveBlock2 *gSaveBlock2Ptr = &sSaveBlock2;
+
+const u8 gText_ExpandedPlaceholder_Empty[] = _("");
+const u8 gText_ExpandedPlaceholder_Kun[] = _("");
+const u8 gText_ExpandedPlaceholder_Chan[] = _("");
+const u8 gText_ExpandedPlaceholder_Emerald[] = _("EMERALD");
+const u8 gText_ExpandedPlaceholder_Aqua[] = _("AQUA");
+const u8 gText_ExpandedPlaceholder_Magma[] = _("MAGMA");
+const u8 gText_ExpandedPlaceholder_Archie[] = _("ARCHIE");
+const u8 gText_ExpandedPlaceholder_Maxie[] = _("MAXIE");
+const u8 gText_ExpandedPlaceholder_Kyogre[] = _("KYOGRE");
+const u8 gText_ExpandedPlaceholder_Groudon[] = _("GROUDON");
+const u8 gText_ExpandedPlaceholder_Brendan[] = _("BRENDAN");
+const u8 gText_ExpandedPlaceholder_May[] = _("MAY");
+
+void PlaySE(u16 songNum)
+{
+}
+
+void PlayBGM(u16 songNum)
+{
+}
+
+bool8 IsSEPlaying(void)
+{
+    return FALSE;
+}
+
+void m4aMPlayStop(struct MusicPlayerInfo *mplayInfo)
+{
+}
+
+void m4aMPlayContinue(struct MusicPlayerInfo *mplayInfo)
+{
+}
+
+u32 GetPlayerTextSpeed(void)
+{
+    if (gTextFlags.forceMidTextSpeed)
+        return OPTIONS_TEXT_SPEED_MID;
+    return gSaveBlock2Ptr->optionsTextSpeed;
+}
+
+const u8 *DynamicPlaceholderTextUtil_GetPlaceholderPtr(u8 idx)
+{
+    HostUnsupported("DynamicPlaceholderTextUtil_GetPlaceholderPtr");
+}
+
+u16 FontFunc_Braille(struct TextPrinter *textPrinter)
+{
+    HostUnsupported("FontFunc_Braille");
+}
+
+u32 GetGlyphWidth_Braille(u16 glyphId, bool32 isJapanese)
+{
+    HostUnsupported("GetGlyphWidth_Braille");
+}
+
+void LZDecompressWram(const u32 *src, void *dest)
+{
+    HostUnsupported("LZDecompressWram");
+}
@@ -47,6 +47,21 @@
 // Uncomment to fix some identified minor bugs
 //#define BUGFIX
 
+// Uncomment to record how many cycles the main callbacks, tasks, sprite and
+// text updates and the VBlank handler take each frame (see profiler.h).
+//#define PROFILER
+
+// Uncomment to only rebuild the OAM buffer when a sprite changed how it's
+// drawn, and only copy the changed entries to OAM (see BuildOamBuffer). This
+// saves time on screens whose sprites stand still, but frames where sprites
+// move pay for comparing every sprite with the last frame.
+//#define OAM_SNAPSHOTS
+
+// Uncomment to keep the last 32 glyphs the text printers drew, so drawing one
+// again in the same colors skips decompressing it (see DecompressGlyph in
+// gflib/text.c). It takes about 2.3KB of EWRAM.
+//#define GLYPH_CACHE
+
 // Various undefined behavior bugs may or may not prevent compilation with
 // newer compilers. So always fix them when using a modern compiler.
 #if MODERN || defined(BUGFIX)
@@ -31,6 +31,14 @@
 
 #define CpuFastCopy(src, dest, size) CpuFastSet(src, dest, ((size)/(32/8) & 0x1FFFFF))
 
+#ifdef HOST_BUILD
+// There is no DMA controller when the engine is built for the host (see
+// host_bench/), so the transfer is done right away by a function.
+void HostDmaSet(int dmaNum, const void *src, void *dest, u32 control);
+
+#define DmaSet(dmaNum, src, dest, control) \
+    HostDmaSet(dmaNum, (const void *)(uintptr_t)(src), (void *)(uintptr_t)(dest), control)
+#else
 #define DmaSet(dmaNum, src, dest, control)        \
 {                                                 \
     vu32 *dmaRegs = (vu32 *)REG_ADDR_DMA##dmaNum; \
@@ -39,6 +47,7 @@
     dmaRegs[2] = (vu32)(control);                 \
     dmaRegs[2];                                   \
 }
+#endif
 
 #define DMA_FILL(dmaNum, value, dest, size, bit)                                              \
 {                                                                                             \
@@ -0,0 +1,80 @@
+#ifndef GUARD_PROFILER_H
+#define GUARD_PROFILER_H
+
+// Frame profiler, enabled by defining PROFILER in config.h.
+//
+// The main callbacks, every task function, AnimateSprites, BuildOamBuffer,
+// RunTextPrinters and the VBlank handler record when they start and end,
+// measured in CPU cycles by timers 2 and 3 chained together. The records go
+// into a ring buffer in EWRAM (gProfilerBuffer), which tools/profdecode reads
+// from a memory dump and turns into a flame graph.
+//
+// Timer 2 is also used while the flash chip is written, and timer 3 by the
+// cable and wireless links and the e-Reader. The profiler leaves the timers
+// alone while anything else has them set up, and marks the frames it couldn't
+// time so profdecode skips them.
+
+#define PROFILER_MAGIC 0x31525046 // "FPR1"
+
+// Must be a power of 2. Each event takes 8 bytes of EWRAM, so if the linker
+// says EWRAM overflowed, lower this or make room elsewhere.
+#ifndef PROFILER_EVENT_COUNT
+#define PROFILER_EVENT_COUNT 1024
+#endif
+
+// An event's id is a function address (without the Thumb bit) with some of
+// these flags, PROFILER_FLAG_END for the return from the last function that
+// started, or a frame marker. Functions often replace themselves (e.g. a task
+// changing its func) before they return, so the end of a function doesn't
+// repeat its address.
+#define PROFILER_FLAG_END       0x80000000 // The function returned.
+#define PROFILER_FLAG_INTERRUPT 0x40000000 // The function is an interrupt handler.
+#define PROFILER_FLAG_FRAME     0x20000000 // Start of a main loop iteration. The low bits are gMain.vblankCounter1.
+#define PROFILER_FLAG_BROKEN    0x10000000 // Set on a frame marker when the frame before it wasn't timed completely.
+#define PROFILER_FRAME_COUNTER_MASK 0x0FFFFFFF
+
+struct ProfilerEvent
+{
+    u32 time;
+    u32 id;
+};
+
+struct ProfilerBuffer
+{
+    u32 magic;
+    u16 eventCount;
+    u16 next; // Index of the next event to write.
+    u32 totalEvents; // Events written since ProfilerInit, including overwritten ones.
+    struct ProfilerEvent events[PROFILER_EVENT_COUNT];
+};
+
+#ifdef PROFILER
+
+extern struct ProfilerBuffer gProfilerBuffer;
+
+void ProfilerInit(void);
+void ProfilerStartFrame(void);
+void ProfilerBegin(const void *func);
+void ProfilerEnd(void);
+void ProfilerBeginInterrupt(const void *func);
+void ProfilerEndInterrupt(void);
+
+#define PROFILER_INIT() ProfilerInit()
+#define PROFILER_START_FRAME() ProfilerStartFrame()
+#define PROFILER_BEGIN(func) ProfilerBegin(func)
+#define PROFILER_END() ProfilerEnd()
+#define PROFILER_BEGIN_INTERRUPT(func) ProfilerBeginInterrupt(func)
+#define PROFILER_END_INTERRUPT() ProfilerEndInterrupt()
+
+#else
+
+#define PROFILER_INIT()
+#define PROFILER_START_FRAME()
+#define PROFILER_BEGIN(func)
+#define PROFILER_END()
+#define PROFILER_BEGIN_INTERRUPT(func)
+#define PROFILER_END_INTERRUPT()
+
+#endif // PROFILER
+
+#endif // GUARD_PROFILER_H
@@ -48,6 +48,7 @@ bool32 ConfettiUtil_Free(void)
 
     for (i = 0; i < sWork->count; i++)
         memcpy(&gMain.oamBuffer[i + 64], &gDummyOamData, sizeof(struct OamData));
+    MarkOamBufferDirty(64, 64 + sWork->count);
 
     memset(sWork->array, 0, sWork->count * sizeof(struct ConfettiUtil));
     FREE_AND_SET_NULL(sWork->array);
@@ -85,6 +86,7 @@ bool32 ConfettiUtil_Update(void)
             }
         }
     }
+    MarkOamBufferDirty(64, 64 + sWork->count);
 
     return TRUE;
 }
@@ -518,6 +518,8 @@ static void InitPaintingMonOamData(u8 contestWinnerId)
         gMain.oamBuffer[0].x = 88; // Duplicated code
         gMain.oamBuffer[0].y = 24;
     }
+
+    MarkOamBufferDirty(0, 1);
 }
 
 static u8 GetImageEffectForContestWinner(u8 contestWinnerId)
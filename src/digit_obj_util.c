@@ -35,6 +35,7 @@ struct DigitPrinterAlloc
 // this file's functions
 static u8 GetFirstOamId(u8 oamCount);
 static void CopyWorkToOam(struct DigitPrinter *objWork);
+static void MarkPrinterOamDirty(struct DigitPrinter *objWork);
 static void DrawNumObjsLeadingZeros(struct DigitPrinter *objWork, s32 num, bool32 sign);
 static void DrawNumObjsMinusInFront(struct DigitPrinter *objWork, s32 num, bool32 sign);
 static void DrawNumObjsMinusInBack(struct DigitPrinter *objWork, s32 num, bool32 sign);
@@ -200,6 +201,12 @@ static void CopyWorkToOam(struct DigitPrinter *objWork)
     gMain.oamBuffer[oamId].x = objWork->x - objWork->xDelta;
     gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
     gMain.oamBuffer[oamId].tileNum = objWork->tileStart + (objWork->tilesPerImage * 10);
+    MarkPrinterOamDirty(objWork);
+}
+
+static void MarkPrinterOamDirty(struct DigitPrinter *objWork)
+{
+    MarkOamBufferDirty(objWork->firstOamId, objWork->firstOamId + objWork->oamCount + 1);
 }
 
 void DigitObjUtil_PrintNumOn(u32 id, s32 num)
@@ -235,6 +242,8 @@ void DigitObjUtil_PrintNumOn(u32 id, s32 num)
         DrawNumObjsMinusInBack(&sOamWork->array[id], num, sign);
         break;
     }
+
+    MarkPrinterOamDirty(&sOamWork->array[id]);
 }
 
 static void DrawNumObjsLeadingZeros(struct DigitPrinter *objWork, s32 num, bool32 sign)
@@ -354,6 +363,7 @@ void DigitObjUtil_DeletePrinter(u32 id)
 
     for (i = 0; i < oamCount; i++, oamId++)
         gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
+    MarkPrinterOamDirty(&sOamWork->array[id]);
 
     if (!SharesTileWithAnyActive(id))
         FreeSpriteTilesByTag(sOamWork->array[id].tileTag);
@@ -378,6 +388,7 @@ void DigitObjUtil_HideOrShow(u32 id, bool32 hide)
     {
         for (i = 0; i < oamCount; i++, oamId++)
             gMain.oamBuffer[oamId].affineMode = ST_OAM_AFFINE_ERASE;
+        MarkPrinterOamDirty(&sOamWork->array[id]);
     }
     else
     {
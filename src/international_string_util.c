@@ -233,4 +233,5 @@ void FillWindowTilesByRow(int windowId, int columnStart, int rowStart, int numFi
             windowTileData += windowRowSize;
         }
     }
+    MarkWindowRectDirty(windowId, columnStart * 8, rowStart * 8, numFillTiles * 8, numRows * 8);
 }
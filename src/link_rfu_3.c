@@ -783,6 +783,7 @@ void DestroyWirelessStatusIndicatorSprite(void)
         DestroySprite(&gSprites[gWirelessStatusIndicatorSpriteId]);
         gMain.oamBuffer[125] = gDummyOamData;
         CpuCopy16(&gDummyOamData, (struct OamData *)OAM + 125, sizeof(struct OamData));
+        MarkOamBufferDirty(125, 126);
     }
 }
 
@@ -873,6 +874,7 @@ void UpdateWirelessStatusIndicatorSprite(void)
         gMain.oamBuffer[125].paletteNum = sprite->oam.paletteNum;
         gMain.oamBuffer[125].tileNum = sprite->sTileStart + sprite->anims[sprite->sCurrAnimNum][sprite->sFrameIdx].frame.imageValue;
         CpuCopy16(&gMain.oamBuffer[125], (struct OamData *)OAM + 125, sizeof(struct OamData));
+        MarkOamBufferDirty(125, 126);
         if (RfuGetStatus() == RFU_STATUS_FATAL_ERROR)
             DestroyWirelessStatusIndicatorSprite();
     }
@@ -22,6 +22,7 @@
 #include "text.h"
 #include "intro.h"
 #include "main.h"
+#include "profiler.h"
 #include "trainer_hill.h"
 #include "constants/rgb.h"
 
@@ -96,6 +97,7 @@ void AgbMain()
     REG_WAITCNT = WAITCNT_PREFETCH_ENABLE | WAITCNT_WS0_S_1 | WAITCNT_WS0_N_3;
     InitKeys();
     InitIntrHandlers();
+    PROFILER_INIT();
     m4aSoundInit();
     EnableVCountIntrAtLine150();
     InitRFU();
@@ -128,6 +130,7 @@ void AgbMain()
 #endif
     for (;;)
     {
+        PROFILER_START_FRAME();
         ReadKeys();
 
         if (gSoftResetDisabled == FALSE
@@ -162,7 +165,9 @@ void AgbMain()
 
         PlayTimeCounter_Update();
         MapMusicMain();
+        PROFILER_BEGIN(WaitForVBlank);
         WaitForVBlank();
+        PROFILER_END();
     }
 }
 
@@ -186,16 +191,27 @@ static void InitMainCallbacks(void)
 static void CallCallbacks(void)
 {
     if (gMain.callback1)
+    {
+        PROFILER_BEGIN(gMain.callback1);
         gMain.callback1();
+        PROFILER_END();
+    }
 
     if (gMain.callback2)
+    {
+        PROFILER_BEGIN(gMain.callback2);
         gMain.callback2();
+        PROFILER_END();
+    }
 }
 
+// Screens that clear OAM do it while they're being set up, so the next
+// LoadOam after a new screen starts copies the whole OAM buffer.
 void SetMainCallback2(MainCallback callback)
 {
     gMain.callback2 = callback;
     gMain.state = 0;
+    MarkOamBufferDirty(0, ARRAY_COUNT(gMain.oamBuffer));
 }
 
 void StartTimer1(void)
@@ -312,6 +328,7 @@ void InitIntrHandlers(void)
 void SetVBlankCallback(IntrCallback callback)
 {
     gMain.vblankCallback = callback;
+    MarkOamBufferDirty(0, ARRAY_COUNT(gMain.oamBuffer));
 }
 
 void SetHBlankCallback(IntrCallback callback)
@@ -337,6 +354,8 @@ void SetSerialCallback(IntrCallback callback)
 
 static void VBlankIntr(void)
 {
+    PROFILER_BEGIN_INTERRUPT(VBlankIntr);
+
     if (gWirelessCommType != 0)
         RfuVSync();
     else if (gLinkVSyncDisabled == FALSE)
@@ -348,7 +367,11 @@ static void VBlankIntr(void)
         (*gTrainerHillVBlankCounter)++;
 
     if (gMain.vblankCallback)
+    {
+        PROFILER_BEGIN_INTERRUPT(gMain.vblankCallback);
         gMain.vblankCallback();
+        PROFILER_END_INTERRUPT();
+    }
 
     gMain.vblankCounter2++;
 
@@ -367,6 +390,8 @@ static void VBlankIntr(void)
 
     INTR_CHECK |= INTR_FLAG_VBLANK;
     gMain.intrCheck |= INTR_FLAG_VBLANK;
+
+    PROFILER_END_INTERRUPT();
 }
 
 void InitFlashTimer(void)
@@ -0,0 +1,113 @@
+#include "global.h"
+#include "main.h"
+#include "profiler.h"
+
+#ifdef PROFILER
+
+// Timer 2 counts cycles and timer 3 counts timer 2's overflows.
+#define PROFILER_TM2CNT_H (TIMER_ENABLE | TIMER_1CLK)
+#define PROFILER_TM3CNT_H (TIMER_ENABLE | TIMER_COUNTUP)
+
+EWRAM_DATA struct ProfilerBuffer gProfilerBuffer = {0};
+
+static EWRAM_DATA bool8 sRecording = FALSE;
+
+static bool32 OwnsTimers(void)
+{
+    return REG_TM2CNT_H == PROFILER_TM2CNT_H && REG_TM3CNT_H == PROFILER_TM3CNT_H;
+}
+
+// Starts the timers unless something else has set them up.
+static bool32 TryStartTimers(void)
+{
+    if ((REG_TM2CNT_H != 0 && REG_TM2CNT_H != PROFILER_TM2CNT_H)
+     || (REG_TM3CNT_H != 0 && REG_TM3CNT_H != PROFILER_TM3CNT_H))
+        return FALSE;
+
+    REG_TM2CNT_H = 0;
+    REG_TM3CNT_H = 0;
+    REG_TM2CNT_L = 0;
+    REG_TM3CNT_L = 0;
+    REG_TM3CNT_H = PROFILER_TM3CNT_H;
+    REG_TM2CNT_H = PROFILER_TM2CNT_H;
+    return TRUE;
+}
+
+static u32 ReadCycles(void)
+{
+    u16 high, low;
+
+    // Read the high half again in case timer 2 overflowed in between.
+    do
+    {
+        high = REG_TM3CNT_L;
+        low = REG_TM2CNT_L;
+    } while (high != REG_TM3CNT_L);
+
+    return (high << 16) | low;
+}
+
+static void Record(u32 id)
+{
+    struct ProfilerEvent *event;
+    u16 ime;
+
+    if (!sRecording)
+        return;
+
+    // Interrupt handlers record events too.
+    ime = REG_IME;
+    REG_IME = 0;
+
+    event = &gProfilerBuffer.events[gProfilerBuffer.next];
+    event->time = ReadCycles();
+    event->id = id;
+    gProfilerBuffer.next = (gProfilerBuffer.next + 1) & (PROFILER_EVENT_COUNT - 1);
+    gProfilerBuffer.totalEvents++;
+
+    REG_IME = ime;
+}
+
+void ProfilerInit(void)
+{
+    CpuFill32(0, &gProfilerBuffer, sizeof(gProfilerBuffer));
+    gProfilerBuffer.magic = PROFILER_MAGIC;
+    gProfilerBuffer.eventCount = PROFILER_EVENT_COUNT;
+    sRecording = FALSE;
+}
+
+void ProfilerStartFrame(void)
+{
+    bool32 lastFrameTimed = sRecording && OwnsTimers();
+    u32 marker = PROFILER_FLAG_FRAME | (gMain.vblankCounter1 & PROFILER_FRAME_COUNTER_MASK);
+
+    if (!lastFrameTimed)
+    {
+        marker |= PROFILER_FLAG_BROKEN;
+        sRecording = TryStartTimers();
+    }
+
+    Record(marker);
+}
+
+void ProfilerBegin(const void *func)
+{
+    Record((u32)func & ~1);
+}
+
+void ProfilerEnd(void)
+{
+    Record(PROFILER_FLAG_END);
+}
+
+void ProfilerBeginInterrupt(const void *func)
+{
+    Record(((u32)func & ~1) | PROFILER_FLAG_INTERRUPT);
+}
+
+void ProfilerEndInterrupt(void)
+{
+    Record(PROFILER_FLAG_INTERRUPT | PROFILER_FLAG_END);
+}
+
+#endif // PROFILER
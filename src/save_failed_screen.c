@@ -351,6 +351,7 @@ static void VBlankCB_UpdateClockGraphics(void)
     }
 
     CpuFastCopy(gMain.oamBuffer, (void *)OAM, 4);
+    MarkOamBufferDirty(0, 1);
 
     if (sClockInfo[DEBUG_TIMER])
         sClockInfo[DEBUG_TIMER]--;
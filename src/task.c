@@ -1,5 +1,6 @@
 #include "global.h"
 #include "task.h"
+#include "profiler.h"
 
 struct Task gTasks[NUM_TASKS];
 
@@ -115,7 +116,9 @@ void RunTasks(void)
     {
         do
         {
+            PROFILER_BEGIN(gTasks[taskId].func);
             gTasks[taskId].func(taskId);
+            PROFILER_END();
             taskId = gTasks[taskId].next;
         } while (taskId != TAIL_SENTINEL);
     }
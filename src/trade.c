@@ -163,6 +163,7 @@ struct InGameTrade {
     u16 requestedSpecies;
 };
 
+static EWRAM_DATA struct Arena *sTradeMenuArena = NULL;
 static EWRAM_DATA u8 *sMenuTextTileBuffer = NULL;
 
 // Bytes 0-2 are used for the player's name text
@@ -452,9 +453,10 @@ static void CB2_CreateTradeMenu(void)
     switch (gMain.state)
     {
     case 0:
-        sTradeMenu = AllocZeroed(sizeof(*sTradeMenu));
+        sTradeMenuArena = ArenaBegin(ARENA_ALLOC_SIZE(sizeof(*sTradeMenu)) + NUM_MENU_TEXT_SPRITES * 256);
+        sTradeMenu = ArenaAllocZeroed(sTradeMenuArena, sizeof(*sTradeMenu));
         InitTradeMenu();
-        sMenuTextTileBuffer = AllocZeroed(NUM_MENU_TEXT_SPRITES * 256);
+        sMenuTextTileBuffer = ArenaAllocZeroed(sTradeMenuArena, NUM_MENU_TEXT_SPRITES * 256);
 
         for (i = 0; i < NUM_MENU_TEXT_SPRITES; i++)
             sMenuTextTileBuffers[i] = &sMenuTextTileBuffer[i * 256];
@@ -931,9 +933,8 @@ static void CB_StartLinkTrade(void)
         // Wireless Link Trade
         if (IsLinkRfuTaskFinished())
         {
-            Free(sMenuTextTileBuffer);
+            ARENA_END_AND_SET_NULL(sTradeMenuArena);
             FreeAllWindowBuffers();
-            Free(sTradeMenu);
             gMain.callback1 = NULL;
             DestroyWirelessStatusIndicatorSprite();
             SetMainCallback2(CB2_LinkTrade);
@@ -944,9 +945,8 @@ static void CB_StartLinkTrade(void)
         // Cable Link Trade
         if (!gReceivedRemoteLinkPlayers)
         {
-            Free(sMenuTextTileBuffer);
+            ARENA_END_AND_SET_NULL(sTradeMenuArena);
             FreeAllWindowBuffers();
-            Free(sTradeMenu);
             gMain.callback1 = NULL;
             SetMainCallback2(CB2_LinkTrade);
         }
@@ -1751,8 +1751,7 @@ static void CB_ExitCanceledTrade(void)
     {
         if (IsLinkTradeTaskFinished() && GetNumQueuedActions() == 0)
         {
-            Free(sMenuTextTileBuffer);
-            Free(sTradeMenu);
+            ARENA_END_AND_SET_NULL(sTradeMenuArena);
             FreeAllWindowBuffers();
             DestroyWirelessStatusIndicatorSprite();
             SetMainCallback2(CB2_ReturnToFieldFromMultiplayer);
@@ -1762,8 +1761,7 @@ static void CB_ExitCanceledTrade(void)
     {
         if (!gReceivedRemoteLinkPlayers)
         {
-            Free(sMenuTextTileBuffer);
-            Free(sTradeMenu);
+            ARENA_END_AND_SET_NULL(sTradeMenuArena);
             FreeAllWindowBuffers();
             SetMainCallback2(CB2_ReturnToFieldFromMultiplayer);
         }
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <limits.h>
+#include <math.h>
 
 /* extended.c */
 void ieee754_write_extended (double, uint8_t*);
@@ -551,6 +552,149 @@ struct Bytes *delta_compress(struct Bytes *pcm)
 	return delta;
 }
 
+#define DELTA_BLOCK_LENGTH 64
+#define SQUARE(value) ((value) * (value))
+
+// Picks the start value and delta indices for one block of up to 64 samples
+// that minimize the total squared error of the decoded block. This is a
+// Viterbi search over the 256 values the decoder can hold after each sample,
+// so unlike get_delta_index it can take a worse step now to stay closer later.
+// Returns the start value and fills in indices[1..count-1].
+uint8_t encode_delta_block(const uint8_t *samples, int count, uint8_t *indices)
+{
+	static uint8_t from_value[DELTA_BLOCK_LENGTH][256];
+	static uint8_t from_index[DELTA_BLOCK_LENGTH][256];
+	long cost[256];
+	long next_cost[256];
+	int value;
+
+	for (value = 0; value < 256; value++)
+		cost[value] = SQUARE(U8_TO_S8(value) - U8_TO_S8(samples[0]));
+
+	for (int t = 1; t < count; t++)
+	{
+		int sample_signed = U8_TO_S8(samples[t]);
+
+		for (value = 0; value < 256; value++)
+			next_cost[value] = LONG_MAX;
+
+		for (value = 0; value < 256; value++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				uint8_t new_value = value + gDeltaEncodingTable[i];
+				long new_cost = cost[value] + SQUARE(U8_TO_S8(new_value) - sample_signed);
+
+				if (new_cost < next_cost[new_value])
+				{
+					next_cost[new_value] = new_cost;
+					from_value[t][new_value] = value;
+					from_index[t][new_value] = i;
+				}
+			}
+		}
+
+		memcpy(cost, next_cost, sizeof(cost));
+	}
+
+	int best_value = 0;
+
+	for (value = 1; value < 256; value++)
+	{
+		if (cost[value] < cost[best_value])
+			best_value = value;
+	}
+
+	for (int t = count - 1; t > 0; t--)
+	{
+		indices[t] = from_index[t][best_value];
+		best_value = from_value[t][best_value];
+	}
+
+	return best_value;
+}
+
+// Same output format as delta_compress, but each block is encoded with
+// encode_delta_block instead of picking the closest delta one sample at a time.
+struct Bytes *delta_compress_trellis(struct Bytes *pcm)
+{
+	struct Bytes *delta = malloc(sizeof(struct Bytes));
+	int num_blocks = (pcm->length + DELTA_BLOCK_LENGTH - 1) / DELTA_BLOCK_LENGTH;
+	delta->data = malloc(num_blocks * 33);
+
+	unsigned int i = 0;
+	unsigned int j = 0;
+	uint8_t indices[DELTA_BLOCK_LENGTH];
+
+	while (i < pcm->length)
+	{
+		int count = pcm->length - i;
+		if (count > DELTA_BLOCK_LENGTH)
+			count = DELTA_BLOCK_LENGTH;
+
+		delta->data[j++] = encode_delta_block(&pcm->data[i], count, indices);
+
+		if (count > 1)
+			delta->data[j++] = indices[1];
+
+		for (int k = 2; k < count; k += 2)
+		{
+			delta->data[j] = indices[k] << 4;
+			if (k + 1 < count)
+				delta->data[j] |= indices[k + 1];
+			j++;
+		}
+
+		i += count;
+	}
+
+	delta->length = j;
+
+	return delta;
+}
+
+// Returns the signal-to-noise ratio in dB of the decoded delta data against
+// the original samples.
+double delta_snr(struct Bytes *pcm, struct Bytes *delta)
+{
+	struct Bytes *decoded = delta_decompress(delta, pcm->length);
+	double signal = 0;
+	double noise = 0;
+
+	for (unsigned long i = 0; i < pcm->length; i++)
+	{
+		int sample_signed = U8_TO_S8(pcm->data[i]);
+		int error = sample_signed;
+
+		if (i < decoded->length)
+			error -= U8_TO_S8(decoded->data[i]);
+
+		signal += SQUARE((double)sample_signed);
+		noise += SQUARE((double)error);
+	}
+
+	free(decoded->data);
+	free(decoded);
+
+	if (noise == 0)
+		return INFINITY;
+
+	return 10 * log10(signal / noise);
+}
+
+void print_delta_report(const char *aif_filename, struct Bytes *pcm)
+{
+	struct Bytes *greedy = delta_compress(pcm);
+	struct Bytes *trellis = delta_compress_trellis(pcm);
+
+	printf("%s: greedy SNR %.2f dB, trellis SNR %.2f dB\n", aif_filename, delta_snr(pcm, greedy), delta_snr(pcm, trellis));
+
+	free(greedy->data);
+	free(greedy);
+	free(trellis->data);
+	free(trellis);
+}
+
 #define STORE_U32_LE(dest, value) \
 do { \
 	*(dest) = (value) & 0xff; \
@@ -568,7 +712,7 @@ do { \
 } while (0)
 
 // Reads an .aif file and produces a .pcm file containing an array of 8-bit samples.
-void aif2pcm(const char *aif_filename, const char *pcm_filename, bool compress)
+void aif2pcm(const char *aif_filename, const char *pcm_filename, bool compress, bool trellis, bool report)
 {
 	struct Bytes *aif = read_bytearray(aif_filename);
 	AifData aif_data = {0};
@@ -591,12 +735,18 @@ void aif2pcm(const char *aif_filename, const char *pcm_filename, bool compress)
 	struct Bytes *pcm;
 	struct Bytes output = {0,0};
 
+	if (report)
+	{
+		struct Bytes input = { aif_data.real_num_samples, aif_data.samples8 };
+		print_delta_report(aif_filename, &input);
+	}
+
 	if (compress)
 	{
 		struct Bytes *input = malloc(sizeof(struct Bytes));
 		input->data = aif_data.samples8;
 		input->length = aif_data.real_num_samples;
-		pcm = delta_compress(input);
+		pcm = trellis ? delta_compress_trellis(input) : delta_compress(input);
 		free(input);
 	}
 	else
@@ -881,7 +1031,9 @@ void pcm2aif(const char *pcm_filename, const char *aif_filename, uint32_t base_n
 void usage(void)
 {
 	fprintf(stderr, "Usage: aif2pcm bin_file [aif_file]\n");
-	fprintf(stderr, "       aif2pcm aif_file [bin_file] [--compress]\n");
+	fprintf(stderr, "       aif2pcm aif_file [bin_file] [--compress] [--trellis] [--report]\n");
+	fprintf(stderr, "  --trellis  compress, choosing deltas that minimize each block's error\n");
+	fprintf(stderr, "  --report   print the SNR of the greedy and trellis encoders\n");
 }
 
 int main(int argc, char **argv)
@@ -896,6 +1048,8 @@ int main(int argc, char **argv)
 	char *extension = get_file_extension(input_file);
 	char *output_file;
 	bool compressed = false;
+	bool trellis = false;
+	bool report = false;
 
 	if (argc > 3)
 	{
@@ -905,6 +1059,15 @@ int main(int argc, char **argv)
 			{
 				compressed = true;
 			}
+			else if (strcmp(argv[i], "--trellis") == 0)
+			{
+				compressed = true;
+				trellis = true;
+			}
+			else if (strcmp(argv[i], "--report") == 0)
+			{
+				report = true;
+			}
 		}
 	}
 
@@ -913,12 +1076,12 @@ int main(int argc, char **argv)
 		if (argc >= 3)
 		{
 			output_file = argv[2];
-			aif2pcm(input_file, output_file, compressed);
+			aif2pcm(input_file, output_file, compressed, trellis, report);
 		}
 		else
 		{
 			output_file = new_file_extension(input_file, "bin");
-			aif2pcm(input_file, output_file, compressed);
+			aif2pcm(input_file, output_file, compressed, trellis, report);
 			free(output_file);
 		}
 	}
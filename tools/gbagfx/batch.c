@@ -0,0 +1,422 @@
+// Batch mode: runs many conversions in one process.
+//
+// The manifest has one job per line, written exactly like the arguments to a
+// normal invocation: "INPUT OUTPUT [options...]". Blank lines and lines that
+// start with '#' are ignored, and a manifest path of "-" reads from stdin.
+//
+// Jobs run on a pool of threads. A job whose input is the output of an
+// earlier job waits for that job to finish, so chains like png -> 4bpp -> lz
+// can be listed in order. Jobs whose output is already newer than their input
+// are skipped, as are jobs whose input does not exist; the latter are left
+// for make to build through its regular rules.
+//
+// Each job writes its output to a temporary file next to it and renames it
+// into place when the job succeeds. If a job fails, the temporary files of the
+// jobs still running are removed, so no half-written output ends up looking
+// up to date.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "global.h"
+#include "batch.h"
+
+enum BatchJobState {
+    JOB_PENDING,
+    JOB_RUNNING,
+    JOB_DONE,
+};
+
+struct BatchJob {
+    int argc;
+    char **argv;
+    int dependency;
+    enum BatchJobState state;
+    char *tempPath; // Where the output is written while the job runs.
+};
+
+struct Batch {
+    struct BatchJob *jobs;
+    int numJobs;
+    int firstPendingJob;
+    BatchConvertFunc convert;
+    pthread_mutex_t mutex;
+    pthread_cond_t jobDone;
+    int numConverted;
+    int numSkipped;
+};
+
+static char *ReadManifest(char *path)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", path);
+
+    size_t size = 0;
+    size_t capacity = 4096;
+    char *buffer = malloc(capacity);
+
+    if (buffer == NULL)
+        FATAL_ERROR("Failed to allocate memory for reading \"%s\".\n", path);
+
+    size_t count;
+
+    while ((count = fread(buffer + size, 1, capacity - size - 1, fp)) > 0)
+    {
+        size += count;
+
+        if (size + 1 == capacity)
+        {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+
+            if (buffer == NULL)
+                FATAL_ERROR("Failed to allocate memory for reading \"%s\".\n", path);
+        }
+    }
+
+    if (ferror(fp))
+        FATAL_ERROR("Failed to read \"%s\".\n", path);
+
+    if (fp != stdin)
+        fclose(fp);
+
+    buffer[size] = 0;
+
+    return buffer;
+}
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Splits the manifest into jobs, modifying the buffer in place. Every job's
+// argv points into the buffer, with argv[0] left as a placeholder program name.
+static void ParseManifest(struct Batch *batch, char *manifest)
+{
+    int capacity = 256;
+
+    batch->jobs = malloc(capacity * sizeof(struct BatchJob));
+    batch->numJobs = 0;
+
+    if (batch->jobs == NULL)
+        FATAL_ERROR("Failed to allocate memory for batch jobs.\n");
+
+    char *line = manifest;
+
+    while (*line != 0)
+    {
+        char *lineEnd = strchr(line, '\n');
+        char *next = lineEnd != NULL ? lineEnd + 1 : line + strlen(line);
+
+        if (lineEnd != NULL)
+            *lineEnd = 0;
+
+        int argc = 1;
+        char **argv = malloc((strlen(line) / 2 + 3) * sizeof(char *));
+
+        if (argv == NULL)
+            FATAL_ERROR("Failed to allocate memory for batch jobs.\n");
+
+        argv[0] = "gbagfx";
+
+        char *pos = line;
+
+        while (IsSpace(*pos))
+            pos++;
+
+        if (*pos != '#')
+        {
+            while (*pos != 0)
+            {
+                argv[argc++] = pos;
+
+                while (*pos != 0 && !IsSpace(*pos))
+                    pos++;
+
+                if (*pos != 0)
+                    *pos++ = 0;
+
+                while (IsSpace(*pos))
+                    pos++;
+            }
+        }
+
+        argv[argc] = NULL;
+
+        if (argc == 1)
+        {
+            free(argv);
+        }
+        else if (argc == 2)
+        {
+            FATAL_ERROR("Batch job \"%s\" has no output path.\n", argv[1]);
+        }
+        else
+        {
+            if (batch->numJobs == capacity)
+            {
+                capacity *= 2;
+                batch->jobs = realloc(batch->jobs, capacity * sizeof(struct BatchJob));
+
+                if (batch->jobs == NULL)
+                    FATAL_ERROR("Failed to allocate memory for batch jobs.\n");
+            }
+
+            struct BatchJob *job = &batch->jobs[batch->numJobs++];
+
+            job->argc = argc;
+            job->argv = argv;
+            job->dependency = -1;
+            job->state = JOB_PENDING;
+            job->tempPath = NULL;
+        }
+
+        line = next;
+    }
+
+    // Link each job to the most recent earlier job that writes its input.
+    for (int i = 0; i < batch->numJobs; i++)
+    {
+        for (int j = i - 1; j >= 0; j--)
+        {
+            if (strcmp(batch->jobs[i].argv[1], batch->jobs[j].argv[2]) == 0)
+            {
+                batch->jobs[i].dependency = j;
+                break;
+            }
+        }
+    }
+}
+
+#ifdef __APPLE__
+#define STAT_MTIME(st) ((st).st_mtimespec)
+#else
+#define STAT_MTIME(st) ((st).st_mtim)
+#endif
+
+static bool IsUpToDate(char *inputPath, char *outputPath, bool *inputExists)
+{
+    struct stat inputStat;
+    struct stat outputStat;
+
+    *inputExists = (stat(inputPath, &inputStat) == 0);
+
+    if (!*inputExists)
+        return false;
+
+    if (stat(outputPath, &outputStat) != 0)
+        return false;
+
+    struct timespec inputTime = STAT_MTIME(inputStat);
+    struct timespec outputTime = STAT_MTIME(outputStat);
+
+    if (outputTime.tv_sec != inputTime.tv_sec)
+        return outputTime.tv_sec > inputTime.tv_sec;
+
+    return outputTime.tv_nsec > inputTime.tv_nsec;
+}
+
+// Returns a path for a job's temporary output: the output path with "~tmpN"
+// inserted before the extensions, which decide how the job converts. Returns
+// NULL if the output has no extension, in which case the conversion picks its
+// own output path.
+static char *MakeTempPath(char *outputPath, int jobIndex)
+{
+    char *name = strrchr(outputPath, '/');
+    char *extension = strchr(name != NULL ? name + 1 : outputPath, '.');
+
+    if (extension == NULL)
+        return NULL;
+
+    char *tempPath = malloc(strlen(outputPath) + 16);
+
+    if (tempPath == NULL)
+        FATAL_ERROR("Failed to allocate memory for batch jobs.\n");
+
+    sprintf(tempPath, "%.*s~tmp%d%s", (int)(extension - outputPath), outputPath, jobIndex, extension);
+
+    return tempPath;
+}
+
+// The batch that is running, for RemoveTempOutputs.
+static struct Batch *sRunningBatch;
+
+// Runs at exit. When a job fails, FATAL_ERROR exits while other jobs are still
+// writing their outputs, so this can't take the mutex, and a job may finish
+// while it runs. Removing a temporary file that was just renamed fails
+// harmlessly.
+static void RemoveTempOutputs(void)
+{
+    struct Batch *batch = sRunningBatch;
+
+    if (batch == NULL)
+        return;
+
+    for (int i = 0; i < batch->numJobs; i++)
+    {
+        struct BatchJob *job = &batch->jobs[i];
+
+        if (job->state == JOB_RUNNING && job->tempPath != NULL)
+            unlink(job->tempPath);
+    }
+}
+
+// Returns the index of a job that is ready to run, or -1 if there is none.
+// Must be called with the mutex held.
+static int TakeReadyJob(struct Batch *batch)
+{
+    while (batch->firstPendingJob < batch->numJobs
+        && batch->jobs[batch->firstPendingJob].state != JOB_PENDING)
+        batch->firstPendingJob++;
+
+    for (int i = batch->firstPendingJob; i < batch->numJobs; i++)
+    {
+        struct BatchJob *job = &batch->jobs[i];
+
+        if (job->state == JOB_PENDING
+         && (job->dependency < 0 || batch->jobs[job->dependency].state == JOB_DONE))
+        {
+            job->state = JOB_RUNNING;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void *BatchWorker(void *arg)
+{
+    struct Batch *batch = arg;
+
+    pthread_mutex_lock(&batch->mutex);
+
+    for (;;)
+    {
+        int jobIndex = TakeReadyJob(batch);
+
+        if (jobIndex < 0)
+        {
+            if (batch->firstPendingJob >= batch->numJobs)
+                break;
+
+            pthread_cond_wait(&batch->jobDone, &batch->mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&batch->mutex);
+
+        struct BatchJob *job = &batch->jobs[jobIndex];
+        bool inputExists;
+        bool skip = IsUpToDate(job->argv[1], job->argv[2], &inputExists);
+
+        if (!inputExists)
+        {
+            fprintf(stderr, "Skipping \"%s\": input does not exist.\n", job->argv[2]);
+            skip = true;
+        }
+
+        if (!skip)
+        {
+            char *outputPath = job->argv[2];
+            char *tempPath = MakeTempPath(outputPath, jobIndex);
+
+            if (tempPath != NULL)
+            {
+                job->tempPath = tempPath;
+                job->argv[2] = tempPath;
+            }
+
+            batch->convert(job->argc, job->argv);
+
+            if (tempPath != NULL)
+            {
+                job->argv[2] = outputPath;
+
+                if (rename(tempPath, outputPath) != 0)
+                    FATAL_ERROR("Failed to rename \"%s\" to \"%s\".\n", tempPath, outputPath);
+            }
+        }
+
+        pthread_mutex_lock(&batch->mutex);
+
+        job->state = JOB_DONE;
+
+        if (skip)
+            batch->numSkipped++;
+        else
+            batch->numConverted++;
+
+        pthread_cond_broadcast(&batch->jobDone);
+    }
+
+    pthread_mutex_unlock(&batch->mutex);
+
+    return NULL;
+}
+
+void RunBatch(char *manifestPath, int numThreads, BatchConvertFunc convert)
+{
+    struct Batch batch;
+    char *manifest = ReadManifest(manifestPath);
+
+    ParseManifest(&batch, manifest);
+
+    batch.firstPendingJob = 0;
+    batch.convert = convert;
+    batch.numConverted = 0;
+    batch.numSkipped = 0;
+    pthread_mutex_init(&batch.mutex, NULL);
+    pthread_cond_init(&batch.jobDone, NULL);
+
+    sRunningBatch = &batch;
+    atexit(RemoveTempOutputs);
+
+    if (numThreads <= 0)
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    if (numThreads > batch.numJobs)
+        numThreads = batch.numJobs > 0 ? batch.numJobs : 1;
+
+    pthread_t *threads = malloc(numThreads * sizeof(pthread_t));
+
+    if (threads == NULL)
+        FATAL_ERROR("Failed to allocate memory for batch threads.\n");
+
+    for (int i = 0; i < numThreads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, BatchWorker, &batch) != 0)
+            FATAL_ERROR("Failed to create batch thread.\n");
+    }
+
+    for (int i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+
+    printf("gbagfx: %d converted, %d skipped\n", batch.numConverted, batch.numSkipped);
+
+    pthread_mutex_destroy(&batch.mutex);
+    pthread_cond_destroy(&batch.jobDone);
+
+    sRunningBatch = NULL;
+
+    for (int i = 0; i < batch.numJobs; i++)
+    {
+        free(batch.jobs[i].argv);
+        free(batch.jobs[i].tempPath);
+    }
+
+    free(batch.jobs);
+    free(threads);
+    free(manifest);
+}
@@ -0,0 +1,10 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+// Converts a single file. argv has the same layout as the command line:
+// argv[1] is the input path, argv[2] the output path and options follow.
+typedef void (*BatchConvertFunc)(int argc, char **argv);
+
+void RunBatch(char *manifestPath, int numThreads, BatchConvertFunc convert);
+
+#endif // BATCH_H
@@ -0,0 +1,511 @@
+// Content-addressed cache of conversion outputs.
+//
+// Each entry is a copy of one output file, named after a hash of the input
+// file's bytes, the input and output extensions, the conversion options and
+// the time gbagfx was built, so a rebuilt gbagfx never reuses stale outputs.
+// Conversions that read or write other files through their options
+// (-palette, -tilemap) are not cached.
+//
+// Entries are written to a temporary file and renamed into place, so
+// concurrent gbagfx processes can share one cache. A hit refreshes the
+// entry's modification time. The "stats" file holds the hit and miss counts
+// and a running total of the entries' size, updated under a lock; when a store
+// takes the total over the size cap, the directory is scanned and the least
+// recently used entries are deleted until the cache is back to three quarters
+// of the cap, so the scan is not repeated on every store.
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#include "global.h"
+#include "util.h"
+#include "cache.h"
+
+#define DEFAULT_CACHE_SIZE_MIB 256
+#define ENTRY_NAME_LENGTH 16
+
+static atomic_int sTempFileCounter;
+
+// fcntl locks only exclude other processes, so threads also take this.
+static pthread_mutex_t sStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct CacheStats {
+    int64_t hits;
+    int64_t misses;
+    int64_t size;
+};
+
+struct CacheEntry {
+    char name[ENTRY_NAME_LENGTH + 1];
+    off_t size;
+    time_t mtime;
+};
+
+static char *GetCacheDir(void)
+{
+    char *dir = getenv("GBAGFX_CACHE_DIR");
+
+    if (dir == NULL || *dir == 0)
+        return NULL;
+
+    return dir;
+}
+
+static long long GetCacheSizeLimit(void)
+{
+    char *sizeString = getenv("GBAGFX_CACHE_SIZE");
+    int sizeMiB = DEFAULT_CACHE_SIZE_MIB;
+
+    if (sizeString != NULL && *sizeString != 0)
+    {
+        if (!ParseNumber(sizeString, NULL, 10, &sizeMiB) || sizeMiB < 1)
+            FATAL_ERROR("GBAGFX_CACHE_SIZE must be a positive number of MiB.\n");
+    }
+
+    return (long long)sizeMiB * 1024 * 1024;
+}
+
+static char *MakeCachePath(const char *name)
+{
+    char *dir = GetCacheDir();
+    char *path = malloc(strlen(dir) + strlen(name) + 2);
+
+    if (path == NULL)
+        FATAL_ERROR("Failed to allocate memory for cache path.\n");
+
+    sprintf(path, "%s/%s", dir, name);
+
+    return path;
+}
+
+static void GetEntryName(struct CacheKey *key, char *name)
+{
+    sprintf(name, "%016" PRIx64, key->hash);
+}
+
+// 64-bit FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char *s)
+{
+    // Include the terminator so that adjacent strings can't run together.
+    return HashBytes(hash, s, strlen(s) + 1);
+}
+
+// Returns everything after the first '.' in the file name, e.g. "4bpp.lz".
+static char *GetFullExtension(char *path)
+{
+    char *name = strrchr(path, '/');
+    char *extension = strchr(name != NULL ? name + 1 : path, '.');
+
+    return extension != NULL ? extension + 1 : "";
+}
+
+// Copies src to dest, as a reflink when the file system supports it.
+static bool CopyFile(const char *src, const char *dest)
+{
+    int in = open(src, O_RDONLY);
+
+    if (in < 0)
+        return false;
+
+    int out = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (out < 0)
+    {
+        close(in);
+        return false;
+    }
+
+    bool success = false;
+
+#ifdef FICLONE
+    success = (ioctl(out, FICLONE, in) == 0);
+#endif
+
+    if (!success)
+    {
+        char buffer[65536];
+        ssize_t count;
+
+        success = true;
+
+        while ((count = read(in, buffer, sizeof(buffer))) > 0)
+        {
+            if (write(out, buffer, count) != count)
+            {
+                success = false;
+                break;
+            }
+        }
+
+        if (count < 0)
+            success = false;
+    }
+
+    close(in);
+
+    if (close(out) != 0)
+        success = false;
+
+    return success;
+}
+
+static bool IsEntryName(const char *name)
+{
+    if (strlen(name) != ENTRY_NAME_LENGTH)
+        return false;
+
+    for (int i = 0; i < ENTRY_NAME_LENGTH; i++)
+    {
+        if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f')))
+            return false;
+    }
+
+    return true;
+}
+
+static struct CacheEntry *ListEntries(int *numEntries, long long *totalSize)
+{
+    DIR *dir = opendir(GetCacheDir());
+    int capacity = 256;
+    struct CacheEntry *entries = malloc(capacity * sizeof(struct CacheEntry));
+
+    *numEntries = 0;
+    *totalSize = 0;
+
+    if (entries == NULL)
+        FATAL_ERROR("Failed to allocate memory for cache entries.\n");
+
+    if (dir == NULL)
+        return entries;
+
+    struct dirent *dirent;
+
+    while ((dirent = readdir(dir)) != NULL)
+    {
+        if (!IsEntryName(dirent->d_name))
+            continue;
+
+        char *path = MakeCachePath(dirent->d_name);
+        struct stat st;
+
+        if (stat(path, &st) == 0)
+        {
+            if (*numEntries == capacity)
+            {
+                capacity *= 2;
+                entries = realloc(entries, capacity * sizeof(struct CacheEntry));
+
+                if (entries == NULL)
+                    FATAL_ERROR("Failed to allocate memory for cache entries.\n");
+            }
+
+            struct CacheEntry *entry = &entries[(*numEntries)++];
+
+            strcpy(entry->name, dirent->d_name);
+            entry->size = st.st_size;
+            entry->mtime = st.st_mtime;
+            *totalSize += st.st_size;
+        }
+
+        free(path);
+    }
+
+    closedir(dir);
+
+    return entries;
+}
+
+static int CompareEntriesByAge(const void *a, const void *b)
+{
+    const struct CacheEntry *entryA = a;
+    const struct CacheEntry *entryB = b;
+
+    if (entryA->mtime != entryB->mtime)
+        return entryA->mtime < entryB->mtime ? -1 : 1;
+
+    return strcmp(entryA->name, entryB->name);
+}
+
+// Deletes the least recently used entries until the cache is back under
+// three quarters of its size cap, and returns the size that is left.
+static long long EvictEntries(void)
+{
+    int numEntries;
+    long long totalSize;
+    long long sizeLimit = GetCacheSizeLimit() / 4 * 3;
+    struct CacheEntry *entries = ListEntries(&numEntries, &totalSize);
+
+    if (totalSize > sizeLimit)
+    {
+        qsort(entries, numEntries, sizeof(struct CacheEntry), CompareEntriesByAge);
+
+        for (int i = 0; i < numEntries && totalSize > sizeLimit; i++)
+        {
+            char *path = MakeCachePath(entries[i].name);
+
+            if (unlink(path) == 0)
+                totalSize -= entries[i].size;
+
+            free(path);
+        }
+    }
+
+    free(entries);
+
+    return totalSize;
+}
+
+// Opens and locks the stats file and reads it into stats. A missing or short
+// file starts with no hits or misses and the size of the entries on disk.
+// Returns the file descriptor to pass to UnlockStats, or -1 if the file could
+// not be opened, in which case the stats are not kept.
+static int LockStats(struct CacheStats *stats)
+{
+    char *path = MakeCachePath("stats");
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+
+    pthread_mutex_lock(&sStatsMutex);
+    mkdir(GetCacheDir(), 0755);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    free(path);
+
+    if (fd >= 0 && fcntl(fd, F_SETLKW, &lock) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0 || pread(fd, stats, sizeof(*stats), 0) != sizeof(*stats))
+    {
+        int numEntries;
+        long long totalSize;
+
+        free(ListEntries(&numEntries, &totalSize));
+        stats->hits = 0;
+        stats->misses = 0;
+        stats->size = totalSize;
+    }
+
+    return fd;
+}
+
+static void UnlockStats(int fd, struct CacheStats *stats)
+{
+    if (fd >= 0)
+    {
+        if (pwrite(fd, stats, sizeof(*stats), 0) != sizeof(*stats))
+            fprintf(stderr, "Failed to update the cache stats.\n");
+
+        // Closing the file releases the lock.
+        close(fd);
+    }
+
+    pthread_mutex_unlock(&sStatsMutex);
+}
+
+bool CacheIsEnabled(void)
+{
+    return GetCacheDir() != NULL;
+}
+
+void CacheComputeKey(int argc, char **argv, char *outputPath, struct CacheKey *key)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    key->valid = false;
+
+    hash = HashString(hash, __DATE__ " " __TIME__);
+    hash = HashString(hash, GetFullExtension(argv[1]));
+    hash = HashString(hash, GetFullExtension(outputPath));
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-palette") == 0 || strcmp(argv[i], "-tilemap") == 0)
+            return;
+
+        hash = HashString(hash, argv[i]);
+    }
+
+    FILE *fp = fopen(argv[1], "rb");
+
+    if (fp == NULL)
+        return;
+
+    unsigned char buffer[65536];
+    size_t count;
+
+    while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        hash = HashBytes(hash, buffer, count);
+
+    fclose(fp);
+
+    key->hash = hash;
+    key->valid = true;
+}
+
+bool CacheFetch(struct CacheKey *key, char *outputPath)
+{
+    if (!key->valid)
+        return false;
+
+    char name[ENTRY_NAME_LENGTH + 1];
+
+    GetEntryName(key, name);
+
+    char *path = MakeCachePath(name);
+    bool hit = (access(path, R_OK) == 0 && CopyFile(path, outputPath));
+
+    if (hit)
+        utime(path, NULL);
+
+    free(path);
+
+    struct CacheStats stats;
+    int statsFd = LockStats(&stats);
+
+    if (hit)
+        stats.hits++;
+    else
+        stats.misses++;
+
+    UnlockStats(statsFd, &stats);
+
+    return hit;
+}
+
+void CacheStore(struct CacheKey *key, char *outputPath)
+{
+    if (!key->valid)
+        return;
+
+    char name[ENTRY_NAME_LENGTH + 1];
+    char tempName[ENTRY_NAME_LENGTH + 64];
+
+    // Unique per process and per thread, since batch mode stores from many threads.
+    GetEntryName(key, name);
+    sprintf(tempName, "tmp-%s-%ld-%d", name, (long)getpid(), atomic_fetch_add(&sTempFileCounter, 1));
+
+    char *path = MakeCachePath(name);
+    char *tempPath = MakeCachePath(tempName);
+
+    struct stat st;
+    long long sizeChange = 0;
+
+    mkdir(GetCacheDir(), 0755);
+
+    if (CopyFile(outputPath, tempPath) && stat(tempPath, &st) == 0)
+    {
+        sizeChange = st.st_size;
+
+        // Another process may have stored the same entry already.
+        if (stat(path, &st) == 0)
+            sizeChange -= st.st_size;
+
+        if (rename(tempPath, path) != 0)
+        {
+            unlink(tempPath);
+            sizeChange = 0;
+        }
+    }
+    else
+    {
+        unlink(tempPath);
+    }
+
+    free(path);
+    free(tempPath);
+
+    struct CacheStats stats;
+    int statsFd = LockStats(&stats);
+
+    stats.size += sizeChange;
+
+    if (stats.size > GetCacheSizeLimit())
+        stats.size = EvictEntries();
+
+    UnlockStats(statsFd, &stats);
+}
+
+void CachePrintStats(void)
+{
+    if (!CacheIsEnabled())
+        FATAL_ERROR("GBAGFX_CACHE_DIR is not set.\n");
+
+    int numEntries;
+    long long totalSize;
+    struct CacheEntry *entries = ListEntries(&numEntries, &totalSize);
+    struct CacheStats stats;
+    int statsFd = LockStats(&stats);
+
+    // The scan is exact, so correct any drift in the running total.
+    stats.size = totalSize;
+    UnlockStats(statsFd, &stats);
+    free(entries);
+
+    long long hits = stats.hits;
+    long long misses = stats.misses;
+    long long lookups = hits + misses;
+
+    printf("Cache directory: %s\n", GetCacheDir());
+    printf("Entries:         %d\n", numEntries);
+    printf("Size:            %lld / %lld bytes\n", totalSize, GetCacheSizeLimit());
+    printf("Hits:            %lld\n", hits);
+    printf("Misses:          %lld\n", misses);
+    printf("Hit rate:        %.1f%%\n", lookups != 0 ? 100.0 * hits / lookups : 0.0);
+}
+
+void CacheClear(void)
+{
+    if (!CacheIsEnabled())
+        FATAL_ERROR("GBAGFX_CACHE_DIR is not set.\n");
+
+    int numEntries;
+    long long totalSize;
+    struct CacheEntry *entries = ListEntries(&numEntries, &totalSize);
+
+    for (int i = 0; i < numEntries; i++)
+    {
+        char *path = MakeCachePath(entries[i].name);
+        unlink(path);
+        free(path);
+    }
+
+    free(entries);
+
+    char *statsPath = MakeCachePath("stats");
+
+    unlink(statsPath);
+    free(statsPath);
+}
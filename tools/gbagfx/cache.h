@@ -0,0 +1,22 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Content-addressed cache of conversion outputs. It is enabled by setting
+// GBAGFX_CACHE_DIR to a directory; GBAGFX_CACHE_SIZE caps its size in MiB.
+
+struct CacheKey {
+    uint64_t hash;
+    bool valid;
+};
+
+bool CacheIsEnabled(void);
+void CacheComputeKey(int argc, char **argv, char *outputPath, struct CacheKey *key);
+bool CacheFetch(struct CacheKey *key, char *outputPath);
+void CacheStore(struct CacheKey *key, char *outputPath);
+void CachePrintStats(void);
+void CacheClear(void);
+
+#endif // CACHE_H
@@ -345,6 +345,114 @@ static unsigned char *DecodeTilemap(unsigned char *tiles, struct Tilemap *tilema
     return decoded;
 }
 
+#define TILE_HFLIP 1
+#define TILE_VFLIP 2
+
+// Returns the slot of the table that holds this tile, or the empty slot where
+// it would go. The table holds indices into variants, which has tileSize
+// bytes per entry, or -1 for empty slots.
+static int FindTileSlot(int *table, int tableSize, unsigned char *variants, unsigned char *tile, int tileSize)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < tileSize; i++)
+    {
+        hash ^= tile[i];
+        hash *= 16777619u;
+    }
+
+    int slot = hash & (tableSize - 1);
+
+    while (table[slot] >= 0 && memcmp(&variants[table[slot] * tileSize], tile, tileSize) != 0)
+        slot = (slot + 1) & (tableSize - 1);
+
+    return slot;
+}
+
+// The inverse of DecodeTilemap: splits tiles into the distinct ones and a
+// tilemap that rebuilds the original sequence from them. In non-affine maps,
+// a tile that is a flipped copy of an earlier one becomes a flipped entry.
+// Returns the distinct tiles and sets *numUniqueTiles_p to their count.
+unsigned char *BuildTilemap(unsigned char *tiles, int numTiles, int bitDepth, bool isAffine, struct Tilemap *tilemap, int *numUniqueTiles_p)
+{
+    int tileSize = bitDepth * 8;
+    int numFlips = isAffine ? 1 : 4;
+    int maxUniqueTiles = isAffine ? 256 : 1024;
+    int numUniqueTiles = 0;
+
+    // Every flip of every distinct tile gets its own entry in variants.
+    unsigned char *variants = malloc(numTiles * numFlips * tileSize);
+    unsigned char *uniqueTiles = malloc(numTiles * tileSize);
+
+    int tableSize = 1;
+    while (tableSize < numTiles * numFlips * 2)
+        tableSize <<= 1;
+
+    int *table = malloc(tableSize * sizeof(int));
+
+    tilemap->size = numTiles * (isAffine ? 1 : 2);
+    tilemap->data.affine = calloc(tilemap->size, 1);
+
+    if (variants == NULL || uniqueTiles == NULL || table == NULL || tilemap->data.affine == NULL)
+        FATAL_ERROR("Failed to allocate memory for tilemap.\n");
+
+    memset(table, -1, tableSize * sizeof(int));
+
+    for (int i = 0; i < numTiles; i++)
+    {
+        unsigned char *tile = &tiles[i * tileSize];
+        int slot = FindTileSlot(table, tableSize, variants, tile, tileSize);
+
+        if (table[slot] < 0)
+        {
+            if (numUniqueTiles == maxUniqueTiles)
+                FATAL_ERROR("More than %d distinct tiles, which is the limit of %s tilemaps.\n", maxUniqueTiles, isAffine ? "affine" : "non-affine");
+
+            memcpy(&uniqueTiles[numUniqueTiles * tileSize], tile, tileSize);
+
+            // The unflipped tile comes first, so it wins over flipped copies
+            // of itself when the tile is symmetric.
+            for (int flip = 0; flip < numFlips; flip++)
+            {
+                int variant = numUniqueTiles * numFlips + flip;
+                unsigned char *variantTile = &variants[variant * tileSize];
+
+                memcpy(variantTile, tile, tileSize);
+                if (flip & TILE_HFLIP)
+                    HflipTile(variantTile, bitDepth);
+                if (flip & TILE_VFLIP)
+                    VflipTile(variantTile, bitDepth);
+
+                int variantSlot = FindTileSlot(table, tableSize, variants, variantTile, tileSize);
+
+                if (table[variantSlot] < 0)
+                    table[variantSlot] = variant;
+            }
+
+            numUniqueTiles++;
+        }
+
+        int variant = table[slot];
+
+        if (isAffine)
+        {
+            tilemap->data.affine[i] = variant;
+        }
+        else
+        {
+            tilemap->data.non_affine[i].index = variant / numFlips;
+            tilemap->data.non_affine[i].hflip = (variant & TILE_HFLIP) != 0;
+            tilemap->data.non_affine[i].vflip = (variant & TILE_VFLIP) != 0;
+        }
+    }
+
+    free(variants);
+    free(table);
+
+    *numUniqueTiles_p = numUniqueTiles;
+    return uniqueTiles;
+}
+
 void ReadImage(char *path, int tilesWidth, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors)
 {
 	int tileSize = bitDepth * 8;
@@ -397,7 +505,7 @@ void ReadImage(char *path, int tilesWidth, int bitDepth, int metatileWidth, int
 	free(buffer);
 }
 
-void WriteImage(char *path, enum NumTilesMode numTilesMode, int numTiles, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors)
+unsigned char *ConvertImageToTiles(enum NumTilesMode numTilesMode, int numTiles, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors, int *size)
 {
 	int tileSize = bitDepth * 8;
 
@@ -463,7 +571,17 @@ void WriteImage(char *path, enum NumTilesMode numTilesMode, int numTiles, int bi
 		}
 	}
 
-	WriteWholeFile(path, buffer, zeroPadded ? bufferSize : maxBufferSize);
+	*size = zeroPadded ? bufferSize : maxBufferSize;
+
+	return buffer;
+}
+
+void WriteImage(char *path, enum NumTilesMode numTilesMode, int numTiles, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors)
+{
+	int bufferSize;
+	unsigned char *buffer = ConvertImageToTiles(numTilesMode, numTiles, bitDepth, metatileWidth, metatileHeight, image, invertColors, &bufferSize);
+
+	WriteWholeFile(path, buffer, bufferSize);
 
 	free(buffer);
 }
@@ -51,6 +51,8 @@ enum NumTilesMode {
 };
 
 void ReadImage(char *path, int tilesWidth, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors);
+unsigned char *ConvertImageToTiles(enum NumTilesMode numTilesMode, int numTiles, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors, int *size);
+unsigned char *BuildTilemap(unsigned char *tiles, int numTiles, int bitDepth, bool isAffine, struct Tilemap *tilemap, int *numUniqueTiles_p);
 void WriteImage(char *path, enum NumTilesMode numTilesMode, int numTiles, int bitDepth, int metatileWidth, int metatileHeight, struct Image *image, bool invertColors);
 void FreeImage(struct Image *image);
 void ReadGbaPalette(char *path, struct Palette *palette);
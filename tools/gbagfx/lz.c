@@ -69,11 +69,169 @@ fail:
 	FATAL_ERROR("Fatal error while decompressing LZ file.\n");
 }
 
-unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance)
+// Match finder for LZCompress. Every position that has at least three bytes
+// left is linked into a hash chain keyed on those three bytes, so finding the
+// longest match only has to visit earlier positions that could possibly match
+// instead of every distance in the 4 KiB window.
+
+#define LZ_HASH_BITS 16
+#define LZ_HASH_SIZE (1 << LZ_HASH_BITS)
+#define LZ_MAX_DISTANCE 0x1000
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH 18
+
+struct LZMatchFinder {
+	unsigned char *src;
+	int srcSize;
+	int minDistance;
+	int maxChainLength;
+	int nextInsertPos;
+	int *head;
+	int *prev;
+};
+
+// Number of chain links visited per position, indexed by compression level.
+// The highest level walks the whole chain, which gives the same matches as the
+// exhaustive scan and therefore byte-identical output.
+static const int sMaxChainLengths[LZ_LEVEL_MAX + 1] = {
+	-1, // LZ_LEVEL_REFERENCE does not use the hash chains
+	4, 8, 16, 32, 64, 128, 256, 1024, -1
+};
+
+static inline unsigned int LZHash(unsigned char *p)
 {
-	if (srcSize <= 0)
-		goto fail;
+	unsigned int key = (p[0] << 16) | (p[1] << 8) | p[2];
+
+	return (key * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void LZInitMatchFinder(struct LZMatchFinder *finder, unsigned char *src, int srcSize, int minDistance, int level)
+{
+	finder->src = src;
+	finder->srcSize = srcSize;
+	finder->minDistance = minDistance;
+	finder->maxChainLength = sMaxChainLengths[level];
+	finder->nextInsertPos = 0;
+	finder->head = malloc(LZ_HASH_SIZE * sizeof(int));
+	finder->prev = malloc(srcSize * sizeof(int));
+
+	if (finder->head == NULL || finder->prev == NULL)
+		FATAL_ERROR("Failed to allocate memory for LZ match finder.\n");
+
+	for (int i = 0; i < LZ_HASH_SIZE; i++)
+		finder->head[i] = -1;
+}
+
+static void LZFreeMatchFinder(struct LZMatchFinder *finder)
+{
+	free(finder->head);
+	free(finder->prev);
+}
+
+// Links every position before pos into the hash chains.
+static void LZInsertUpTo(struct LZMatchFinder *finder, int pos)
+{
+	int lastHashablePos = finder->srcSize - LZ_MIN_MATCH;
+
+	if (pos > lastHashablePos + 1)
+		pos = lastHashablePos + 1;
+
+	while (finder->nextInsertPos < pos) {
+		int insertPos = finder->nextInsertPos++;
+		unsigned int hash = LZHash(&finder->src[insertPos]);
+
+		finder->prev[insertPos] = finder->head[hash];
+		finder->head[hash] = insertPos;
+	}
+}
+
+static int LZMatchLength(unsigned char *src, int srcSize, int blockStart, int srcPos)
+{
+	int blockSize = 0;
+
+	while (blockSize < LZ_MAX_MATCH
+	    && srcPos + blockSize < srcSize
+	    && src[blockStart + blockSize] == src[srcPos + blockSize])
+		blockSize++;
+
+	return blockSize;
+}
+
+// Finds the longest match for srcPos, preferring the shortest distance among
+// matches of equal length.
+static int LZFindMatchHashChain(struct LZMatchFinder *finder, int srcPos, int *bestBlockDistance)
+{
+	int bestBlockSize = 0;
+
+	*bestBlockDistance = 0;
 
+	if (srcPos + LZ_MIN_MATCH > finder->srcSize)
+		return 0;
+
+	LZInsertUpTo(finder, srcPos);
+
+	int chainLength = finder->maxChainLength;
+	int candidate = finder->head[LZHash(&finder->src[srcPos])];
+
+	while (candidate >= 0) {
+		int blockDistance = srcPos - candidate;
+
+		if (blockDistance > LZ_MAX_DISTANCE)
+			break;
+
+		if (blockDistance >= finder->minDistance) {
+			if (chainLength == 0)
+				break;
+
+			chainLength--;
+
+			int blockSize = LZMatchLength(finder->src, finder->srcSize, candidate, srcPos);
+
+			if (blockSize > bestBlockSize) {
+				*bestBlockDistance = blockDistance;
+				bestBlockSize = blockSize;
+
+				if (blockSize == LZ_MAX_MATCH)
+					break;
+			}
+		}
+
+		candidate = finder->prev[candidate];
+	}
+
+	return bestBlockSize;
+}
+
+// The original exhaustive scan over every distance in the window. It is kept
+// as a reference for benchmarking and for verifying the hash chain search.
+static int LZFindMatchBruteForce(struct LZMatchFinder *finder, int srcPos, int *bestBlockDistance)
+{
+	int bestBlockSize = 0;
+	int blockDistance = finder->minDistance;
+
+	*bestBlockDistance = 0;
+
+	while (blockDistance <= srcPos && blockDistance <= LZ_MAX_DISTANCE) {
+		int blockSize = LZMatchLength(finder->src, finder->srcSize, srcPos - blockDistance, srcPos);
+
+		if (blockSize > bestBlockSize) {
+			*bestBlockDistance = blockDistance;
+			bestBlockSize = blockSize;
+
+			if (blockSize == LZ_MAX_MATCH)
+				break;
+		}
+
+		blockDistance++;
+	}
+
+	return bestBlockSize;
+}
+
+// Writes the compressed stream. Each block is taken from the plan when one is
+// given, otherwise the match finder is asked for the longest match.
+static unsigned char *LZEncode(unsigned char *src, int srcSize, int *compressedSize, struct LZMatchFinder *finder, const int level, const int *plannedSizes, const int *plannedDistances)
+{
 	int worstCaseDestSize = 4 + srcSize + ((srcSize + 7) / 8);
 
 	// Round up to the next multiple of four.
@@ -82,7 +240,7 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 	unsigned char *dest = malloc(worstCaseDestSize);
 
 	if (dest == NULL)
-		goto fail;
+		FATAL_ERROR("Fatal error while compressing LZ file.\n");
 
 	// header
 	dest[0] = 0x10; // LZ compression type
@@ -98,31 +256,19 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 		*flags = 0;
 
 		for (int i = 0; i < 8; i++) {
-			int bestBlockDistance = 0;
-			int bestBlockSize = 0;
-			int blockDistance = minDistance;
-
-			while (blockDistance <= srcPos && blockDistance <= 0x1000) {
-				int blockStart = srcPos - blockDistance;
-				int blockSize = 0;
-
-				while (blockSize < 18
-				    && srcPos + blockSize < srcSize
-				    && src[blockStart + blockSize] == src[srcPos + blockSize])
-					blockSize++;
-
-				if (blockSize > bestBlockSize) {
-					bestBlockDistance = blockDistance;
-					bestBlockSize = blockSize;
-
-					if (blockSize == 18)
-						break;
-				}
-
-				blockDistance++;
+			int bestBlockDistance;
+			int bestBlockSize;
+
+			if (plannedSizes != NULL) {
+				bestBlockSize = plannedSizes[srcPos];
+				bestBlockDistance = plannedDistances[srcPos];
+			} else if (level == LZ_LEVEL_REFERENCE) {
+				bestBlockSize = LZFindMatchBruteForce(finder, srcPos, &bestBlockDistance);
+			} else {
+				bestBlockSize = LZFindMatchHashChain(finder, srcPos, &bestBlockDistance);
 			}
 
-			if (bestBlockSize >= 3) {
+			if (bestBlockSize >= LZ_MIN_MATCH) {
 				*flags |= (0x80 >> i);
 				srcPos += bestBlockSize;
 				bestBlockSize -= 3;
@@ -147,6 +293,81 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 			}
 		}
 	}
+}
+
+unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance, const int level)
+{
+	if (srcSize <= 0)
+		goto fail;
+
+	if (level < LZ_LEVEL_REFERENCE || level > LZ_LEVEL_MAX)
+		goto fail;
+
+	struct LZMatchFinder finder;
+
+	LZInitMatchFinder(&finder, src, srcSize, minDistance, level == LZ_LEVEL_REFERENCE ? LZ_LEVEL_MAX : level);
+
+	unsigned char *dest = LZEncode(src, srcSize, compressedSize, &finder, level, NULL, NULL);
+
+	LZFreeMatchFinder(&finder);
+
+	return dest;
+
+fail:
+	FATAL_ERROR("Fatal error while compressing LZ file.\n");
+}
+
+// Minimum-size parse. Every literal costs 9 bits (a byte plus its flag bit)
+// and every block costs 17 bits regardless of its length or distance, so the
+// cheapest encoding of the remaining input can be found with a single pass
+// from the end of the buffer. A block may be shortened to any length from 3
+// up to the longest match at that position, since every prefix of a match is
+// itself a match at the same distance.
+unsigned char *LZCompressOptimal(unsigned char *src, int srcSize, int *compressedSize, const int minDistance)
+{
+	if (srcSize <= 0)
+		goto fail;
+
+	struct LZMatchFinder finder;
+
+	LZInitMatchFinder(&finder, src, srcSize, minDistance, LZ_LEVEL_MAX);
+
+	int *longestSizes = malloc(srcSize * sizeof(int));
+	int *plannedSizes = malloc(srcSize * sizeof(int));
+	int *plannedDistances = malloc(srcSize * sizeof(int));
+	long long *costs = malloc((srcSize + 1) * sizeof(long long));
+
+	if (longestSizes == NULL || plannedSizes == NULL || plannedDistances == NULL || costs == NULL)
+		goto fail;
+
+	for (int pos = 0; pos < srcSize; pos++)
+		longestSizes[pos] = LZFindMatchHashChain(&finder, pos, &plannedDistances[pos]);
+
+	costs[srcSize] = 0;
+
+	for (int pos = srcSize - 1; pos >= 0; pos--) {
+		costs[pos] = 9 + costs[pos + 1];
+		plannedSizes[pos] = 1;
+
+		for (int blockSize = LZ_MIN_MATCH; blockSize <= longestSizes[pos]; blockSize++) {
+			long long cost = 17 + costs[pos + blockSize];
+
+			if (cost <= costs[pos]) {
+				costs[pos] = cost;
+				plannedSizes[pos] = blockSize;
+			}
+		}
+	}
+
+	unsigned char *dest = LZEncode(src, srcSize, compressedSize, &finder, LZ_LEVEL_MAX, plannedSizes, plannedDistances);
+
+	free(longestSizes);
+	free(plannedSizes);
+	free(plannedDistances);
+	free(costs);
+	LZFreeMatchFinder(&finder);
+
+	return dest;
 
 fail:
 	FATAL_ERROR("Fatal error while compressing LZ file.\n");
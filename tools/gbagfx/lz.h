@@ -3,7 +3,17 @@
 #ifndef LZ_H
 #define LZ_H
 
+// Compression levels for LZCompress. Lower levels limit how many earlier
+// positions the match finder examines, trading compression ratio for speed.
+// LZ_LEVEL_MAX examines every candidate and produces the same output as the
+// original exhaustive search, which LZ_LEVEL_REFERENCE still runs.
+#define LZ_LEVEL_REFERENCE 0
+#define LZ_LEVEL_MIN 1
+#define LZ_LEVEL_MAX 9
+#define LZ_LEVEL_DEFAULT LZ_LEVEL_MAX
+
 unsigned char *LZDecompress(unsigned char *src, int srcSize, int *uncompressedSize);
-unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance);
+unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance, const int level);
+unsigned char *LZCompressOptimal(unsigned char *src, int srcSize, int *compressedSize, const int minDistance);
 
 #endif // LZ_H
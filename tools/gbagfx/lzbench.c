@@ -0,0 +1,118 @@
+// Measures LZCompress throughput. Every input file is compressed once with the
+// reference exhaustive search and once with the requested level, and the
+// throughput of each is reported. At LZ_LEVEL_MAX the two outputs are
+// also checked for being byte-identical.
+//
+// Usage: lzbench [-level N] [-search N] FILES...
+// e.g.   tools/gbagfx/lzbench $(find graphics -name '*.4bpp')
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "global.h"
+#include "util.h"
+#include "lz.h"
+
+static double GetTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double TimeCompress(unsigned char *buffer, int fileSize, int minDistance, int level, unsigned char **compressedData, int *compressedSize)
+{
+    double start = GetTime();
+
+    *compressedData = LZCompress(buffer, fileSize, compressedSize, minDistance, level);
+
+    return GetTime() - start;
+}
+
+int main(int argc, char **argv)
+{
+    int level = LZ_LEVEL_DEFAULT;
+    int minDistance = 2;
+    int firstFile = 1;
+
+    while (firstFile < argc && argv[firstFile][0] == '-')
+    {
+        char *option = argv[firstFile];
+
+        if (firstFile + 1 >= argc)
+            FATAL_ERROR("No value following \"%s\".\n", option);
+
+        if (strcmp(option, "-level") == 0)
+        {
+            if (!ParseNumber(argv[firstFile + 1], NULL, 10, &level) || level < LZ_LEVEL_MIN || level > LZ_LEVEL_MAX)
+                FATAL_ERROR("LZ compression level must be between %d and %d.\n", LZ_LEVEL_MIN, LZ_LEVEL_MAX);
+        }
+        else if (strcmp(option, "-search") == 0)
+        {
+            if (!ParseNumber(argv[firstFile + 1], NULL, 10, &minDistance) || minDistance < 1)
+                FATAL_ERROR("LZ min search distance must be positive.\n");
+        }
+        else
+        {
+            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
+        }
+
+        firstFile += 2;
+    }
+
+    if (firstFile >= argc)
+        FATAL_ERROR("Usage: lzbench [-level N] [-search N] FILES...\n");
+
+    long long totalInput = 0;
+    long long totalReferenceOutput = 0;
+    long long totalOutput = 0;
+    double referenceTime = 0;
+    double time = 0;
+    int mismatches = 0;
+
+    for (int i = firstFile; i < argc; i++)
+    {
+        int fileSize;
+        unsigned char *buffer = ReadWholeFile(argv[i], &fileSize);
+
+        if (fileSize == 0)
+        {
+            free(buffer);
+            continue;
+        }
+
+        unsigned char *referenceData;
+        unsigned char *compressedData;
+        int referenceSize;
+        int compressedSize;
+
+        referenceTime += TimeCompress(buffer, fileSize, minDistance, LZ_LEVEL_REFERENCE, &referenceData, &referenceSize);
+        time += TimeCompress(buffer, fileSize, minDistance, level, &compressedData, &compressedSize);
+
+        if (level == LZ_LEVEL_MAX
+         && (referenceSize != compressedSize || memcmp(referenceData, compressedData, compressedSize) != 0))
+        {
+            fprintf(stderr, "Output mismatch for \"%s\".\n", argv[i]);
+            mismatches++;
+        }
+
+        totalInput += fileSize;
+        totalReferenceOutput += referenceSize;
+        totalOutput += compressedSize;
+
+        free(referenceData);
+        free(compressedData);
+        free(buffer);
+    }
+
+    double megabytes = totalInput / (1024.0 * 1024.0);
+
+    printf("%d files, %lld bytes\n", argc - firstFile, totalInput);
+    printf("reference: %8.3f MB/s, %lld bytes\n", megabytes / referenceTime, totalReferenceOutput);
+    printf("level %d:   %8.3f MB/s, %lld bytes\n", level, megabytes / time, totalOutput);
+
+    return mismatches != 0;
+}
@@ -13,6 +13,8 @@
 #include "rl.h"
 #include "font.h"
 #include "huff.h"
+#include "batch.h"
+#include "cache.h"
 
 struct CommandHandler
 {
@@ -68,7 +70,9 @@ void ConvertGbaToPng(char *inputPath, char *outputPath, struct GbaToPngOptions *
     FreeImage(&image);
 }
 
-void ConvertPngToGba(char *inputPath, char *outputPath, struct PngToGbaOptions *options)
+// Converts the PNG to tiles. With -tilemap, only the distinct tiles are
+// returned and the tilemap that places them is written to its own file.
+unsigned char *ConvertPngToTiles(char *inputPath, char *outputPath, struct PngToGbaOptions *options, int *size)
 {
     struct Image image;
 
@@ -77,9 +81,39 @@ void ConvertPngToGba(char *inputPath, char *outputPath, struct PngToGbaOptions *
 
     ReadPng(inputPath, &image);
 
-    WriteImage(outputPath, options->numTilesMode, options->numTiles, options->bitDepth, options->metatileWidth, options->metatileHeight, &image, !image.hasPalette);
+    unsigned char *buffer = ConvertImageToTiles(options->numTilesMode, options->numTiles, options->bitDepth, options->metatileWidth, options->metatileHeight, &image, !image.hasPalette, size);
 
     FreeImage(&image);
+
+    if (options->tilemapFilePath != NULL)
+    {
+        struct Tilemap tilemap;
+        int numTiles = *size / (options->bitDepth * 8);
+        int numUniqueTiles;
+        unsigned char *uniqueTiles = BuildTilemap(buffer, numTiles, options->bitDepth, options->isAffineMap, &tilemap, &numUniqueTiles);
+
+        WriteWholeFile(options->tilemapFilePath, tilemap.data.affine, tilemap.size);
+
+        printf("%s: %d tiles, %d unique, saved %d tiles\n", outputPath, numTiles, numUniqueTiles, numTiles - numUniqueTiles);
+
+        free(tilemap.data.affine);
+        free(buffer);
+
+        buffer = uniqueTiles;
+        *size = numUniqueTiles * options->bitDepth * 8;
+    }
+
+    return buffer;
+}
+
+void ConvertPngToGba(char *inputPath, char *outputPath, struct PngToGbaOptions *options)
+{
+    int size;
+    unsigned char *buffer = ConvertPngToTiles(inputPath, outputPath, options, &size);
+
+    WriteWholeFile(outputPath, buffer, size);
+
+    free(buffer);
 }
 
 void HandleGbaToPngCommand(char *inputPath, char *outputPath, int argc, char **argv)
@@ -174,74 +208,116 @@ void HandleGbaToPngCommand(char *inputPath, char *outputPath, int argc, char **a
     ConvertGbaToPng(inputPath, outputPath, &options);
 }
 
-void HandlePngToGbaCommand(char *inputPath, char *outputPath, int argc, char **argv)
+// Parses one PNG to GBA option. Returns false if argv[*i] isn't one.
+bool ParsePngToGbaOption(int argc, char **argv, int *i, struct PngToGbaOptions *options)
 {
-    char *outputFileExtension = GetFileExtensionAfterDot(outputPath);
-    int bitDepth = outputFileExtension[0] - '0';
-    struct PngToGbaOptions options;
-    options.numTilesMode = NUM_TILES_IGNORE;
-    options.numTiles = 0;
-    options.bitDepth = bitDepth;
-    options.metatileWidth = 1;
-    options.metatileHeight = 1;
-    options.tilemapFilePath = NULL;
-    options.isAffineMap = false;
+    char *option = argv[*i];
 
-    for (int i = 3; i < argc; i++)
+    if (strcmp(option, "-num_tiles") == 0)
     {
-        char *option = argv[i];
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No number of tiles following \"-num_tiles\".\n");
 
-        if (strcmp(option, "-num_tiles") == 0)
-        {
-            if (i + 1 >= argc)
-                FATAL_ERROR("No number of tiles following \"-num_tiles\".\n");
+        (*i)++;
 
-            i++;
+        if (!ParseNumber(argv[*i], NULL, 10, &options->numTiles))
+            FATAL_ERROR("Failed to parse number of tiles.\n");
 
-            if (!ParseNumber(argv[i], NULL, 10, &options.numTiles))
-                FATAL_ERROR("Failed to parse number of tiles.\n");
+        if (options->numTiles < 1)
+            FATAL_ERROR("Number of tiles must be positive.\n");
+    }
+    else if (strcmp(option, "-Wnum_tiles") == 0) {
+        options->numTilesMode = NUM_TILES_WARN;
+    }
+    else if (strcmp(option, "-Werror=num_tiles") == 0) {
+        options->numTilesMode = NUM_TILES_ERROR;
+    }
+    else if (strcmp(option, "-mwidth") == 0)
+    {
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No metatile width value following \"-mwidth\".\n");
 
-            if (options.numTiles < 1)
-                FATAL_ERROR("Number of tiles must be positive.\n");
-        }
-        else if (strcmp(option, "-Wnum_tiles") == 0) {
-            options.numTilesMode = NUM_TILES_WARN;
-        }
-        else if (strcmp(option, "-Werror=num_tiles") == 0) {
-            options.numTilesMode = NUM_TILES_ERROR;
-        }
-        else if (strcmp(option, "-mwidth") == 0)
-        {
-            if (i + 1 >= argc)
-                FATAL_ERROR("No metatile width value following \"-mwidth\".\n");
+        (*i)++;
 
-            i++;
+        if (!ParseNumber(argv[*i], NULL, 10, &options->metatileWidth))
+            FATAL_ERROR("Failed to parse metatile width.\n");
 
-            if (!ParseNumber(argv[i], NULL, 10, &options.metatileWidth))
-                FATAL_ERROR("Failed to parse metatile width.\n");
+        if (options->metatileWidth < 1)
+            FATAL_ERROR("metatile width must be positive.\n");
+    }
+    else if (strcmp(option, "-mheight") == 0)
+    {
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No metatile height value following \"-mheight\".\n");
 
-            if (options.metatileWidth < 1)
-                FATAL_ERROR("metatile width must be positive.\n");
-        }
-        else if (strcmp(option, "-mheight") == 0)
-        {
-            if (i + 1 >= argc)
-                FATAL_ERROR("No metatile height value following \"-mheight\".\n");
+        (*i)++;
 
-            i++;
+        if (!ParseNumber(argv[*i], NULL, 10, &options->metatileHeight))
+            FATAL_ERROR("Failed to parse metatile height.\n");
 
-            if (!ParseNumber(argv[i], NULL, 10, &options.metatileHeight))
-                FATAL_ERROR("Failed to parse metatile height.\n");
+        if (options->metatileHeight < 1)
+            FATAL_ERROR("metatile height must be positive.\n");
+    }
+    else if (strcmp(option, "-tilemap") == 0)
+    {
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No tilemap value following \"-tilemap\".\n");
 
-            if (options.metatileHeight < 1)
-                FATAL_ERROR("metatile height must be positive.\n");
-        }
-        else
-        {
-            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
-        }
+        (*i)++;
+
+        options->tilemapFilePath = argv[*i];
+    }
+    else if (strcmp(option, "-affine") == 0)
+    {
+        options->isAffineMap = true;
+    }
+    else
+    {
+        return false;
     }
 
+    return true;
+}
+
+void CheckPngToGbaOptions(struct PngToGbaOptions *options)
+{
+    if (options->tilemapFilePath != NULL && options->bitDepth != 4 && options->bitDepth != 8)
+        FATAL_ERROR("tilemaps are only supported for 4bpp and 8bpp tiles\n");
+
+    if (options->isAffineMap && options->tilemapFilePath == NULL)
+        FATAL_ERROR("\"-affine\" requires \"-tilemap\"\n");
+
+    if (options->isAffineMap && options->bitDepth != 8)
+        FATAL_ERROR("affine maps are necessarily 8bpp\n");
+}
+
+void InitPngToGbaOptions(struct PngToGbaOptions *options, int bitDepth)
+{
+    options->numTilesMode = NUM_TILES_IGNORE;
+    options->numTiles = 0;
+    options->bitDepth = bitDepth;
+    options->metatileWidth = 1;
+    options->metatileHeight = 1;
+    options->tilemapFilePath = NULL;
+    options->isAffineMap = false;
+}
+
+void HandlePngToGbaCommand(char *inputPath, char *outputPath, int argc, char **argv)
+{
+    char *outputFileExtension = GetFileExtensionAfterDot(outputPath);
+    int bitDepth = outputFileExtension[0] - '0';
+    struct PngToGbaOptions options;
+
+    InitPngToGbaOptions(&options, bitDepth);
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (!ParsePngToGbaOption(argc, argv, &i, &options))
+            FATAL_ERROR("Unrecognized option \"%s\".\n", argv[i]);
+    }
+
+    CheckPngToGbaOptions(&options);
+
     ConvertPngToGba(inputPath, outputPath, &options);
 }
 
@@ -378,45 +454,114 @@ void HandlePngToFullwidthJapaneseFontCommand(char *inputPath, char *outputPath,
     FreeImage(&image);
 }
 
-void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char **argv)
+// Parses one LZ compression option. Returns false if argv[*i] isn't one.
+bool ParseLZOption(int argc, char **argv, int *i, struct LZOptions *options)
 {
-    int overflowSize = 0;
-    int minDistance = 2; // default, for compatibility with LZ77UnCompVram()
+    char *option = argv[*i];
 
-    for (int i = 3; i < argc; i++)
+    if (strcmp(option, "-overflow") == 0)
     {
-        char *option = argv[i];
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No size following \"-overflow\".\n");
 
-        if (strcmp(option, "-overflow") == 0)
-        {
-            if (i + 1 >= argc)
-                FATAL_ERROR("No size following \"-overflow\".\n");
+        (*i)++;
 
-            i++;
+        if (!ParseNumber(argv[*i], NULL, 10, &options->overflowSize))
+            FATAL_ERROR("Failed to parse overflow size.\n");
 
-            if (!ParseNumber(argv[i], NULL, 10, &overflowSize))
-                FATAL_ERROR("Failed to parse overflow size.\n");
+        if (options->overflowSize < 1)
+            FATAL_ERROR("Overflow size must be positive.\n");
+    }
+    else if (strcmp(option, "-search") == 0)
+    {
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No size following \"-overflow\".\n");
 
-            if (overflowSize < 1)
-                FATAL_ERROR("Overflow size must be positive.\n");
-        }
-        else if (strcmp(option, "-search") == 0)
-        {
-            if (i + 1 >= argc)
-                FATAL_ERROR("No size following \"-overflow\".\n");
+        (*i)++;
 
-            i++;
+        if (!ParseNumber(argv[*i], NULL, 10, &options->minDistance))
+            FATAL_ERROR("Failed to parse LZ min search distance.\n");
 
-            if (!ParseNumber(argv[i], NULL, 10, &minDistance))
-                FATAL_ERROR("Failed to parse LZ min search distance.\n");
+        if (options->minDistance < 1)
+            FATAL_ERROR("LZ min search distance must be positive.\n");
+    }
+    else if (strcmp(option, "-level") == 0)
+    {
+        if (*i + 1 >= argc)
+            FATAL_ERROR("No level following \"-level\".\n");
 
-            if (minDistance < 1)
-                FATAL_ERROR("LZ min search distance must be positive.\n");
-        }
-        else
-        {
-            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
-        }
+        (*i)++;
+
+        if (!ParseNumber(argv[*i], NULL, 10, &options->level))
+            FATAL_ERROR("Failed to parse LZ compression level.\n");
+
+        if (options->level < LZ_LEVEL_REFERENCE || options->level > LZ_LEVEL_MAX)
+            FATAL_ERROR("LZ compression level must be between %d and %d.\n", LZ_LEVEL_REFERENCE, LZ_LEVEL_MAX);
+    }
+    else if (strcmp(option, "-optimal") == 0)
+    {
+        options->optimal = true;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void InitLZOptions(struct LZOptions *options)
+{
+    options->overflowSize = 0;
+    options->minDistance = 2; // default, for compatibility with LZ77UnCompVram()
+    options->level = LZ_LEVEL_DEFAULT;
+    options->optimal = false;
+}
+
+// Compresses size bytes of buffer, which must be followed by
+// options->overflowSize zero bytes, and writes the result to outputPath.
+void WriteLZCompressed(char *outputPath, unsigned char *buffer, int size, struct LZOptions *options)
+{
+    int compressedSize;
+    unsigned char *compressedData;
+
+    if (options->optimal)
+    {
+        // The optimal parse does not depend on the level, but the greedy
+        // output is still produced so the saving can be reported.
+        int greedySize;
+        unsigned char *greedyData = LZCompress(buffer, size + options->overflowSize, &greedySize, options->minDistance, options->level);
+
+        compressedData = LZCompressOptimal(buffer, size + options->overflowSize, &compressedSize, options->minDistance);
+
+        printf("%s: %d bytes, greedy %d bytes, saved %d bytes\n", outputPath, compressedSize, greedySize, greedySize - compressedSize);
+
+        free(greedyData);
+    }
+    else
+    {
+        compressedData = LZCompress(buffer, size + options->overflowSize, &compressedSize, options->minDistance, options->level);
+    }
+
+    compressedData[1] = (unsigned char)size;
+    compressedData[2] = (unsigned char)(size >> 8);
+    compressedData[3] = (unsigned char)(size >> 16);
+
+    WriteWholeFile(outputPath, compressedData, compressedSize);
+
+    free(compressedData);
+}
+
+void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char **argv)
+{
+    struct LZOptions options;
+
+    InitLZOptions(&options);
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (!ParseLZOption(argc, argv, &i, &options))
+            FATAL_ERROR("Unrecognized option \"%s\".\n", argv[i]);
     }
 
     // The overflow option allows a quirk in some of Ruby/Sapphire's tilesets
@@ -426,20 +571,63 @@ void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char *
     // the data.
 
     int fileSize;
-    unsigned char *buffer = ReadWholeFileZeroPadded(inputPath, &fileSize, overflowSize);
-
-    int compressedSize;
-    unsigned char *compressedData = LZCompress(buffer, fileSize + overflowSize, &compressedSize, minDistance);
+    unsigned char *buffer = ReadWholeFileZeroPadded(inputPath, &fileSize, options.overflowSize);
 
-    compressedData[1] = (unsigned char)fileSize;
-    compressedData[2] = (unsigned char)(fileSize >> 8);
-    compressedData[3] = (unsigned char)(fileSize >> 16);
+    WriteLZCompressed(outputPath, buffer, fileSize, &options);
 
     free(buffer);
+}
 
-    WriteWholeFile(outputPath, compressedData, compressedSize);
+// Converts a PNG straight to compressed tiles, e.g. "front.png front.4bpp.lz",
+// without writing the uncompressed tiles to disk. The output is identical to
+// converting to .4bpp first and compressing that file. Any other output of the
+// form "*.lz" compresses the input file as is.
+void HandlePngToCompressedGbaCommand(char *inputPath, char *outputPath, int argc, char **argv)
+{
+    char *lzExtension = GetFileExtension(outputPath);
+    char *gfxExtension = lzExtension;
 
-    free(compressedData);
+    while (gfxExtension > outputPath && gfxExtension[-1] != '.')
+        gfxExtension--;
+
+    if (gfxExtension == outputPath
+     || lzExtension - gfxExtension != 4
+     || (strncmp(gfxExtension, "1bpp", 4) != 0 && strncmp(gfxExtension, "4bpp", 4) != 0 && strncmp(gfxExtension, "8bpp", 4) != 0))
+    {
+        HandleLZCompressCommand(inputPath, outputPath, argc, argv);
+        return;
+    }
+
+    struct PngToGbaOptions pngOptions;
+    struct LZOptions lzOptions;
+
+    InitPngToGbaOptions(&pngOptions, gfxExtension[0] - '0');
+    InitLZOptions(&lzOptions);
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (!ParsePngToGbaOption(argc, argv, &i, &pngOptions) && !ParseLZOption(argc, argv, &i, &lzOptions))
+            FATAL_ERROR("Unrecognized option \"%s\".\n", argv[i]);
+    }
+
+    CheckPngToGbaOptions(&pngOptions);
+
+    int size;
+    unsigned char *buffer = ConvertPngToTiles(inputPath, outputPath, &pngOptions, &size);
+
+    if (lzOptions.overflowSize != 0)
+    {
+        buffer = realloc(buffer, size + lzOptions.overflowSize);
+
+        if (buffer == NULL)
+            FATAL_ERROR("Failed to allocate memory for overflow.\n");
+
+        memset(buffer + size, 0, lzOptions.overflowSize);
+    }
+
+    WriteLZCompressed(outputPath, buffer, size, &lzOptions);
+
+    free(buffer);
 }
 
 void HandleLZDecompressCommand(char *inputPath, char *outputPath, int argc UNUSED, char **argv UNUSED)
@@ -542,13 +730,10 @@ void HandleHuffDecompressCommand(char *inputPath, char *outputPath, int argc UNU
     free(uncompressedData);
 }
 
-int main(int argc, char **argv)
+void ConvertFile(int argc, char **argv)
 {
     char converted = 0;
 
-    if (argc < 3)
-        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n");
-
     struct CommandHandler handlers[] =
     {
         { "1bpp", "png", HandleGbaToPngCommand },
@@ -568,6 +753,7 @@ int main(int argc, char **argv)
         { "fwjpnfont", "png", HandleFullwidthJapaneseFontToPngCommand },
         { "png", "fwjpnfont", HandlePngToFullwidthJapaneseFontCommand },
         { NULL, "huff", HandleHuffCompressCommand },
+        { "png", "lz", HandlePngToCompressedGbaCommand },
         { NULL, "lz", HandleLZCompressCommand },
         { "huff", NULL, HandleHuffDecompressCommand },
         { "lz", NULL, HandleLZDecompressCommand },
@@ -617,7 +803,23 @@ int main(int argc, char **argv)
         if ((handlers[i].inputFileExtension == NULL || strcmp(handlers[i].inputFileExtension, inputFileExtension) == 0)
             && (handlers[i].outputFileExtension == NULL || strcmp(handlers[i].outputFileExtension, outputFileExtension) == 0))
         {
-            handlers[i].function(inputPath, outputPath, argc, argv);
+            if (CacheIsEnabled())
+            {
+                struct CacheKey key;
+
+                CacheComputeKey(argc, argv, outputPath, &key);
+
+                if (!CacheFetch(&key, outputPath))
+                {
+                    handlers[i].function(inputPath, outputPath, argc, argv);
+                    CacheStore(&key, outputPath);
+                }
+            }
+            else
+            {
+                handlers[i].function(inputPath, outputPath, argc, argv);
+            }
+
             converted = 1;
             break;
         }
@@ -628,6 +830,61 @@ int main(int argc, char **argv)
 
     if (!converted)
         FATAL_ERROR("Don't know how to convert \"%s\" to \"%s\".\n", argv[1], argv[2]);
+}
+
+void HandleBatchCommand(int argc, char **argv)
+{
+    int numThreads = 0;
+
+    for (int i = 3; i < argc; i++)
+    {
+        char *option = argv[i];
+
+        if (strcmp(option, "-j") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("No number of threads following \"-j\".\n");
+
+            i++;
+
+            if (!ParseNumber(argv[i], NULL, 10, &numThreads))
+                FATAL_ERROR("Failed to parse number of threads.\n");
+
+            if (numThreads < 1)
+                FATAL_ERROR("Number of threads must be positive.\n");
+        }
+        else
+        {
+            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
+        }
+    }
+
+    RunBatch(argv[2], numThreads, ConvertFile);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--cache-stats") == 0)
+    {
+        CachePrintStats();
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "--cache-clear") == 0)
+    {
+        CacheClear();
+        return 0;
+    }
+
+    if (argc < 3)
+        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n"
+                    "       gbagfx --batch MANIFEST_PATH [-j THREADS]\n"
+                    "       gbagfx --cache-stats | --cache-clear\n");
+
+    if (strcmp(argv[1], "--batch") == 0)
+        HandleBatchCommand(argc, argv);
+    else
+        ConvertFile(argc, argv);
 
     return 0;
 }
@@ -27,4 +27,11 @@ struct PngToGbaOptions {
     bool isAffineMap;
 };
 
+struct LZOptions {
+    int overflowSize;
+    int minDistance;
+    int level;
+    bool optimal;
+};
+
 #endif // OPTIONS_H
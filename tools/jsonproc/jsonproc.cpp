@@ -10,11 +10,26 @@ using std::string; using std::to_string;
 #include <algorithm>
 using std::replace_if;
 
+#include <vector>
+using std::vector;
+
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
 #include <inja.hpp>
 using namespace inja;
 using json = nlohmann::json;
 
-std::map<string, string> customVars;
+// Per thread, since batch jobs are rendered in parallel and each job must
+// start out with no variables set, just like a separate jsonproc run.
+thread_local std::map<string, string> customVars;
+
+// The files of the job being rendered, for doNotModifyHeader.
+thread_local string currentJsonFilepath;
+thread_local string currentTemplateFilepath;
 
 void set_custom_var(string key, string value)
 {
@@ -26,21 +41,11 @@ string get_custom_var(string key)
     return customVars[key];
 }
 
-int main(int argc, char *argv[])
+void add_callbacks(Environment &env)
 {
-    if (argc != 4)
-        FATAL_ERROR("USAGE: jsonproc <json-filepath> <template-filepath> <output-filepath>\n");
-
-    string jsonfilepath = argv[1];
-    string templateFilepath = argv[2];
-    string outputFilepath = argv[3];
-
-    Environment env;
-    env.set_trim_blocks(true);
-
     // Add custom command callbacks.
-    env.add_callback("doNotModifyHeader", 0, [jsonfilepath, templateFilepath](Arguments& args) {
-        return "//\n// DO NOT MODIFY THIS FILE! It is auto-generated from " + jsonfilepath +" and Inja template " + templateFilepath + "\n//\n";
+    env.add_callback("doNotModifyHeader", 0, [](Arguments& args) {
+        return "//\n// DO NOT MODIFY THIS FILE! It is auto-generated from " + currentJsonFilepath +" and Inja template " + currentTemplateFilepath + "\n//\n";
     });
 
     env.add_callback("subtract", 2, [](Arguments& args) {
@@ -115,9 +120,169 @@ int main(int argc, char *argv[])
         return str;
     });
 
+}
+
+string render_job(Environment &env, const Template &tmpl, const json &data, const string &jsonFilepath, const string &templateFilepath)
+{
+    customVars.clear();
+    currentJsonFilepath = jsonFilepath;
+    currentTemplateFilepath = templateFilepath;
+
+    return env.render(tmpl, data);
+}
+
+void write_output(const string &outputFilepath, const string &text)
+{
+    std::ofstream file(outputFilepath);
+
+    if (!file.is_open())
+        FATAL_ERROR("JSONPROC_ERROR: Cannot open %s for writing.\n", outputFilepath.c_str());
+
+    file << text;
+}
+
+// Returns whether the file exists and already has this content.
+bool output_is_unchanged(const string &outputFilepath, const string &text)
+{
+    std::ifstream file(outputFilepath);
+
+    if (!file.is_open())
+        return false;
+
+    std::ostringstream oldText;
+    oldText << file.rdbuf();
+
+    return oldText.str() == text;
+}
+
+struct BatchJob
+{
+    string jsonFilepath;
+    string templateFilepath;
+    string outputFilepath;
+};
+
+// Renders every "JSON TEMPLATE OUTPUT" line of the manifest. Each template and
+// JSON file is parsed once, however many jobs use it, and outputs whose
+// content didn't change are left untouched so make won't rebuild their users.
+void process_batch(const string &manifestFilepath, int numThreads)
+{
+    std::ifstream manifest(manifestFilepath);
+
+    if (!manifest.is_open())
+        FATAL_ERROR("JSONPROC_ERROR: Cannot open %s for reading.\n", manifestFilepath.c_str());
+
+    vector<BatchJob> jobs;
+    string line;
+
+    while (std::getline(manifest, line))
+    {
+        std::istringstream fields(line);
+        BatchJob job;
+
+        if (!(fields >> job.jsonFilepath) || job.jsonFilepath[0] == '#')
+            continue;
+
+        if (!(fields >> job.templateFilepath >> job.outputFilepath))
+            FATAL_ERROR("JSONPROC_ERROR: %s: expected \"JSON TEMPLATE OUTPUT\" in \"%s\".\n", manifestFilepath.c_str(), line.c_str());
+
+        jobs.push_back(job);
+    }
+
+    Environment env;
+    env.set_trim_blocks(true);
+    add_callbacks(env);
+
+    std::map<string, Template> templates;
+    std::map<string, json> jsonData;
+
+    try
+    {
+        for (const BatchJob &job : jobs)
+        {
+            if (templates.find(job.templateFilepath) == templates.end())
+                templates.emplace(job.templateFilepath, env.parse_template(job.templateFilepath));
+
+            if (jsonData.find(job.jsonFilepath) == jsonData.end())
+                jsonData.emplace(job.jsonFilepath, env.load_json(job.jsonFilepath));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        FATAL_ERROR("JSONPROC_ERROR: %s\n", e.what());
+    }
+
+    std::atomic<size_t> nextJob(0);
+
+    auto worker = [&]()
+    {
+        size_t i;
+
+        while ((i = nextJob++) < jobs.size())
+        {
+            const BatchJob &job = jobs[i];
+            string text;
+
+            try
+            {
+                text = render_job(env, templates.at(job.templateFilepath), jsonData.at(job.jsonFilepath), job.jsonFilepath, job.templateFilepath);
+            }
+            catch (const std::exception& e)
+            {
+                FATAL_ERROR("JSONPROC_ERROR: %s: %s\n", job.outputFilepath.c_str(), e.what());
+            }
+
+            if (!output_is_unchanged(job.outputFilepath, text))
+                write_output(job.outputFilepath, text);
+        }
+    };
+
+    if (static_cast<size_t>(numThreads) > jobs.size())
+        numThreads = jobs.size();
+
+    vector<std::thread> threads;
+
+    for (int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+    {
+        int numThreads = std::thread::hardware_concurrency();
+
+        if (argc == 5 && strcmp(argv[3], "-j") == 0)
+            numThreads = std::atoi(argv[4]);
+        else if (argc != 3)
+            FATAL_ERROR("USAGE: jsonproc --batch <manifest-filepath> [-j <threads>]\n");
+
+        process_batch(argv[2], numThreads < 1 ? 1 : numThreads);
+        return 0;
+    }
+
+    if (argc != 4)
+        FATAL_ERROR("USAGE: jsonproc <json-filepath> <template-filepath> <output-filepath>\n"
+                    "       jsonproc --batch <manifest-filepath> [-j <threads>]\n");
+
+    string jsonfilepath = argv[1];
+    string templateFilepath = argv[2];
+    string outputFilepath = argv[3];
+
+    Environment env;
+    env.set_trim_blocks(true);
+    add_callbacks(env);
+
     try
     {
-        env.write_with_json_file(templateFilepath, jsonfilepath, outputFilepath);
+        Template tmpl = env.parse_template(templateFilepath);
+        json data = env.load_json(jsonfilepath);
+        write_output(outputFilepath, render_job(env, tmpl, data, jsonfilepath, templateFilepath));
     }
     catch (const std::exception& e)
     {
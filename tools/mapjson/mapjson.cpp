@@ -61,6 +61,41 @@ void write_text_file(string filepath, string text) {
     out_file.close();
 }
 
+// Leaves the file (and its timestamp) alone if it already has this content,
+// so that make doesn't rebuild whatever includes it. Returns whether it wrote.
+bool write_text_file_if_changed(string filepath, string text) {
+    ifstream in_file(filepath, std::ifstream::binary);
+
+    if (in_file.is_open()) {
+        in_file.seekg(0, std::ios::end);
+
+        if (static_cast<size_t>(in_file.tellg()) == text.size()) {
+            string old_text(text.size(), '\0');
+            in_file.seekg(0, std::ios::beg);
+            in_file.read(&old_text[0], old_text.size());
+
+            if (old_text == text)
+                return false;
+        }
+
+        in_file.close();
+    }
+
+    write_text_file(filepath, text);
+
+    return true;
+}
+
+Json parse_json_file(string filepath) {
+    string err;
+    Json data = Json::parse(read_text_file(filepath), err);
+
+    if (data == Json())
+        FATAL_ERROR("%s: %s\n", filepath.c_str(), err.c_str());
+
+    return data;
+}
+
 
 string json_to_string(const Json &data, const string &field = "", bool silent = false) {
     const Json value = !field.empty() ? data[field] : data;
@@ -446,10 +481,7 @@ string generate_events_text(Json groups_data) {
     return text.str();
 }
 
-string generate_map_constants_text(string groups_filepath, Json groups_data) {
-    string file_dir = get_directory_name(groups_filepath);
-    char dir_separator = file_dir.back();
-
+string generate_map_constants_text(Json groups_data, const map<string, Json> &maps_data) {
     ostringstream text;
 
     text << "#ifndef GUARD_CONSTANTS_MAP_GROUPS_H\n"
@@ -466,12 +498,7 @@ string generate_map_constants_text(string groups_filepath, Json groups_data) {
         size_t max_length = 0;
 
         for (auto &map_name : groups_data[groupName].array_items()) {
-            string map_filepath = file_dir + json_to_string(map_name) + dir_separator + "map.json";
-            string err_str;
-            Json map_data = Json::parse(read_text_file(map_filepath), err_str);
-            if (map_data == Json())
-                FATAL_ERROR("%s: %s\n", map_filepath.c_str(), err_str.c_str());
-            string id = json_to_string(map_data, "id", true);
+            string id = json_to_string(maps_data.at(json_to_string(map_name)), "id", true);
             map_ids.push_back(id);
             if (id.length() > max_length)
                 max_length = id.length();
@@ -493,6 +520,22 @@ string generate_map_constants_text(string groups_filepath, Json groups_data) {
     return text.str();
 }
 
+// Parses the map.json of every map in map_groups.json, keyed by map name.
+map<string, Json> read_maps_data(string groups_filepath, Json groups_data) {
+    string file_dir = get_directory_name(groups_filepath);
+    char dir_separator = file_dir.back();
+    map<string, Json> maps_data;
+
+    for (auto &group : groups_data["group_order"].array_items()) {
+        for (auto &map_name : groups_data[json_to_string(group)].array_items()) {
+            string name = json_to_string(map_name);
+            maps_data[name] = parse_json_file(file_dir + name + dir_separator + "map.json");
+        }
+    }
+
+    return maps_data;
+}
+
 void process_groups(string groups_filepath) {
     string err;
     Json groups_data = Json::parse(read_text_file(groups_filepath), err);
@@ -504,7 +547,7 @@ void process_groups(string groups_filepath) {
     string connections_text = generate_connections_text(groups_data);
     string headers_text = generate_headers_text(groups_data);
     string events_text = generate_events_text(groups_data);
-    string map_header_text = generate_map_constants_text(groups_filepath, groups_data);
+    string map_header_text = generate_map_constants_text(groups_data, read_maps_data(groups_filepath, groups_data));
 
     string file_dir = get_directory_name(groups_filepath);
     char s = file_dir.back();
@@ -605,6 +648,36 @@ void process_layouts(string layouts_filepath) {
     write_text_file(file_dir + ".." + s + ".." + s + "include" + s + "constants" + s + "layouts.h", layouts_constants_text);
 }
 
+// Generates everything the "map", "groups" and "layouts" modes do, parsing
+// each JSON file only once, and only touches outputs whose content changed.
+void process_all(string groups_filepath, string layouts_filepath) {
+    Json groups_data = parse_json_file(groups_filepath);
+    Json layouts_data = parse_json_file(layouts_filepath);
+    map<string, Json> maps_data = read_maps_data(groups_filepath, groups_data);
+
+    string maps_dir = get_directory_name(groups_filepath);
+    string layouts_dir = get_directory_name(layouts_filepath);
+    char s = maps_dir.back();
+    string constants_dir = maps_dir + ".." + s + ".." + s + "include" + s + "constants" + s;
+
+    write_text_file_if_changed(layouts_dir + "layouts.inc", generate_layout_headers_text(layouts_data));
+    write_text_file_if_changed(layouts_dir + "layouts_table.inc", generate_layouts_table_text(layouts_data));
+    write_text_file_if_changed(constants_dir + "layouts.h", generate_layouts_constants_text(layouts_data));
+
+    write_text_file_if_changed(maps_dir + "groups.inc", generate_groups_text(groups_data));
+    write_text_file_if_changed(maps_dir + "connections.inc", generate_connections_text(groups_data));
+    write_text_file_if_changed(maps_dir + "headers.inc", generate_headers_text(groups_data));
+    write_text_file_if_changed(maps_dir + "events.inc", generate_events_text(groups_data));
+    write_text_file_if_changed(constants_dir + "map_groups.h", generate_map_constants_text(groups_data, maps_data));
+
+    for (auto &entry : maps_data) {
+        string map_dir = maps_dir + entry.first + s;
+        write_text_file_if_changed(map_dir + "header.inc", generate_map_header_text(entry.second, layouts_data));
+        write_text_file_if_changed(map_dir + "events.inc", generate_map_events_text(entry.second));
+        write_text_file_if_changed(map_dir + "connections.inc", generate_map_connections_text(entry.second));
+    }
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 3)
         FATAL_ERROR("USAGE: mapjson <mode> <game-version> [options]\n");
@@ -616,8 +689,8 @@ int main(int argc, char *argv[]) {
 
     char *mode_arg = argv[1];
     string mode(mode_arg);
-    if (mode != "layouts" && mode != "map" && mode != "groups")
-        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', or 'groups'.\n");
+    if (mode != "layouts" && mode != "map" && mode != "groups" && mode != "all")
+        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', 'groups', or 'all'.\n");
 
     if (mode == "map") {
         if (argc != 5)
@@ -644,6 +717,15 @@ int main(int argc, char *argv[]) {
 
         process_layouts(filepath);
     }
+    else if (mode == "all") {
+        if (argc != 5)
+            FATAL_ERROR("USAGE: mapjson all <game-version> <groups_file> <layouts_file>\n");
+
+        string groups_filepath(argv[3]);
+        string layouts_filepath(argv[4]);
+
+        process_all(groups_filepath, layouts_filepath);
+    }
 
     return 0;
 }
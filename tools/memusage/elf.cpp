@@ -0,0 +1,138 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "memusage.h"
+#include "elf.h"
+
+#define SHT_SYMTAB 2
+#define SHN_LORESERVE 0xFF00
+#define STT_OBJECT 1
+#define STT_FUNC 2
+#define EM_ARM 40
+
+static std::string s_elfPath;
+static std::string s_data;
+
+static std::uint64_t ReadInt(std::uint64_t offset, int size)
+{
+    if (offset + size > s_data.size())
+        FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", s_elfPath.c_str());
+
+    std::uint64_t val = 0;
+
+    for (int i = size - 1; i >= 0; i--)
+        val = (val << 8) | (unsigned char)s_data[offset + i];
+
+    return val;
+}
+
+static std::string ReadString(std::uint64_t offset)
+{
+    if (offset >= s_data.size())
+        FATAL_ERROR("error: string offset out of range in \"%s\"\n", s_elfPath.c_str());
+
+    return std::string(s_data.c_str() + offset);
+}
+
+// Reads the functions and objects with a nonzero size from the symbol table.
+// The GBA build is 32-bit, but 64-bit files are accepted too so the tool can
+// be tried on host builds. On ARM, bit 0 of a function's address only marks
+// Thumb code, so it is cleared.
+std::vector<Symbol> ReadElfSymbols(std::string path)
+{
+    s_elfPath = path;
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", path.c_str());
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    s_data = contents.str();
+
+    if (s_data.size() < 0x40 || std::memcmp(s_data.data(), "\x7F" "ELF", 4) != 0)
+        FATAL_ERROR("error: ELF magic did not match in \"%s\"\n", path.c_str());
+
+    if (s_data[5] != 1)
+        FATAL_ERROR("error: \"%s\" not little-endian ELF\n", path.c_str());
+
+    bool is64Bit;
+
+    if (s_data[4] == 1)
+        is64Bit = false;
+    else if (s_data[4] == 2)
+        is64Bit = true;
+    else
+        FATAL_ERROR("error: \"%s\" has an unknown ELF class\n", path.c_str());
+
+    bool isArm = ReadInt(0x12, 2) == EM_ARM;
+    int wordSize = is64Bit ? 8 : 4;
+    std::uint64_t sectionHeaderOffset = ReadInt(is64Bit ? 0x28 : 0x20, wordSize);
+    int sectionHeaderEntrySize = ReadInt(is64Bit ? 0x3A : 0x2E, 2);
+    int sectionCount = ReadInt(is64Bit ? 0x3C : 0x30, 2);
+
+    // Section header fields after sh_name and sh_type, which are 4 bytes each.
+    int shOffsetField = 8 + 2 * wordSize;
+    int shSizeField = 8 + 3 * wordSize;
+    int shLinkField = 8 + 4 * wordSize;
+
+    std::vector<Symbol> symbols;
+
+    for (int i = 0; i < sectionCount; i++)
+    {
+        std::uint64_t header = sectionHeaderOffset + (std::uint64_t)sectionHeaderEntrySize * i;
+
+        if (ReadInt(header + 4, 4) != SHT_SYMTAB)
+            continue;
+
+        std::uint64_t symtabOffset = ReadInt(header + shOffsetField, wordSize);
+        std::uint64_t symtabSize = ReadInt(header + shSizeField, wordSize);
+        int strtabIndex = ReadInt(header + shLinkField, 4);
+        std::uint64_t strtabHeader = sectionHeaderOffset + (std::uint64_t)sectionHeaderEntrySize * strtabIndex;
+        std::uint64_t strtabOffset = ReadInt(strtabHeader + shOffsetField, wordSize);
+        int entrySize = is64Bit ? 24 : 16;
+
+        for (std::uint64_t entry = symtabOffset; entry + entrySize <= symtabOffset + symtabSize; entry += entrySize)
+        {
+            std::uint32_t nameOffset = ReadInt(entry, 4);
+            std::uint64_t value, size;
+            int info, sectionIndex;
+
+            if (is64Bit)
+            {
+                info = ReadInt(entry + 4, 1);
+                sectionIndex = ReadInt(entry + 6, 2);
+                value = ReadInt(entry + 8, 8);
+                size = ReadInt(entry + 16, 8);
+            }
+            else
+            {
+                value = ReadInt(entry + 4, 4);
+                size = ReadInt(entry + 8, 4);
+                info = ReadInt(entry + 12, 1);
+                sectionIndex = ReadInt(entry + 14, 2);
+            }
+
+            int type = info & 0xF;
+
+            if (size == 0 || sectionIndex == 0 || sectionIndex >= SHN_LORESERVE)
+                continue;
+
+            if (type != STT_OBJECT && type != STT_FUNC)
+                continue;
+
+            Symbol symbol;
+            symbol.name = ReadString(strtabOffset + nameOffset);
+            symbol.address = (isArm && type == STT_FUNC) ? value & ~(std::uint64_t)1 : value;
+            symbol.size = size;
+            symbols.push_back(symbol);
+        }
+    }
+
+    s_data.clear();
+
+    return symbols;
+}
@@ -0,0 +1,10 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <string>
+#include <vector>
+#include "memusage.h"
+
+std::vector<Symbol> ReadElfSymbols(std::string path);
+
+#endif // ELF_H
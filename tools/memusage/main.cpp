@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "memusage.h"
+#include "report.h"
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+        "Usage: memusage [-top N] [-json JSON_PATH] MAP_PATH\n"
+        "       memusage [-top N] -diff OLD_MAP_PATH NEW_MAP_PATH\n"
+        "\n"
+        "Reports how much of ROM, EWRAM and IWRAM each section, object file and\n"
+        "symbol of a build takes, from the linker map file. Symbols are read from\n"
+        "the ELF file of the same name next to the map file, if there is one.\n"
+        "\n"
+        "  -top N          list only the N largest objects and symbols (default 20,\n"
+        "                  0 for all)\n"
+        "  -json JSON_PATH also write the sizes as a tree for treemap viewers\n"
+        "  -diff           list what changed in size between two builds\n");
+    std::exit(1);
+}
+
+static std::string BaseName(std::string path)
+{
+    std::size_t slashIndex = path.find_last_of("/\\");
+
+    if (slashIndex != std::string::npos)
+        path = path.substr(slashIndex + 1);
+
+    std::size_t dotIndex = path.find_last_of('.');
+
+    if (dotIndex != std::string::npos && dotIndex > 0)
+        path = path.substr(0, dotIndex);
+
+    return path;
+}
+
+int main(int argc, char **argv)
+{
+    int top = 20;
+    bool diff = false;
+    std::string jsonPath;
+    std::string paths[2];
+    int numPaths = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-top") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("error: missing number after \"-top\"\n");
+
+            top = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "-json") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("error: missing path after \"-json\"\n");
+
+            jsonPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-diff") == 0)
+        {
+            diff = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            FATAL_ERROR("error: unrecognized argument \"%s\"\n", argv[i]);
+        }
+        else
+        {
+            if (numPaths == 2)
+                PrintUsage();
+
+            paths[numPaths++] = argv[i];
+        }
+    }
+
+    if (numPaths != (diff ? 2 : 1) || (diff && !jsonPath.empty()))
+        PrintUsage();
+
+    if (diff)
+    {
+        PrintDiff(LoadBuild(paths[0]), LoadBuild(paths[1]), top);
+        return 0;
+    }
+
+    Build build = LoadBuild(paths[0]);
+
+    PrintReport(build, top);
+
+    if (!jsonPath.empty())
+        WriteJsonReport(build, BaseName(paths[0]), jsonPath);
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "memusage.h"
+#include "map_file.h"
+
+static std::vector<std::string> SplitWords(const std::string& line)
+{
+    std::istringstream stream(line);
+    std::vector<std::string> words;
+    std::string word;
+
+    while (stream >> word)
+        words.push_back(word);
+
+    return words;
+}
+
+static bool IsHexNumber(const std::string& s)
+{
+    return s.length() > 2 && s[0] == '0' && s[1] == 'x';
+}
+
+static std::uint64_t ParseHexNumber(const std::string& s)
+{
+    return std::strtoull(s.c_str() + 2, nullptr, 16);
+}
+
+static void FinishOutputSection(std::vector<OutputSection>& sections)
+{
+    if (sections.empty())
+        return;
+
+    OutputSection& section = sections.back();
+
+    if (section.inputs.empty())
+    {
+        section.contentSize = section.size;
+        return;
+    }
+
+    std::uint64_t end = section.address;
+
+    for (const InputSection& input : section.inputs)
+    {
+        if (input.address + input.size > end)
+            end = input.address + input.size;
+    }
+
+    section.contentSize = end - section.address;
+}
+
+// Reads the output and input sections from the memory map part of a GNU ld
+// map file. Symbol and assignment lines are skipped; symbol sizes come from
+// the ELF file instead. Padding the linker inserts (*fill*) is left out of the
+// input sections, so it only shows up in the output section's size.
+std::vector<OutputSection> ReadMapFile(std::string path)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", path.c_str());
+
+    std::vector<std::string> lines;
+    std::string line;
+    bool inMemoryMap = false;
+
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (!inMemoryMap)
+        {
+            if (line.compare(0, 28, "Linker script and memory map") == 0)
+                inMemoryMap = true;
+            continue;
+        }
+
+        lines.push_back(line);
+    }
+
+    if (!inMemoryMap)
+        FATAL_ERROR("error: \"%s\" has no memory map\n", path.c_str());
+
+    std::vector<OutputSection> sections;
+
+    for (std::size_t i = 0; i < lines.size(); i++)
+    {
+        const std::string& text = lines[i];
+
+        if (text.empty())
+            continue;
+
+        int indent = text.find_first_not_of(' ');
+
+        // Section lines start at column 0 (output) or 1 (input). Symbol and
+        // script lines are indented further.
+        if (indent > 1)
+            continue;
+
+        std::vector<std::string> words = SplitWords(text);
+
+        // A long section name is printed on a line of its own, and its
+        // address and size on the next line.
+        if (words.size() == 1 && i + 1 < lines.size())
+        {
+            std::vector<std::string> nextWords = SplitWords(lines[i + 1]);
+
+            if (!nextWords.empty() && IsHexNumber(nextWords[0]) && lines[i + 1][0] == ' ')
+            {
+                words.insert(words.end(), nextWords.begin(), nextWords.end());
+                i++;
+            }
+        }
+
+        if (words.size() < 3 || !IsHexNumber(words[1]) || !IsHexNumber(words[2]))
+            continue;
+
+        std::uint64_t address = ParseHexNumber(words[1]);
+        std::uint64_t size = ParseHexNumber(words[2]);
+
+        if (indent == 0)
+        {
+            FinishOutputSection(sections);
+
+            OutputSection section;
+            section.name = words[0];
+            section.address = address;
+            section.size = size;
+            section.contentSize = 0;
+            sections.push_back(section);
+        }
+        else if (!sections.empty() && words[0] != "*fill*" && size != 0)
+        {
+            InputSection input;
+            input.name = words[0];
+            input.address = address;
+            input.size = size;
+
+            for (std::size_t j = 3; j < words.size(); j++)
+                input.object += (j > 3 ? " " : "") + words[j];
+
+            sections.back().inputs.push_back(input);
+        }
+    }
+
+    FinishOutputSection(sections);
+
+    return sections;
+}
@@ -0,0 +1,10 @@
+#ifndef MAP_FILE_H
+#define MAP_FILE_H
+
+#include <string>
+#include <vector>
+#include "memusage.h"
+
+std::vector<OutputSection> ReadMapFile(std::string path);
+
+#endif // MAP_FILE_H
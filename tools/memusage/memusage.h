@@ -0,0 +1,87 @@
+#ifndef MEMUSAGE_H
+#define MEMUSAGE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+
+#define FATAL_ERROR(format, ...)               \
+do                                             \
+{                                              \
+    std::fprintf(stderr, format, __VA_ARGS__); \
+    std::exit(1);                              \
+} while (0)
+
+#else
+
+#define FATAL_ERROR(format, ...)                 \
+do                                               \
+{                                                \
+    std::fprintf(stderr, format, ##__VA_ARGS__); \
+    std::exit(1);                                \
+} while (0)
+
+#endif // _MSC_VER
+
+// One section of one object file, as placed by the linker.
+struct InputSection
+{
+    std::string name;
+    std::string object;
+    std::uint64_t address;
+    std::uint64_t size;
+};
+
+// A section of the linked image. contentSize runs from its start to the end
+// of its last input section, so it includes gaps the linker script leaves
+// between input sections (like the heap in EWRAM) but not padding after them.
+struct OutputSection
+{
+    std::string name;
+    std::uint64_t address;
+    std::uint64_t size;
+    std::uint64_t contentSize;
+    std::vector<InputSection> inputs;
+};
+
+struct Symbol
+{
+    std::string name;
+    std::uint64_t address;
+    std::uint64_t size;
+};
+
+struct Region
+{
+    const char *name;
+    std::uint64_t start;
+    std::uint64_t size;
+};
+
+// The memory areas the game can fill, in report order.
+const Region kRegions[] =
+{
+    { "ROM", 0x08000000, 0x02000000 },
+    { "EWRAM", 0x02000000, 0x40000 },
+    { "IWRAM", 0x03000000, 0x8000 },
+};
+
+const int kNumRegions = sizeof(kRegions) / sizeof(kRegions[0]);
+
+// Returns the index in kRegions of the region that holds address, or -1.
+inline int GetRegionIndex(std::uint64_t address)
+{
+    for (int i = 0; i < kNumRegions; i++)
+    {
+        if (address >= kRegions[i].start && address < kRegions[i].start + kRegions[i].size)
+            return i;
+    }
+
+    return -1;
+}
+
+#endif // MEMUSAGE_H
@@ -0,0 +1,426 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "memusage.h"
+#include "map_file.h"
+#include "elf.h"
+#include "report.h"
+
+// Sizes keyed by section, object or symbol, along with the region they're in.
+struct SizeEntry
+{
+    int region;
+    std::uint64_t size;
+};
+
+typedef std::map<std::string, SizeEntry> SizeTable;
+
+static bool FileExists(const std::string& path)
+{
+    FILE *fp = std::fopen(path.c_str(), "rb");
+
+    if (fp == nullptr)
+        return false;
+
+    std::fclose(fp);
+    return true;
+}
+
+// Finds the input section that holds each symbol. Aliases (symbols with the
+// same address and size) are only kept once so bytes aren't counted twice.
+static void PlaceSymbols(Build& build, std::vector<Symbol>& symbols)
+{
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        if (a.address != b.address)
+            return a.address < b.address;
+        if (a.size != b.size)
+            return a.size > b.size;
+        return a.name < b.name;
+    });
+
+    for (std::size_t i = 0; i < symbols.size(); i++)
+    {
+        const Symbol& symbol = symbols[i];
+
+        if (i > 0 && symbol.address == symbols[i - 1].address && symbol.size == symbols[i - 1].size)
+            continue;
+
+        int region = GetRegionIndex(symbol.address);
+
+        if (region < 0)
+            continue;
+
+        PlacedSymbol placed;
+        placed.symbol = symbol;
+        placed.region = region;
+        placed.section = -1;
+
+        for (std::size_t j = 0; j < build.sections.size() && placed.section < 0; j++)
+        {
+            const OutputSection& section = build.sections[j];
+
+            if (symbol.address < section.address || symbol.address >= section.address + section.size)
+                continue;
+
+            placed.section = j;
+
+            for (const InputSection& input : section.inputs)
+            {
+                if (symbol.address >= input.address && symbol.address < input.address + input.size)
+                {
+                    placed.object = input.object;
+                    break;
+                }
+            }
+        }
+
+        build.symbols.push_back(placed);
+    }
+}
+
+// Reads the map file and, if there is one next to it, the ELF file with the
+// same name for symbol sizes.
+Build LoadBuild(std::string mapPath)
+{
+    Build build;
+
+    for (OutputSection& section : ReadMapFile(mapPath))
+    {
+        if (section.size != 0 && GetRegionIndex(section.address) >= 0)
+            build.sections.push_back(section);
+    }
+
+    std::string elfPath = mapPath;
+    std::size_t dotIndex = elfPath.find_last_of('.');
+
+    if (dotIndex != std::string::npos && elfPath.find_first_of("/\\", dotIndex) == std::string::npos)
+        elfPath = elfPath.substr(0, dotIndex);
+
+    elfPath += ".elf";
+
+    build.hasSymbols = FileExists(elfPath);
+
+    if (build.hasSymbols)
+    {
+        std::vector<Symbol> symbols = ReadElfSymbols(elfPath);
+        PlaceSymbols(build, symbols);
+    }
+
+    return build;
+}
+
+static std::uint64_t GetRegionUsage(const Build& build, int region)
+{
+    std::uint64_t used = 0;
+
+    for (const OutputSection& section : build.sections)
+    {
+        if (GetRegionIndex(section.address) == region)
+            used += section.contentSize;
+    }
+
+    return used;
+}
+
+static SizeTable GetSectionSizes(const Build& build)
+{
+    SizeTable table;
+
+    for (const OutputSection& section : build.sections)
+    {
+        SizeEntry& entry = table[section.name];
+        entry.region = GetRegionIndex(section.address);
+        entry.size += section.contentSize;
+    }
+
+    return table;
+}
+
+// Keyed by region and object, since one object usually has data in ROM and
+// in RAM.
+static SizeTable GetObjectSizes(const Build& build)
+{
+    SizeTable table;
+
+    for (const OutputSection& section : build.sections)
+    {
+        int region = GetRegionIndex(section.address);
+
+        for (const InputSection& input : section.inputs)
+        {
+            SizeEntry& entry = table[std::string(kRegions[region].name) + " " + input.object];
+            entry.region = region;
+            entry.size += input.size;
+        }
+    }
+
+    return table;
+}
+
+static std::string GetSymbolKey(const PlacedSymbol& placed)
+{
+    if (placed.object.empty())
+        return placed.symbol.name;
+
+    return placed.symbol.name + " (" + placed.object + ")";
+}
+
+static SizeTable GetSymbolSizes(const Build& build)
+{
+    SizeTable table;
+
+    for (const PlacedSymbol& placed : build.symbols)
+    {
+        SizeEntry& entry = table[GetSymbolKey(placed)];
+        entry.region = placed.region;
+        entry.size += placed.symbol.size;
+    }
+
+    return table;
+}
+
+// Returns the table's keys, largest entry first.
+static std::vector<std::string> SortBySize(const SizeTable& table)
+{
+    std::vector<std::string> keys;
+
+    for (const auto& pair : table)
+        keys.push_back(pair.first);
+
+    std::stable_sort(keys.begin(), keys.end(), [&](const std::string& a, const std::string& b) {
+        return table.at(a).size > table.at(b).size;
+    });
+
+    return keys;
+}
+
+static void PrintTopEntries(const char *title, const SizeTable& table, int top, bool stripRegion)
+{
+    std::vector<std::string> keys = SortBySize(table);
+    std::size_t count = (top > 0 && (std::size_t)top < keys.size()) ? top : keys.size();
+
+    std::printf("\n%s (largest %lu of %lu)\n", title, (unsigned long)count, (unsigned long)keys.size());
+    std::printf("%10s  %-6s  %s\n", "Size", "Region", "Name");
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const SizeEntry& entry = table.at(keys[i]);
+        std::string name = keys[i];
+
+        if (stripRegion)
+            name = name.substr(name.find(' ') + 1);
+
+        std::printf("%10lu  %-6s  %s\n", (unsigned long)entry.size, kRegions[entry.region].name, name.c_str());
+    }
+}
+
+void PrintReport(const Build& build, int top)
+{
+    std::printf("%-6s  %10s  %10s  %10s  %6s\n", "Region", "Used", "Limit", "Free", "Used%");
+
+    for (int i = 0; i < kNumRegions; i++)
+    {
+        std::uint64_t used = GetRegionUsage(build, i);
+
+        std::printf("%-6s  %10lu  %10lu  %10ld  %5.1f%%\n", kRegions[i].name, (unsigned long)used,
+            (unsigned long)kRegions[i].size, (long)kRegions[i].size - (long)used, 100.0 * used / kRegions[i].size);
+    }
+
+    std::printf("\n%-6s  %-10s  %10s  %10s  %s\n", "Region", "Address", "Size", "Used", "Section");
+
+    for (const OutputSection& section : build.sections)
+    {
+        std::printf("%-6s  0x%08lX  %10lu  %10lu  %s\n", kRegions[GetRegionIndex(section.address)].name,
+            (unsigned long)section.address, (unsigned long)section.size, (unsigned long)section.contentSize, section.name.c_str());
+    }
+
+    PrintTopEntries("Objects", GetObjectSizes(build), top, true);
+
+    if (build.hasSymbols)
+        PrintTopEntries("Symbols", GetSymbolSizes(build), top, false);
+}
+
+static void PrintTableDiff(const char *title, const SizeTable& oldTable, const SizeTable& newTable, int top, bool stripRegion)
+{
+    std::map<std::string, long> deltas;
+
+    for (const auto& pair : oldTable)
+        deltas[pair.first] -= pair.second.size;
+
+    for (const auto& pair : newTable)
+        deltas[pair.first] += pair.second.size;
+
+    std::vector<std::string> keys;
+
+    for (const auto& pair : deltas)
+    {
+        if (pair.second != 0)
+            keys.push_back(pair.first);
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [&](const std::string& a, const std::string& b) {
+        return std::labs(deltas[a]) > std::labs(deltas[b]);
+    });
+
+    std::size_t count = (top > 0 && (std::size_t)top < keys.size()) ? top : keys.size();
+
+    std::printf("\n%s (%lu changed", title, (unsigned long)keys.size());
+    if (count < keys.size())
+        std::printf(", largest %lu shown", (unsigned long)count);
+    std::printf(")\n");
+
+    if (keys.empty())
+        return;
+
+    std::printf("%10s  %10s  %10s  %-6s  %s\n", "Old", "New", "Change", "Region", "Name");
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const std::string& key = keys[i];
+        auto oldEntry = oldTable.find(key);
+        auto newEntry = newTable.find(key);
+        std::uint64_t oldSize = oldEntry != oldTable.end() ? oldEntry->second.size : 0;
+        std::uint64_t newSize = newEntry != newTable.end() ? newEntry->second.size : 0;
+        int region = newEntry != newTable.end() ? newEntry->second.region : oldEntry->second.region;
+        std::string name = key;
+
+        if (stripRegion)
+            name = name.substr(name.find(' ') + 1);
+
+        std::printf("%10lu  %10lu  %+10ld  %-6s  %s\n", (unsigned long)oldSize, (unsigned long)newSize,
+            deltas[key], kRegions[region].name, name.c_str());
+    }
+}
+
+void PrintDiff(const Build& oldBuild, const Build& newBuild, int top)
+{
+    std::printf("%-6s  %10s  %10s  %10s  %10s\n", "Region", "Old", "New", "Change", "Free");
+
+    for (int i = 0; i < kNumRegions; i++)
+    {
+        std::uint64_t oldUsed = GetRegionUsage(oldBuild, i);
+        std::uint64_t newUsed = GetRegionUsage(newBuild, i);
+
+        std::printf("%-6s  %10lu  %10lu  %+10ld  %10ld\n", kRegions[i].name, (unsigned long)oldUsed,
+            (unsigned long)newUsed, (long)newUsed - (long)oldUsed, (long)kRegions[i].size - (long)newUsed);
+    }
+
+    PrintTableDiff("Sections", GetSectionSizes(oldBuild), GetSectionSizes(newBuild), top, false);
+    PrintTableDiff("Objects", GetObjectSizes(oldBuild), GetObjectSizes(newBuild), top, true);
+
+    if (oldBuild.hasSymbols && newBuild.hasSymbols)
+        PrintTableDiff("Symbols", GetSymbolSizes(oldBuild), GetSymbolSizes(newBuild), top, false);
+}
+
+static std::string JsonString(const std::string& s)
+{
+    std::string escaped = "\"";
+
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+static void WriteJsonLeaf(FILE *fp, const std::string& name, std::uint64_t size, bool& first)
+{
+    std::fprintf(fp, "%s{\"name\":%s,\"size\":%lu}", first ? "" : ",", JsonString(name).c_str(), (unsigned long)size);
+    first = false;
+}
+
+// Writes the build as a tree of regions, sections, objects and symbols in the
+// {"name", "children"} / {"name", "size"} form treemap tools (e.g. d3's
+// hierarchy) expect. Only leaves have sizes, so every byte is counted once:
+// bytes of an object that no symbol covers go to an "(other)" leaf, and gaps
+// and padding in a section go to "(gaps)".
+void WriteJsonReport(const Build& build, std::string name, std::string path)
+{
+    FILE *fp = std::fopen(path.c_str(), "w");
+
+    if (fp == nullptr)
+        FATAL_ERROR("error: failed to open \"%s\" for writing\n", path.c_str());
+
+    std::map<std::pair<int, std::string>, std::vector<const Symbol *>> symbolsByObject;
+
+    for (const PlacedSymbol& placed : build.symbols)
+        symbolsByObject[std::make_pair(placed.section, placed.object)].push_back(&placed.symbol);
+
+    std::fprintf(fp, "{\"name\":%s,\"children\":[", JsonString(name).c_str());
+
+    for (int region = 0; region < kNumRegions; region++)
+    {
+        std::fprintf(fp, "%s\n{\"name\":\"%s\",\"limit\":%lu,\"children\":[", region ? "," : "",
+            kRegions[region].name, (unsigned long)kRegions[region].size);
+
+        bool firstSection = true;
+
+        for (std::size_t i = 0; i < build.sections.size(); i++)
+        {
+            const OutputSection& section = build.sections[i];
+
+            if (GetRegionIndex(section.address) != region)
+                continue;
+
+            std::fprintf(fp, "%s\n {\"name\":%s,\"children\":[", firstSection ? "" : ",", JsonString(section.name).c_str());
+            firstSection = false;
+
+            std::map<std::string, std::uint64_t> objectSizes;
+            std::vector<std::string> objects;
+            std::uint64_t inputTotal = 0;
+
+            for (const InputSection& input : section.inputs)
+            {
+                if (objectSizes.find(input.object) == objectSizes.end())
+                    objects.push_back(input.object);
+                objectSizes[input.object] += input.size;
+                inputTotal += input.size;
+            }
+
+            bool firstObject = true;
+
+            for (const std::string& object : objects)
+            {
+                std::uint64_t symbolTotal = 0;
+                bool firstSymbol = true;
+
+                std::fprintf(fp, "%s\n  {\"name\":%s,\"children\":[", firstObject ? "" : ",", JsonString(object).c_str());
+                firstObject = false;
+
+                for (const Symbol *symbol : symbolsByObject[std::make_pair((int)i, object)])
+                {
+                    WriteJsonLeaf(fp, symbol->name, symbol->size, firstSymbol);
+                    symbolTotal += symbol->size;
+                }
+
+                if (symbolTotal < objectSizes[object])
+                    WriteJsonLeaf(fp, "(other)", objectSizes[object] - symbolTotal, firstSymbol);
+
+                std::fprintf(fp, "]}");
+            }
+
+            if (inputTotal < section.contentSize)
+            {
+                bool first = true;
+
+                std::fprintf(fp, "%s\n  ", firstObject ? "" : ",");
+                WriteJsonLeaf(fp, "(gaps)", section.contentSize - inputTotal, first);
+            }
+
+            std::fprintf(fp, "]}");
+        }
+
+        std::fprintf(fp, "]}");
+    }
+
+    std::fprintf(fp, "]}\n");
+
+    if (std::fclose(fp) != 0)
+        FATAL_ERROR("error: failed to write \"%s\"\n", path.c_str());
+}
@@ -0,0 +1,31 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <string>
+#include <vector>
+#include "memusage.h"
+
+// A symbol together with the place the linker put it.
+struct PlacedSymbol
+{
+    Symbol symbol;
+    int region;
+    int section;
+    std::string object;
+};
+
+// Everything the reports need from one build. Only sections and symbols
+// inside one of kRegions are kept.
+struct Build
+{
+    std::vector<OutputSection> sections;
+    std::vector<PlacedSymbol> symbols;
+    bool hasSymbols;
+};
+
+Build LoadBuild(std::string mapPath);
+void PrintReport(const Build& build, int top);
+void WriteJsonReport(const Build& build, std::string name, std::string path);
+void PrintDiff(const Build& oldBuild, const Build& newBuild, int top);
+
+#endif // REPORT_H
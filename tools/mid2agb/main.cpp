@@ -25,27 +25,21 @@
 #include <cassert>
 #include <string>
 #include <set>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
 #include "main.h"
 #include "error.h"
 #include "midi.h"
 #include "agb.h"
 
-FILE* g_inputFile = nullptr;
-FILE* g_outputFile = nullptr;
-
-std::string g_asmLabel;
-int g_masterVolume = 127;
-int g_voiceGroup = 0;
-int g_priority = 0;
-int g_reverb = -1;
-int g_clocksPerBeat = 1;
-bool g_exactGateTime = false;
-bool g_compressionEnabled = true;
-
 [[noreturn]] static void PrintUsage()
 {
     std::printf(
         "Usage: MID2AGB name [options]\n"
+        "       MID2AGB --batch manifest [-j threads]\n"
         "\n"
         "    input_file  filename(.mid) of MIDI file\n"
         "   output_file  filename(.s) for AGB file (default:input_file)\n"
@@ -58,6 +52,8 @@ bool g_compressionEnabled = true;
         "            -X  48 clocks/beat (default:24 clocks/beat)\n"
         "            -E  exact gate-time\n"
         "            -N  no compression\n"
+        "\n"
+        "Each line of a batch manifest holds the arguments of one conversion.\n"
     );
     std::exit(1);
 }
@@ -127,11 +123,10 @@ static const char *GetArgument(int argc, char **argv, int& index)
     }
 }
 
-int main(int argc, char** argv)
+// Sets the options and file names of a new song from its arguments. args[0]
+// is not looked at, just like argv[0].
+static void ParseArguments(Song& song, int argc, char **argv, std::string& inputFilename, std::string& outputFilename)
 {
-    std::string inputFilename;
-    std::string outputFilename;
-
     for (int i = 1; i < argc; i++)
     {
         const char *option = argv[i];
@@ -143,43 +138,43 @@ int main(int argc, char** argv)
             switch (std::toupper(option[1]))
             {
             case 'E':
-                g_exactGateTime = true;
+                song.exactGateTime = true;
                 break;
             case 'G':
                 arg = GetArgument(argc, argv, i);
                 if (arg == nullptr)
                     PrintUsage();
-                g_voiceGroup = std::stoi(arg);
+                song.voiceGroup = std::stoi(arg);
                 break;
             case 'L':
                 arg = GetArgument(argc, argv, i);
                 if (arg == nullptr)
                     PrintUsage();
-                g_asmLabel = arg;
+                song.asmLabel = arg;
                 break;
             case 'N':
-                g_compressionEnabled = false;
+                song.compressionEnabled = false;
                 break;
             case 'P':
                 arg = GetArgument(argc, argv, i);
                 if (arg == nullptr)
                     PrintUsage();
-                g_priority = std::stoi(arg);
+                song.priority = std::stoi(arg);
                 break;
             case 'R':
                 arg = GetArgument(argc, argv, i);
                 if (arg == nullptr)
                     PrintUsage();
-                g_reverb = std::stoi(arg);
+                song.reverb = std::stoi(arg);
                 break;
             case 'V':
                 arg = GetArgument(argc, argv, i);
                 if (arg == nullptr)
                     PrintUsage();
-                g_masterVolume = std::stoi(arg);
+                song.masterVolume = std::stoi(arg);
                 break;
             case 'X':
-                g_clocksPerBeat = 2;
+                song.clocksPerBeat = 2;
                 break;
             default:
                 PrintUsage();
@@ -208,26 +203,124 @@ int main(int argc, char** argv)
     if (GetExtension(outputFilename) != "s")
         RaiseError("output filename extension is not \"s\"");
 
-    if (g_asmLabel.empty())
-        g_asmLabel = BaseName(outputFilename);
+    if (song.asmLabel.empty())
+        song.asmLabel = BaseName(outputFilename);
+}
 
-    g_inputFile = std::fopen(inputFilename.c_str(), "rb");
+// Converts one song with its options. writeFilename is where the output is
+// written, which batch mode renames to the real output afterwards.
+static void ConvertSong(Song& song, const std::string& inputFilename, const std::string& writeFilename)
+{
+    song.inputFile = std::fopen(inputFilename.c_str(), "rb");
 
-    if (g_inputFile == nullptr)
+    if (song.inputFile == nullptr)
         RaiseError("failed to open \"%s\" for reading", inputFilename.c_str());
 
-    g_outputFile = std::fopen(outputFilename.c_str(), "w");
+    song.outputFile = std::fopen(writeFilename.c_str(), "w");
+
+    if (song.outputFile == nullptr)
+        RaiseError("failed to open \"%s\" for writing", writeFilename.c_str());
 
-    if (g_outputFile == nullptr)
-        RaiseError("failed to open \"%s\" for writing", outputFilename.c_str());
+    ReadMidiFileHeader(song);
+    PrintAgbHeader(song);
+    ReadMidiTracks(song);
+    PrintAgbFooter(song);
+
+    std::fclose(song.inputFile);
+
+    if (std::fclose(song.outputFile) != 0)
+        RaiseError("failed to write \"%s\"", writeFilename.c_str());
+}
+
+// Converts every song of the manifest on a pool of threads. Each song is
+// written to a temporary file first, so an error can't leave a truncated
+// .s file behind that make would consider up to date.
+static void ConvertBatch(const char *manifestFilename, int numThreads)
+{
+    std::ifstream manifest(manifestFilename);
+
+    if (!manifest.is_open())
+        RaiseError("failed to open \"%s\" for reading", manifestFilename);
+
+    std::vector<std::vector<std::string>> jobs;
+    std::string line;
+
+    while (std::getline(manifest, line))
+    {
+        std::istringstream fields(line);
+        std::vector<std::string> args(1, "mid2agb");
+        std::string field;
+
+        while (fields >> field)
+            args.push_back(field);
+
+        if (args.size() > 1 && args[1][0] != '#')
+            jobs.push_back(args);
+    }
+
+    std::atomic<std::size_t> nextJob(0);
+
+    auto worker = [&]()
+    {
+        std::size_t i;
 
-    ReadMidiFileHeader();
-    PrintAgbHeader();
-    ReadMidiTracks();
-    PrintAgbFooter();
+        while ((i = nextJob++) < jobs.size())
+        {
+            std::vector<char *> argv;
+
+            for (std::string& arg : jobs[i])
+                argv.push_back(&arg[0]);
+
+            Song song;
+            std::string inputFilename;
+            std::string outputFilename;
+
+            ParseArguments(song, argv.size(), argv.data(), inputFilename, outputFilename);
+
+            std::string tempFilename = outputFilename + ".tmp";
+
+            ConvertSong(song, inputFilename, tempFilename);
+
+            if (std::rename(tempFilename.c_str(), outputFilename.c_str()) != 0)
+                RaiseError("failed to rename \"%s\" to \"%s\"", tempFilename.c_str(), outputFilename.c_str());
+        }
+    };
+
+    if (static_cast<std::size_t>(numThreads) > jobs.size())
+        numThreads = jobs.size();
+
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--batch") == 0)
+    {
+        int numThreads = std::thread::hardware_concurrency();
+
+        if (argc == 5 && std::strcmp(argv[3], "-j") == 0)
+            numThreads = std::atoi(argv[4]);
+        else if (argc != 3)
+            PrintUsage();
+
+        ConvertBatch(argv[2], numThreads < 1 ? 1 : numThreads);
+        return 0;
+    }
+
+    Song song;
+    std::string inputFilename;
+    std::string outputFilename;
 
-    std::fclose(g_inputFile);
-    std::fclose(g_outputFile);
+    ParseArguments(song, argc, argv, inputFilename, outputFilename);
+    ConvertSong(song, inputFilename, outputFilename);
 
     return 0;
 }
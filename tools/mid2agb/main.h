@@ -22,18 +22,57 @@
 #define MAIN_H
 
 #include <cstdio>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "midi.h"
 
-extern FILE* g_inputFile;
-extern FILE* g_outputFile;
+// Everything one conversion reads and writes. Each conversion owns one and
+// passes it down, so batch mode can convert several songs at once.
+struct Song
+{
+    FILE* inputFile = nullptr;
+    FILE* outputFile = nullptr;
 
-extern std::string g_asmLabel;
-extern int g_masterVolume;
-extern int g_voiceGroup;
-extern int g_priority;
-extern int g_reverb;
-extern int g_clocksPerBeat;
-extern bool g_exactGateTime;
-extern bool g_compressionEnabled;
+    // Options
+    std::string asmLabel;
+    int masterVolume = 127;
+    int voiceGroup = 0;
+    int priority = 0;
+    int reverb = -1;
+    int clocksPerBeat = 1;
+    bool exactGateTime = false;
+    bool compressionEnabled = true;
+
+    // MIDI reader (midi.cpp)
+    MidiFormat midiFormat = MidiFormat::SingleTrack;
+    std::int_fast32_t midiTrackCount = 0;
+    std::int16_t midiTimeDiv = 0;
+    int midiChan = 0;
+    std::int32_t initialWait = 0;
+    long trackDataStart = 0;
+    std::vector<Event> seqEvents;
+    std::vector<Event> trackEvents;
+    std::int32_t absoluteTime = 0;
+    int blockCount = 0;
+    int minNote = 0;
+    int maxNote = 0;
+    int runningStatus = 0;
+
+    // AGB writer (agb.cpp)
+    int agbTrack = 0;
+    std::string lastOpName;
+    int blockNum = 0;
+    bool keepLastOpName = false;
+    int lastNote = 0;
+    int lastVelocity = 0;
+    bool noteChanged = false;
+    bool velocityChanged = false;
+    bool inPattern = false;
+    int extendedCommand = 0;
+    int memaccOp = 0;
+    int memaccParam1 = 0;
+    int memaccParam2 = 0;
+};
 
 #endif // MAIN_H
@@ -38,47 +38,31 @@ enum class MidiEventCategory
     Invalid,
 };
 
-MidiFormat g_midiFormat;
-std::int_fast32_t g_midiTrackCount;
-std::int16_t g_midiTimeDiv;
-
-int g_midiChan;
-std::int32_t g_initialWait;
-
-static long s_trackDataStart;
-static std::vector<Event> s_seqEvents;
-static std::vector<Event> s_trackEvents;
-static std::int32_t s_absoluteTime;
-static int s_blockCount = 0;
-static int s_minNote;
-static int s_maxNote;
-static int s_runningStatus;
-
-void Seek(long offset)
+void Seek(Song& song, long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_SET) != 0)
+    if (std::fseek(song.inputFile, offset, SEEK_SET) != 0)
         RaiseError("failed to seek to %l", offset);
 }
 
-void Skip(long offset)
+void Skip(Song& song, long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_CUR) != 0)
+    if (std::fseek(song.inputFile, offset, SEEK_CUR) != 0)
         RaiseError("failed to skip %l bytes", offset);
 }
 
-std::string ReadSignature()
+std::string ReadSignature(Song& song)
 {
     char signature[4];
 
-    if (std::fread(signature, 4, 1, g_inputFile) != 1)
+    if (std::fread(signature, 4, 1, song.inputFile) != 1)
         RaiseError("failed to read signature");
 
     return std::string(signature, 4);
 }
 
-std::uint32_t ReadInt8()
+std::uint32_t ReadInt8(Song& song)
 {
-    int c = std::fgetc(g_inputFile);
+    int c = std::fgetc(song.inputFile);
 
     if (c < 0)
         RaiseError("unexpected EOF");
@@ -86,41 +70,41 @@ std::uint32_t ReadInt8()
     return c;
 }
 
-std::uint32_t ReadInt16()
+std::uint32_t ReadInt16(Song& song)
 {
     std::uint32_t val = 0;
-    val |= ReadInt8() << 8;
-    val |= ReadInt8();
+    val |= ReadInt8(song) << 8;
+    val |= ReadInt8(song);
     return val;
 }
 
-std::uint32_t ReadInt24()
+std::uint32_t ReadInt24(Song& song)
 {
     std::uint32_t val = 0;
-    val |= ReadInt8() << 16;
-    val |= ReadInt8() << 8;
-    val |= ReadInt8();
+    val |= ReadInt8(song) << 16;
+    val |= ReadInt8(song) << 8;
+    val |= ReadInt8(song);
     return val;
 }
 
-std::uint32_t ReadInt32()
+std::uint32_t ReadInt32(Song& song)
 {
     std::uint32_t val = 0;
-    val |= ReadInt8() << 24;
-    val |= ReadInt8() << 16;
-    val |= ReadInt8() << 8;
-    val |= ReadInt8();
+    val |= ReadInt8(song) << 24;
+    val |= ReadInt8(song) << 16;
+    val |= ReadInt8(song) << 8;
+    val |= ReadInt8(song);
     return val;
 }
 
-std::uint32_t ReadVLQ()
+std::uint32_t ReadVLQ(Song& song)
 {
     std::uint32_t val = 0;
     std::uint32_t c;
 
     do
     {
-        c = ReadInt8();
+        c = ReadInt8(song);
         val <<= 7;
         val |= (c & 0x7F);
     } while (c & 0x80);
@@ -128,79 +112,79 @@ std::uint32_t ReadVLQ()
     return val;
 }
 
-void ReadMidiFileHeader()
+void ReadMidiFileHeader(Song& song)
 {
-    Seek(0);
+    Seek(song, 0);
 
-    if (ReadSignature() != "MThd")
+    if (ReadSignature(song) != "MThd")
         RaiseError("MIDI file header signature didn't match \"MThd\"");
 
-    std::uint32_t headerLength = ReadInt32();
+    std::uint32_t headerLength = ReadInt32(song);
 
     if (headerLength != 6)
         RaiseError("MIDI file header length isn't 6");
 
-    std::uint16_t midiFormat = ReadInt16();
+    std::uint16_t midiFormat = ReadInt16(song);
 
     if (midiFormat >= 2)
         RaiseError("unsupported MIDI format (%u)", midiFormat);
 
-    g_midiFormat = (MidiFormat)midiFormat;
-    g_midiTrackCount = ReadInt16();
-    g_midiTimeDiv = ReadInt16();
+    song.midiFormat = (MidiFormat)midiFormat;
+    song.midiTrackCount = ReadInt16(song);
+    song.midiTimeDiv = ReadInt16(song);
 
-    if (g_midiTimeDiv < 0)
-        RaiseError("unsupported MIDI time division (%d)", g_midiTimeDiv);
+    if (song.midiTimeDiv < 0)
+        RaiseError("unsupported MIDI time division (%d)", song.midiTimeDiv);
 }
 
-long ReadMidiTrackHeader(long offset)
+long ReadMidiTrackHeader(Song& song, long offset)
 {
-    Seek(offset);
+    Seek(song, offset);
 
-    if (ReadSignature() != "MTrk")
+    if (ReadSignature(song) != "MTrk")
         RaiseError("MIDI track header signature didn't match \"MTrk\"");
 
-    long size = ReadInt32();
+    long size = ReadInt32(song);
 
-    s_trackDataStart = std::ftell(g_inputFile);
+    song.trackDataStart = std::ftell(song.inputFile);
 
     return size + 8;
 }
 
-void StartTrack()
+void StartTrack(Song& song)
 {
-    Seek(s_trackDataStart);
-    s_absoluteTime = 0;
-    s_runningStatus = 0;
+    Seek(song, song.trackDataStart);
+    song.absoluteTime = 0;
+    song.runningStatus = 0;
 }
 
-void SkipEventData()
+void SkipEventData(Song& song)
 {
-    Skip(ReadVLQ());
+    Skip(song, ReadVLQ(song));
 }
 
-void DetermineEventCategory(MidiEventCategory& category, int& typeChan, int& size)
+void DetermineEventCategory(Song& song, MidiEventCategory& category, int& typeChan, int& size)
 {
-    typeChan = ReadInt8();
+    typeChan = ReadInt8(song);
 
     if (typeChan < 0x80)
     {
         // If data byte was found, use the running status.
-        ungetc(typeChan, g_inputFile);
-        typeChan = s_runningStatus;
+        ungetc(typeChan, song.inputFile);
+        typeChan = song.runningStatus;
     }
 
     if (typeChan == 0xFF)
     {
         category = MidiEventCategory::Meta;
         size = 0;
-        s_runningStatus = 0;
+        song.runningStatus = 0;
     }
     else if (typeChan >= 0xF0)
     {
         category = MidiEventCategory::SysEx;
         size = 0;
-        s_runningStatus = 0;
+        song.runningStatus = 0;
     }
     else if (typeChan >= 0x80)
     {
@@ -216,7 +200,7 @@ void DetermineEventCategory(MidiEventCategory& category, int& typeChan, int& siz
             size = 2;
             break;
         }
-        s_runningStatus = typeChan;
+        song.runningStatus = typeChan;
     }
     else
     {
@@ -224,52 +208,52 @@ void DetermineEventCategory(MidiEventCategory& category, int& typeChan, int& siz
     }
 }
 
-void MakeBlockEvent(Event& event, EventType type)
+void MakeBlockEvent(Song& song, Event& event, EventType type)
 {
     event.type = type;
-    event.param1 = s_blockCount++;
+    event.param1 = song.blockCount++;
     event.param2 = 0;
 }
 
-std::string ReadEventText()
+std::string ReadEventText(Song& song)
 {
     char buffer[2];
-    std::uint32_t length = ReadVLQ();
+    std::uint32_t length = ReadVLQ(song);
 
     if (length <= 2)
     {
-        if (fread(buffer, length, 1, g_inputFile) != 1)
+        if (fread(buffer, length, 1, song.inputFile) != 1)
             RaiseError("failed to read event text");
     }
     else
     {
-        Skip(length);
+        Skip(song, length);
         length = 0;
     }
 
     return std::string(buffer, length);
 }
 
-bool ReadSeqEvent(Event& event)
+bool ReadSeqEvent(Song& song, Event& event)
 {
-    s_absoluteTime += ReadVLQ();
-    event.time = s_absoluteTime;
+    song.absoluteTime += ReadVLQ(song);
+    event.time = song.absoluteTime;
 
     MidiEventCategory category;
     int typeChan;
     int size;
 
-    DetermineEventCategory(category, typeChan, size);
+    DetermineEventCategory(song, category, typeChan, size);
 
     if (category == MidiEventCategory::Control)
     {
-        Skip(size);
+        Skip(song, size);
         return false;
     }
 
     if (category == MidiEventCategory::SysEx)
     {
-        SkipEventData();
+        SkipEventData(song);
         return false;
     }
 
@@ -277,21 +261,21 @@ bool ReadSeqEvent(Event& event)
         RaiseError("invalid event");
 
     // meta event
-    int metaEventType = ReadInt8();
+    int metaEventType = ReadInt8(song);
 
     if (metaEventType >= 1 && metaEventType <= 7)
     {
         // text event
-        std::string text = ReadEventText();
+        std::string text = ReadEventText(song);
 
         if (text == "[")
-            MakeBlockEvent(event, EventType::LoopBegin);
+            MakeBlockEvent(song, event, EventType::LoopBegin);
         else if (text == "][")
-            MakeBlockEvent(event, EventType::LoopEndBegin);
+            MakeBlockEvent(song, event, EventType::LoopEndBegin);
         else if (text == "]")
-            MakeBlockEvent(event, EventType::LoopEnd);
+            MakeBlockEvent(song, event, EventType::LoopEnd);
         else if (text == ":")
-            MakeBlockEvent(event, EventType::Label);
+            MakeBlockEvent(song, event, EventType::Label);
         else
             return false;
     }
@@ -300,33 +284,33 @@ bool ReadSeqEvent(Event& event)
         switch (metaEventType)
         {
         case 0x2F: // end of track
-            SkipEventData();
+            SkipEventData(song);
             event.type = EventType::EndOfTrack;
             event.param1 = 0;
             event.param2 = 0;
             break;
         case 0x51: // tempo
-            if (ReadVLQ() != 3)
+            if (ReadVLQ(song) != 3)
                 RaiseError("invalid tempo size");
 
             event.type = EventType::Tempo;
             event.param1 = 0;
-            event.param2 = ReadInt24();
+            event.param2 = ReadInt24(song);
             break;
         case 0x58: // time signature
         {
-            if (ReadVLQ() != 4)
+            if (ReadVLQ(song) != 4)
                 RaiseError("invalid time signature size");
 
-            int numerator = ReadInt8();
-            int denominatorExponent = ReadInt8();
+            int numerator = ReadInt8(song);
+            int denominatorExponent = ReadInt8(song);
 
             if (denominatorExponent >= 16)
                 RaiseError("invalid time signature denominator");
 
-            Skip(2); // ignore other values
+            Skip(song, 2); // ignore other values
 
-            int clockTicks = 96 * numerator * g_clocksPerBeat;
+            int clockTicks = 96 * numerator * song.clocksPerBeat;
             int denominator = 1 << denominatorExponent;
             int timeSig = clockTicks / denominator;
 
@@ -339,7 +323,7 @@ bool ReadSeqEvent(Event& event)
             break;
         }
         default:
-            SkipEventData();
+            SkipEventData(song);
             return false;
         }
     }
@@ -347,17 +331,17 @@ bool ReadSeqEvent(Event& event)
     return true;
 }
 
-void ReadSeqEvents()
+void ReadSeqEvents(Song& song)
 {
-    StartTrack();
+    StartTrack(song);
 
     for (;;)
     {
         Event event = {};
 
-        if (ReadSeqEvent(event))
+        if (ReadSeqEvent(song, event))
         {
-            s_seqEvents.push_back(event);
+            song.seqEvents.push_back(event);
 
             if (event.type == EventType::EndOfTrack)
                 return;
@@ -365,23 +349,23 @@ void ReadSeqEvents()
     }
 }
 
-bool CheckNoteEnd(Event& event)
+bool CheckNoteEnd(Song& song, Event& event)
 {
-    event.param2 += ReadVLQ();
+    event.param2 += ReadVLQ(song);
 
     MidiEventCategory category;
     int typeChan;
     int size;
 
-    DetermineEventCategory(category, typeChan, size);
+    DetermineEventCategory(song, category, typeChan, size);
 
     if (category == MidiEventCategory::Control)
     {
         int chan = typeChan & 0xF;
 
-        if (chan != g_midiChan)
+        if (chan != song.midiChan)
         {
-            Skip(size);
+            Skip(song, size);
             return false;
         }
 
@@ -389,22 +373,22 @@ bool CheckNoteEnd(Event& event)
         {
         case 0x80: // note off
         {
-            int note = ReadInt8();
-            ReadInt8(); // ignore velocity
+            int note = ReadInt8(song);
+            ReadInt8(song); // ignore velocity
             if (note == event.note)
                 return true;
             break;
         }
         case 0x90: // note on
         {
-            int note = ReadInt8();
-            int velocity = ReadInt8();
+            int note = ReadInt8(song);
+            int velocity = ReadInt8(song);
             if (velocity == 0 && note == event.note)
                 return true;
             break;
         }
         default:
-            Skip(size);
+            Skip(song, size);
             break;
         }
 
@@ -413,14 +397,14 @@ bool CheckNoteEnd(Event& event)
 
     if (category == MidiEventCategory::SysEx)
     {
-        SkipEventData();
+        SkipEventData(song);
         return false;
     }
 
     if (category == MidiEventCategory::Meta)
     {
-        int metaEventType = ReadInt8();
-        SkipEventData();
+        int metaEventType = ReadInt8(song);
+        SkipEventData(song);
 
         if (metaEventType == 0x2F)
             RaiseError("note doesn't end");
@@ -431,40 +415,40 @@ bool CheckNoteEnd(Event& event)
     RaiseError("invalid event");
 }
 
-void FindNoteEnd(Event& event)
+void FindNoteEnd(Song& song, Event& event)
 {
     // Save the current file position and running status
     // which get modified by CheckNoteEnd.
-    long startPos = ftell(g_inputFile);
-    int savedRunningStatus = s_runningStatus;
+    long startPos = ftell(song.inputFile);
+    int savedRunningStatus = song.runningStatus;
 
     event.param2 = 0;
 
-    while (!CheckNoteEnd(event))
+    while (!CheckNoteEnd(song, event))
         ;
 
-    Seek(startPos);
-    s_runningStatus = savedRunningStatus;
+    Seek(song, startPos);
+    song.runningStatus = savedRunningStatus;
 }
 
-bool ReadTrackEvent(Event& event)
+bool ReadTrackEvent(Song& song, Event& event)
 {
-    s_absoluteTime += ReadVLQ();
-    event.time = s_absoluteTime;
+    song.absoluteTime += ReadVLQ(song);
+    event.time = song.absoluteTime;
 
     MidiEventCategory category;
     int typeChan;
     int size;
 
-    DetermineEventCategory(category, typeChan, size);
+    DetermineEventCategory(song, category, typeChan, size);
 
     if (category == MidiEventCategory::Control)
     {
         int chan = typeChan & 0xF;
 
-        if (chan != g_midiChan)
+        if (chan != song.midiChan)
         {
-            Skip(size);
+            Skip(song, size);
             return false;
         }
 
@@ -472,42 +456,42 @@ bool ReadTrackEvent(Event& event)
         {
         case 0x90: // note on
         {
-            int note = ReadInt8();
-            int velocity = ReadInt8();
+            int note = ReadInt8(song);
+            int velocity = ReadInt8(song);
 
             if (velocity != 0)
             {
                 event.type = EventType::Note;
                 event.note = note;
                 event.param1 = velocity;
-                FindNoteEnd(event);
+                FindNoteEnd(song, event);
                 if (event.param2 > 0)
                 {
-                    if (note < s_minNote)
-                        s_minNote = note;
-                    if (note > s_maxNote)
-                        s_maxNote = note;
+                    if (note < song.minNote)
+                        song.minNote = note;
+                    if (note > song.maxNote)
+                        song.maxNote = note;
                 }
             }
             break;
         }
         case 0xB0: // controller event
             event.type = EventType::Controller;
-            event.param1 = ReadInt8(); // controller index
-            event.param2 = ReadInt8(); // value
+            event.param1 = ReadInt8(song); // controller index
+            event.param2 = ReadInt8(song); // value
             break;
         case 0xC0: // instrument change
             event.type = EventType::InstrumentChange;
-            event.param1 = ReadInt8(); // instrument
+            event.param1 = ReadInt8(song); // instrument
             event.param2 = 0;
             break;
         case 0xE0: // pitch bend
             event.type = EventType::PitchBend;
-            event.param1 = ReadInt8();
-            event.param2 = ReadInt8();
+            event.param1 = ReadInt8(song);
+            event.param2 = ReadInt8(song);
             break;
         default:
-            Skip(size);
+            Skip(song, size);
             return false;
         }
 
@@ -516,14 +500,14 @@ bool ReadTrackEvent(Event& event)
 
     if (category == MidiEventCategory::SysEx)
     {
-        SkipEventData();
+        SkipEventData(song);
         return false;
     }
 
     if (category == MidiEventCategory::Meta)
     {
-        int metaEventType = ReadInt8();
-        SkipEventData();
+        int metaEventType = ReadInt8(song);
+        SkipEventData(song);
 
         if (metaEventType == 0x2F)
         {
@@ -539,22 +523,22 @@ bool ReadTrackEvent(Event& event)
     RaiseError("invalid event");
 }
 
-void ReadTrackEvents()
+void ReadTrackEvents(Song& song)
 {
-    StartTrack();
+    StartTrack(song);
 
-    s_trackEvents.clear();
+    song.trackEvents.clear();
 
-    s_minNote = 0xFF;
-    s_maxNote = 0;
+    song.minNote = 0xFF;
+    song.maxNote = 0;
 
     for (;;)
     {
         Event event = {};
 
-        if (ReadTrackEvent(event))
+        if (ReadTrackEvent(song, event))
         {
-            s_trackEvents.push_back(event);
+            song.trackEvents.push_back(event);
 
             if (event.type == EventType::EndOfTrack)
                 return;
@@ -597,53 +581,53 @@ bool EventCompare(const Event& event1, const Event& event2)
     return false;
 }
 
-std::unique_ptr<std::vector<Event>> MergeEvents()
+std::unique_ptr<std::vector<Event>> MergeEvents(Song& song)
 {
     std::unique_ptr<std::vector<Event>> events(new std::vector<Event>());
 
     unsigned trackEventPos = 0;
     unsigned seqEventPos = 0;
 
-    while (s_trackEvents[trackEventPos].type != EventType::EndOfTrack
-        && s_seqEvents[seqEventPos].type != EventType::EndOfTrack)
+    while (song.trackEvents[trackEventPos].type != EventType::EndOfTrack
+        && song.seqEvents[seqEventPos].type != EventType::EndOfTrack)
     {
-        if (EventCompare(s_trackEvents[trackEventPos], s_seqEvents[seqEventPos]))
-            events->push_back(s_trackEvents[trackEventPos++]);
+        if (EventCompare(song.trackEvents[trackEventPos], song.seqEvents[seqEventPos]))
+            events->push_back(song.trackEvents[trackEventPos++]);
         else
-            events->push_back(s_seqEvents[seqEventPos++]);
+            events->push_back(song.seqEvents[seqEventPos++]);
     }
 
-    while (s_trackEvents[trackEventPos].type != EventType::EndOfTrack)
-        events->push_back(s_trackEvents[trackEventPos++]);
+    while (song.trackEvents[trackEventPos].type != EventType::EndOfTrack)
+        events->push_back(song.trackEvents[trackEventPos++]);
 
-    while (s_seqEvents[seqEventPos].type != EventType::EndOfTrack)
-        events->push_back(s_seqEvents[seqEventPos++]);
+    while (song.seqEvents[seqEventPos].type != EventType::EndOfTrack)
+        events->push_back(song.seqEvents[seqEventPos++]);
 
     // Push the EndOfTrack event with the larger time.
-    if (EventCompare(s_trackEvents[trackEventPos], s_seqEvents[seqEventPos]))
-        events->push_back(s_seqEvents[seqEventPos]);
+    if (EventCompare(song.trackEvents[trackEventPos], song.seqEvents[seqEventPos]))
+        events->push_back(song.seqEvents[seqEventPos]);
     else
-        events->push_back(s_trackEvents[trackEventPos]);
+        events->push_back(song.trackEvents[trackEventPos]);
 
     return events;
 }
 
-void ConvertTimes(std::vector<Event>& events)
+void ConvertTimes(Song& song, std::vector<Event>& events)
 {
     for (Event& event : events)
     {
-        event.time = (24 * g_clocksPerBeat * event.time) / g_midiTimeDiv;
+        event.time = (24 * song.clocksPerBeat * event.time) / song.midiTimeDiv;
 
         if (event.type == EventType::Note)
         {
             event.param1 = g_noteVelocityLUT[event.param1];
 
-            std::uint32_t duration = (24 * g_clocksPerBeat * event.param2) / g_midiTimeDiv;
+            std::uint32_t duration = (24 * song.clocksPerBeat * event.param2) / song.midiTimeDiv;
 
             if (duration == 0)
                 duration = 1;
 
-            if (!g_exactGateTime && duration < 96)
+            if (!song.exactGateTime && duration < 96)
                 duration = g_noteDurationLUT[duration];
 
             event.param2 = duration;
@@ -651,14 +635,14 @@ void ConvertTimes(std::vector<Event>& events)
     }
 }
 
-std::unique_ptr<std::vector<Event>> InsertTimingEvents(std::vector<Event>& inEvents)
+std::unique_ptr<std::vector<Event>> InsertTimingEvents(Song& song, std::vector<Event>& inEvents)
 {
     std::unique_ptr<std::vector<Event>> outEvents(new std::vector<Event>());
 
     Event timingEvent = {};
     timingEvent.time = 0;
     timingEvent.type = EventType::TimeSignature;
-    timingEvent.param2 = 96 * g_clocksPerBeat;
+    timingEvent.param2 = 96 * song.clocksPerBeat;
 
     for (const Event& event : inEvents)
     {
@@ -670,7 +654,7 @@ std::unique_ptr<std::vector<Event>> InsertTimingEvents(std::vector<Event>& inEve
 
         if (event.type == EventType::TimeSignature)
         {
-            if (g_agbTrack == 1 && event.param2 != timingEvent.param2)
+            if (song.agbTrack == 1 && event.param2 != timingEvent.param2)
             {
                 Event originalTimingEvent = event;
                 originalTimingEvent.type = EventType::OriginalTimeSignature;
@@ -756,9 +740,9 @@ std::unique_ptr<std::vector<Event>> CreateTies(std::vector<Event>& inEvents)
     return outEvents;
 }
 
-void CalculateWaits(std::vector<Event>& events)
+void CalculateWaits(Song& song, std::vector<Event>& events)
 {
-    g_initialWait = events[0].time;
+    song.initialWait = events[0].time;
     int wholeNoteCount = 0;
 
     for (unsigned i = 0; i < events.size() && events[i].type != EventType::EndOfTrack; i++)
@@ -913,51 +897,51 @@ void Compress(std::vector<Event>& events)
     }
 }
 
-void ReadMidiTracks()
+void ReadMidiTracks(Song& song)
 {
     long trackHeaderStart = 14;
 
-    ReadMidiTrackHeader(trackHeaderStart);
-    ReadSeqEvents();
+    ReadMidiTrackHeader(song, trackHeaderStart);
+    ReadSeqEvents(song);
 
-    g_agbTrack = 1;
+    song.agbTrack = 1;
 
-    for (int midiTrack = 0; midiTrack < g_midiTrackCount; midiTrack++)
+    for (int midiTrack = 0; midiTrack < song.midiTrackCount; midiTrack++)
     {
-        trackHeaderStart += ReadMidiTrackHeader(trackHeaderStart);
+        trackHeaderStart += ReadMidiTrackHeader(song, trackHeaderStart);
 
-        for (g_midiChan = 0; g_midiChan < 16; g_midiChan++)
+        for (song.midiChan = 0; song.midiChan < 16; song.midiChan++)
         {
-            ReadTrackEvents();
+            ReadTrackEvents(song);
 
-            if (s_minNote != 0xFF)
+            if (song.minNote != 0xFF)
             {
 #ifdef DEBUG
-                printf("Track%d = Midi-Ch.%d\n", g_agbTrack, g_midiChan + 1);
+                printf("Track%d = Midi-Ch.%d\n", song.agbTrack, song.midiChan + 1);
 #endif
 
-                std::unique_ptr<std::vector<Event>> events(MergeEvents());
+                std::unique_ptr<std::vector<Event>> events(MergeEvents(song));
 
                 // We don't need TEMPO in anything but track 1.
-                if (g_agbTrack == 1)
+                if (song.agbTrack == 1)
                 {
-                    auto it = std::remove_if(s_seqEvents.begin(), s_seqEvents.end(), [](const Event& event) { return event.type == EventType::Tempo; });
-                    s_seqEvents.erase(it, s_seqEvents.end());
+                    auto it = std::remove_if(song.seqEvents.begin(), song.seqEvents.end(), [](const Event& event) { return event.type == EventType::Tempo; });
+                    song.seqEvents.erase(it, song.seqEvents.end());
                 }
 
-                ConvertTimes(*events);
-                events = InsertTimingEvents(*events);
+                ConvertTimes(song, *events);
+                events = InsertTimingEvents(song, *events);
                 events = CreateTies(*events);
                 std::stable_sort(events->begin(), events->end(), EventCompare);
                 events = SplitTime(*events);
-                CalculateWaits(*events);
+                CalculateWaits(song, *events);
 
-                if (g_compressionEnabled)
+                if (song.compressionEnabled)
                     Compress(*events);
 
-                PrintAgbTrack(*events);
+                PrintAgbTrack(song, *events);
 
-                g_agbTrack++;
+                song.agbTrack++;
             }
         }
     }
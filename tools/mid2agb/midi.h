@@ -73,11 +73,10 @@ struct Event
     }
 };
 
-void ReadMidiFileHeader();
-void ReadMidiTracks();
+struct Song;
 
-extern int g_midiChan;
-extern std::int32_t g_initialWait;
+void ReadMidiFileHeader(Song& song);
+void ReadMidiTracks(Song& song);
 
 inline bool IsPatternBoundary(EventType type)
 {
@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstdarg>
 #include <stdexcept>
+#include <map>
 #include "preproc.h"
 #include "asm_file.h"
 #include "char_util.h"
@@ -301,7 +302,7 @@ void AsmFile::VerifyStringLength(int length)
 
 int AsmFile::ReadBraille(unsigned char* s)
 {
-    static std::map<char, unsigned char> encoding =
+    static const std::map<char, unsigned char> encoding =
     {
         { 'A', BRAILLE_CHAR_A },
         { 'B', BRAILLE_CHAR_B },
@@ -418,7 +419,7 @@ int AsmFile::ReadBraille(unsigned char* s)
                 VerifyStringLength(length);
                 s[length++] = BRAILLE_CHAR_NUMBER;
             }
-            else if (inNumber && encoding[c] == BRAILLE_CHAR_SPACE)
+            else if (inNumber && encoding.at(c) == BRAILLE_CHAR_SPACE)
             {
                 // Number ends at a space.
                 // Non-number characters encountered before a space will simply be output as is.
@@ -426,7 +427,7 @@ int AsmFile::ReadBraille(unsigned char* s)
             }
 
             VerifyStringLength(length);
-            s[length++] = encoding[c];
+            s[length++] = encoding.at(c);
             m_pos++;
         }
     }
@@ -509,7 +510,8 @@ void AsmFile::OutputLine()
         if (m_pos >= m_size)
         {
             RaiseWarning("file doesn't end with newline");
-            puts(&m_buffer[m_lineStart]);
+            std::fputs(&m_buffer[m_lineStart], g_outputFile);
+            std::fputc('\n', g_outputFile);
         }
         else
         {
@@ -519,7 +521,8 @@ void AsmFile::OutputLine()
     else
     {
         m_buffer[m_pos] = 0;
-        puts(&m_buffer[m_lineStart]);
+        std::fputs(&m_buffer[m_lineStart], g_outputFile);
+        std::fputc('\n', g_outputFile);
         m_buffer[m_pos] = '\n';
         m_pos++;
         m_lineStart = m_pos;
@@ -566,7 +569,7 @@ bool AsmFile::IsAtEnd()
 // Output the current location to set gas's logical file and line numbers.
 void AsmFile::OutputLocation()
 {
-    std::printf("# %ld \"%s\"\n", m_lineNum, m_filename.c_str());
+    std::fprintf(g_outputFile, "# %ld \"%s\"\n", m_lineNum, m_filename.c_str());
 }
 
 // Reports a diagnostic message.
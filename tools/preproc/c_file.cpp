@@ -25,6 +25,7 @@
 #include <memory>
 #include <cstring>
 #include <cerrno>
+#include <algorithm>
 #include "preproc.h"
 #include "c_file.h"
 #include "char_util.h"
@@ -84,6 +85,7 @@ CFile::CFile(const char * filenameCStr, bool isStdin)
     m_pos = 0;
     m_lineNum = 1;
     m_isStdin = isStdin;
+    m_braceDepth = 0;
 }
 
 CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename))
@@ -93,6 +95,8 @@ CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename))
     m_size = other.m_size;
     m_lineNum = other.m_lineNum;
     m_isStdin = other.m_isStdin;
+    m_braceDepth = other.m_braceDepth;
+    m_output = std::move(other.m_output);
 
     other.m_buffer = NULL;
 }
@@ -112,21 +116,21 @@ void CFile::Preproc()
         {
             if (m_buffer[m_pos] == stringChar)
             {
-                std::putchar(stringChar);
+                Output(stringChar);
                 m_pos++;
                 stringChar = 0;
             }
             else if (m_buffer[m_pos] == '\\' && m_buffer[m_pos + 1] == stringChar)
             {
-                std::putchar('\\');
-                std::putchar(stringChar);
+                Output('\\');
+                Output(stringChar);
                 m_pos += 2;
             }
             else
             {
                 if (m_buffer[m_pos] == '\n')
                     m_lineNum++;
-                std::putchar(m_buffer[m_pos]);
+                Output(m_buffer[m_pos]);
                 m_pos++;
             }
         }
@@ -140,7 +144,7 @@ void CFile::Preproc()
 
             char c = m_buffer[m_pos++];
 
-            std::putchar(c);
+            Output(c);
 
             if (c == '\n')
                 m_lineNum++;
@@ -148,8 +152,39 @@ void CFile::Preproc()
                 stringChar = '"';
             else if (c == '\'')
                 stringChar = '\'';
+            else if (c == '{')
+                m_braceDepth++;
+            else if (c == '}' && --m_braceDepth == 0)
+                FlushOutput();
+            else if (c == ';' && m_braceDepth == 0)
+                FlushOutput();
         }
     }
+
+    FlushOutput();
+}
+
+// Output is held back until the end of the current top-level declaration,
+// so that TryOutputIncbinAsm can still rewrite the declaration it belongs to.
+void CFile::Output(char c)
+{
+    m_output += c;
+}
+
+void CFile::Print(const char* format, ...)
+{
+    char buffer[64];
+    std::va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    m_output.append(buffer, length);
+}
+
+void CFile::FlushOutput()
+{
+    std::fwrite(m_output.data(), 1, m_output.size(), g_outputFile);
+    m_output.clear();
 }
 
 bool CFile::ConsumeHorizontalWhitespace()
@@ -169,7 +204,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos += 2;
         m_lineNum++;
-        std::putchar('\n');
+        Output('\n');
         return true;
     }
 
@@ -177,7 +212,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos++;
         m_lineNum++;
-        std::putchar('\n');
+        Output('\n');
         return true;
     }
 
@@ -220,7 +255,7 @@ void CFile::TryConvertString()
 
     SkipWhitespace();
 
-    std::printf("{ ");
+    Print("{ ");
 
     while (1)
     {
@@ -242,7 +277,7 @@ void CFile::TryConvertString()
             }
 
             for (int i = 0; i < length; i++)
-                printf("0x%02X, ", s[i]);
+                Print("0x%02X, ", s[i]);
         }
         else if (m_buffer[m_pos] == ')')
         {
@@ -261,9 +296,9 @@ void CFile::TryConvertString()
     }
 
     if (noTerminator)
-        std::printf(" }");
+        Print(" }");
     else
-        std::printf("0xFF }");
+        Print("0xFF }");
 }
 
 bool CFile::CheckIdentifier(const std::string& ident)
@@ -341,6 +376,7 @@ void CFile::TryConvertIncbin()
 
     long oldPos = m_pos;
     long oldLineNum = m_lineNum;
+    std::size_t incbinStart = m_output.size();
 
     m_pos += idents[incbinType].length();
 
@@ -350,12 +386,16 @@ void CFile::TryConvertIncbin()
     {
         m_pos = oldPos;
         m_lineNum = oldLineNum;
+        m_output.resize(incbinStart);
         return;
     }
 
     m_pos++;
 
-    std::printf("{");
+    // Where the newlines skipped inside the INCBIN went in the output.
+    std::size_t openPos = m_output.size();
+    std::vector<std::string> paths;
+    std::vector<std::size_t> pathEnds;
 
     while (true)
     {
@@ -387,12 +427,47 @@ void CFile::TryConvertIncbin()
             m_pos++;
         }
 
-        std::string path(&m_buffer[startPos], m_pos - startPos);
+        paths.push_back(std::string(&m_buffer[startPos], m_pos - startPos));
+        pathEnds.push_back(m_output.size());
 
         m_pos++;
 
+        SkipWhitespace();
+
+        if (m_buffer[m_pos] != ',')
+            break;
+
+        m_pos++;
+    }
+    
+    if (m_buffer[m_pos] != ')')
+        RaiseError("expected ')'");
+
+    m_pos++;
+
+    if (!g_incbinAsm || !TryOutputIncbinAsm(incbinStart, paths, size))
+        OutputIncbinText(incbinStart, openPos, paths, pathEnds, size, isSigned);
+}
+
+void CFile::OutputIncbinText(std::size_t incbinStart, std::size_t openPos, const std::vector<std::string>& paths, const std::vector<std::size_t>& pathEnds, int size, bool isSigned)
+{
+    // Put the newlines skipped inside the INCBIN back where they were among
+    // the elements, so line numbers in diagnostics don't change.
+    std::string newlines = m_output.substr(incbinStart);
+    std::size_t newlinesPos = openPos - incbinStart;
+
+    m_output.resize(incbinStart);
+    m_output.append(newlines, 0, newlinesPos);
+
+    Print("{");
+
+    for (std::size_t j = 0; j < paths.size(); j++)
+    {
+        m_output.append(newlines, newlinesPos, pathEnds[j] - incbinStart - newlinesPos);
+        newlinesPos = pathEnds[j] - incbinStart;
+
         int fileSize;
-        std::unique_ptr<unsigned char[]> buffer = ReadWholeFile(path, fileSize);
+        std::unique_ptr<unsigned char[]> buffer = ReadWholeFile(paths[j], fileSize);
 
         if ((fileSize % size) != 0)
             RaiseError("Size %d doesn't evenly divide file size %d.\n", size, fileSize);
@@ -406,25 +481,255 @@ void CFile::TryConvertIncbin()
             offset += size;
 
             if (isSigned)
-                std::printf("%d,", data);
+                Print("%d,", data);
             else
-                std::printf("%uu,", data);
+                Print("%uu,", data);
         }
+    }
 
-        SkipWhitespace();
+    m_output.append(newlines, newlinesPos, std::string::npos);
+    Print("}");
+}
 
-        if (m_buffer[m_pos] != ',')
+static bool IsTypeOfSize(const std::string& type, int size)
+{
+    switch (size)
+    {
+    case 1:
+        return type == "u8" || type == "s8";
+    case 2:
+        return type == "u16" || type == "s16";
+    case 4:
+        return type == "u32" || type == "s32";
+    default:
+        return false;
+    }
+}
+
+// Turns "const u16 sFoo[] = INCBIN_U16(...)" into an extern declaration of
+// the right size and an .incbin of the files, so the compiler never has to
+// parse the data. Only plain const array declarations at file scope whose
+// element type matches the INCBIN are handled; for anything else this returns
+// false without touching the output and the data is expanded as text.
+bool CFile::TryOutputIncbinAsm(std::size_t incbinStart, const std::vector<std::string>& paths, int size)
+{
+    if (m_braceDepth != 0)
+        return false;
+
+    const std::string& out = m_output;
+    long pos = (long)incbinStart - 1;
+
+    while (pos >= 0 && IsWhitespace(out[pos]))
+        pos--;
+
+    if (pos < 0 || out[pos] != '=')
+        return false;
+
+    pos--;
+
+    while (pos >= 0 && IsWhitespace(out[pos]))
+        pos--;
+
+    if (pos < 0 || out[pos] != ']')
+        return false;
+
+    long bracketEnd = pos;
+
+    while (pos >= 0 && out[pos] != '[')
+        pos--;
+
+    if (pos < 0)
+        return false;
+
+    std::string countString = out.substr(pos + 1, bracketEnd - pos - 1);
+    countString.erase(0, countString.find_first_not_of(" \t"));
+    countString.erase(countString.find_last_not_of(" \t") + 1);
+
+    for (char c : countString)
+        if (!IsAsciiDigit(c))
+            return false;
+
+    pos--;
+
+    while (pos >= 0 && IsWhitespace(out[pos]))
+        pos--;
+
+    long nameEnd = pos + 1;
+
+    while (pos >= 0 && IsIdentifierChar(out[pos]))
+        pos--;
+
+    long nameStart = pos + 1;
+
+    if (nameStart == nameEnd || IsAsciiDigit(out[nameStart]))
+        return false;
+
+    std::string name = out.substr(nameStart, nameEnd - nameStart);
+
+    // The declaration specifiers start after any line markers the
+    // preprocessor put between this declaration and the previous one.
+    long declStart = 0;
+
+    while (declStart < nameStart)
+    {
+        long lineEnd = declStart;
+
+        while (lineEnd < nameStart && (out[lineEnd] == ' ' || out[lineEnd] == '\t'))
+            lineEnd++;
+
+        if (lineEnd < nameStart && out[lineEnd] == '\n')
+        {
+            declStart = lineEnd + 1;
+        }
+        else if (lineEnd < nameStart && out[lineEnd] == '#')
+        {
+            while (lineEnd < nameStart && out[lineEnd] != '\n')
+                lineEnd++;
+            declStart = lineEnd + 1;
+        }
+        else
+        {
             break;
+        }
+    }
 
-        m_pos++;
+    std::string specifiers = out.substr(declStart, nameStart - declStart);
+    bool isConst = false;
+    bool isStatic = false;
+    bool hasType = false;
+    int alignment = size;
+    std::size_t i = 0;
+
+    while (i < specifiers.length())
+    {
+        if (IsWhitespace(specifiers[i]))
+        {
+            i++;
+            continue;
+        }
+
+        if (!IsIdentifierStartingChar(specifiers[i]))
+            return false;
+
+        std::size_t start = i;
+
+        while (i < specifiers.length() && IsIdentifierChar(specifiers[i]))
+            i++;
+
+        std::string token = specifiers.substr(start, i - start);
+
+        if (token == "const")
+        {
+            isConst = true;
+        }
+        else if (token == "static")
+        {
+            isStatic = true;
+            specifiers.replace(start, token.length(), token.length(), ' ');
+        }
+        else if (token == "__attribute__")
+        {
+            std::size_t attributeStart = i;
+            int depth = 0;
+
+            do
+            {
+                if (i >= specifiers.length())
+                    return false;
+                if (specifiers[i] == '(')
+                    depth++;
+                else if (specifiers[i] == ')')
+                    depth--;
+                i++;
+            } while (depth > 0);
+
+            std::string attribute = specifiers.substr(attributeStart, i - attributeStart);
+
+            if (attribute.find("section") != std::string::npos)
+                return false;
+
+            std::size_t aligned = attribute.find("aligned(");
+
+            if (aligned != std::string::npos)
+                alignment = std::max(alignment, std::atoi(attribute.c_str() + aligned + 8));
+        }
+        else if (IsTypeOfSize(token, size) && !hasType)
+        {
+            hasType = true;
+        }
+        else
+        {
+            return false;
+        }
     }
-    
-    if (m_buffer[m_pos] != ')')
-        RaiseError("expected ')'");
 
-    m_pos++;
+    if (!isConst || !hasType || alignment <= 0 || (alignment & (alignment - 1)) != 0)
+        return false;
+
+    long totalSize = 0;
+
+    for (const std::string& path : paths)
+    {
+        std::FILE* fp = std::fopen(path.c_str(), "rb");
+
+        if (fp == nullptr)
+            RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
+
+        std::fseek(fp, 0, SEEK_END);
+        long fileSize = std::ftell(fp);
+        std::fclose(fp);
+
+        if ((fileSize % size) != 0)
+            RaiseError("Size %d doesn't evenly divide file size %ld.\n", size, fileSize);
+
+        totalSize += fileSize;
+    }
+
+    long count = totalSize / size;
+
+    if (!countString.empty())
+    {
+        long declaredCount = std::atol(countString.c_str());
+
+        if (declaredCount < count || declaredCount == 0)
+            return false;
+
+        count = declaredCount;
+    }
+
+    if (count == 0)
+        return false;
+
+    // Keep the newlines that were inside the declaration so line numbers
+    // in the compiler's diagnostics don't shift.
+    std::string newlines;
+
+    for (std::size_t j = nameStart; j < out.size(); j++)
+        if (out[j] == '\n')
+            newlines += '\n';
+
+    std::string replacement = "extern " + specifiers + name + "[" + std::to_string(count) + "]; ";
+
+    replacement += "asm(\".pushsection .rodata\\n\\t.balign " + std::to_string(alignment) + "\\n";
+
+    if (!isStatic)
+        replacement += "\\t.global " + name + "\\n";
+
+    replacement += "\\t.type " + name + ", %object\\n";
+    replacement += "\\t.size " + name + ", " + std::to_string(count * size) + "\\n";
+    replacement += name + ":\\n";
+
+    for (const std::string& path : paths)
+        replacement += "\\t.incbin \\\"" + path + "\\\"\\n";
+
+    if (count * size > totalSize)
+        replacement += "\\t.space " + std::to_string(count * size - totalSize) + "\\n";
+
+    replacement += "\\t.popsection\")" + newlines;
+
+    m_output.replace(declStart, std::string::npos, replacement);
 
-    std::printf("}");
+    return true;
 }
 
 // Reports a diagnostic message.
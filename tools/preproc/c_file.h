@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 #include "preproc.h"
 
 class CFile
@@ -43,6 +44,8 @@ private:
     long m_lineNum;
     std::string m_filename;
     bool m_isStdin;
+    int m_braceDepth;
+    std::string m_output;
 
     bool ConsumeHorizontalWhitespace();
     bool ConsumeNewline();
@@ -51,6 +54,11 @@ private:
     std::unique_ptr<unsigned char[]> ReadWholeFile(const std::string& path, int& size);
     bool CheckIdentifier(const std::string& ident);
     void TryConvertIncbin();
+    bool TryOutputIncbinAsm(std::size_t incbinStart, const std::vector<std::string>& paths, int size);
+    void OutputIncbinText(std::size_t incbinStart, std::size_t openPos, const std::vector<std::string>& paths, const std::vector<std::size_t>& pathEnds, int size, bool isSigned);
+    void Output(char c);
+    void Print(const char* format, ...);
+    void FlushOutput();
     void ReportDiagnostic(const char* type, const char* format, std::va_list args);
     void RaiseError(const char* format, ...);
     void RaiseWarning(const char* format, ...);
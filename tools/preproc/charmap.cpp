@@ -21,6 +21,13 @@
 #include <cstdio>
 #include <cstdint>
 #include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "preproc.h"
 #include "charmap.h"
 #include "char_util.h"
@@ -370,15 +377,35 @@ void CharmapReader::SkipWhitespace()
 }
 
 Charmap::Charmap(std::string filename)
+    : m_mapping(nullptr), m_mappingSize(0)
+{
+    if (!Map(filename))
+        Parse(filename);
+}
+
+Charmap::~Charmap()
+{
+#ifndef _WIN32
+    if (m_mapping != nullptr)
+        munmap(m_mapping, m_mappingSize);
+#endif
+}
+
+// Parses a text charmap and lays it out exactly like a compiled one, so that
+// lookups don't care where the tables came from.
+void Charmap::Parse(std::string filename)
 {
     CharmapReader reader(filename);
+    std::map<std::int32_t, std::string> chars;
+    std::string escapes[128];
+    std::map<std::string, std::string> constants;
 
     for (;;)
     {
         Lhs lhs = reader.ReadLhs();
 
         if (lhs.type == LhsType::None)
-            return;
+            break;
 
         reader.ExpectEqualsSign();
 
@@ -387,22 +414,193 @@ Charmap::Charmap(std::string filename)
         switch (lhs.type)
         {
         case LhsType::Char:
-            if (m_chars.find(lhs.code) != m_chars.end())
+            if (chars.find(lhs.code) != chars.end())
                 reader.RaiseError("redefining char");
-            m_chars[lhs.code] = sequence;
+            chars[lhs.code] = sequence;
             break;
         case LhsType::Escape:
-            if (m_escapes[lhs.code].length() != 0)
+            if (escapes[lhs.code].length() != 0)
                 reader.RaiseError("redefining escape");
-            m_escapes[lhs.code] = sequence;
+            escapes[lhs.code] = sequence;
             break;
         case LhsType::Constant:
-            if (m_constants.find(lhs.name) != m_constants.end())
+            if (constants.find(lhs.name) != constants.end())
                 reader.RaiseError("redefining constant");
-            m_constants[lhs.name] = sequence;
+            constants[lhs.name] = sequence;
             break;
         }
 
         reader.ExpectEmptyRestOfLine();
     }
+
+    std::string strings;
+
+    auto addString = [&strings](const std::string& string)
+    {
+        CharmapString result;
+        result.offset = strings.size();
+        result.length = string.size();
+        strings += string;
+        return result;
+    };
+
+    CharmapHeader header = {};
+    std::memcpy(header.magic, kCharmapMagic, sizeof(kCharmapMagic));
+    header.numChars = chars.size();
+    header.numConstants = constants.size();
+
+    for (int i = 0; i < 128; i++)
+        header.escapes[i] = addString(escapes[i]);
+
+    // std::map iterates in key order, which is what the binary searches in
+    // Char() and Constant() rely on.
+    std::vector<CharmapChar> charTable;
+
+    for (const auto& entry : chars)
+        charTable.push_back({ entry.first, addString(entry.second) });
+
+    std::vector<CharmapConstant> constantTable;
+
+    for (const auto& entry : constants)
+    {
+        CharmapString name = addString(entry.first);
+        constantTable.push_back({ name, addString(entry.second) });
+    }
+
+    header.stringsSize = strings.size();
+
+    std::size_t charsSize = charTable.size() * sizeof(CharmapChar);
+    std::size_t constantsSize = constantTable.size() * sizeof(CharmapConstant);
+
+    m_ownedData.resize(sizeof(header) + charsSize + constantsSize + strings.size());
+
+    char* dest = m_ownedData.data();
+    std::memcpy(dest, &header, sizeof(header));
+    dest += sizeof(header);
+    std::memcpy(dest, charTable.data(), charsSize);
+    dest += charsSize;
+    std::memcpy(dest, constantTable.data(), constantsSize);
+    dest += constantsSize;
+    std::memcpy(dest, strings.data(), strings.size());
+
+    SetTables(m_ownedData.data(), m_ownedData.size(), filename);
+}
+
+// Loads a compiled charmap. Returns false if the file is a text charmap.
+bool Charmap::Map(std::string filename)
+{
+    std::FILE* fp = std::fopen(filename.c_str(), "rb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", filename.c_str());
+
+    char magic[sizeof(kCharmapMagic)];
+    bool isCompiled = std::fread(magic, sizeof(magic), 1, fp) == 1
+                   && std::memcmp(magic, kCharmapMagic, sizeof(magic)) == 0;
+
+    if (!isCompiled)
+    {
+        std::fclose(fp);
+        return false;
+    }
+
+#ifdef _WIN32
+    std::fseek(fp, 0, SEEK_END);
+    long size = std::ftell(fp);
+    std::rewind(fp);
+
+    m_ownedData.resize(size);
+
+    if (std::fread(m_ownedData.data(), size, 1, fp) != 1)
+        FATAL_ERROR("Failed to read \"%s\".\n", filename.c_str());
+
+    std::fclose(fp);
+
+    SetTables(m_ownedData.data(), m_ownedData.size(), filename);
+#else
+    struct stat st;
+
+    if (fstat(fileno(fp), &st) != 0)
+        FATAL_ERROR("Failed to stat \"%s\".\n", filename.c_str());
+
+    m_mappingSize = st.st_size;
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+
+    if (m_mapping == MAP_FAILED)
+        FATAL_ERROR("Failed to map \"%s\".\n", filename.c_str());
+
+    std::fclose(fp);
+
+    SetTables(static_cast<const char*>(m_mapping), m_mappingSize, filename);
+#endif
+
+    return true;
+}
+
+void Charmap::SetTables(const char* data, std::size_t size, std::string filename)
+{
+    m_data = data;
+    m_size = size;
+
+    if (size < sizeof(CharmapHeader))
+        FATAL_ERROR("\"%s\" is truncated.\n", filename.c_str());
+
+    m_header = reinterpret_cast<const CharmapHeader*>(data);
+
+    std::size_t charsSize = m_header->numChars * sizeof(CharmapChar);
+    std::size_t constantsSize = m_header->numConstants * sizeof(CharmapConstant);
+
+    if (size != sizeof(CharmapHeader) + charsSize + constantsSize + m_header->stringsSize)
+        FATAL_ERROR("\"%s\" is not a valid compiled charmap.\n", filename.c_str());
+
+    m_chars = reinterpret_cast<const CharmapChar*>(data + sizeof(CharmapHeader));
+    m_constants = reinterpret_cast<const CharmapConstant*>(data + sizeof(CharmapHeader) + charsSize);
+    m_strings = data + sizeof(CharmapHeader) + charsSize + constantsSize;
+}
+
+std::string Charmap::Char(std::int32_t code) const
+{
+    const CharmapChar* first = m_chars;
+    const CharmapChar* last = m_chars + m_header->numChars;
+    const CharmapChar* it = std::lower_bound(first, last, code,
+        [](const CharmapChar& entry, std::int32_t code) { return entry.code < code; });
+
+    if (it == last || it->code != code)
+        return std::string();
+
+    return GetString(it->sequence);
+}
+
+std::string Charmap::Escape(unsigned char code) const
+{
+    return GetString(m_header->escapes[code]);
+}
+
+std::string Charmap::Constant(const std::string& identifier) const
+{
+    const CharmapConstant* first = m_constants;
+    const CharmapConstant* last = m_constants + m_header->numConstants;
+    const CharmapConstant* it = std::lower_bound(first, last, identifier,
+        [this](const CharmapConstant& entry, const std::string& identifier)
+        {
+            return identifier.compare(0, std::string::npos, m_strings + entry.name.offset, entry.name.length) > 0;
+        });
+
+    if (it == last || identifier.compare(0, std::string::npos, m_strings + it->name.offset, it->name.length) != 0)
+        return std::string();
+
+    return GetString(it->sequence);
+}
+
+void Charmap::Save(std::string filename) const
+{
+    std::FILE* fp = std::fopen(filename.c_str(), "wb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", filename.c_str());
+
+    if (std::fwrite(m_data, m_size, 1, fp) != 1)
+        FATAL_ERROR("Failed to write \"%s\".\n", filename.c_str());
+
+    std::fclose(fp);
 }
@@ -21,44 +21,73 @@
 #ifndef CHARMAP_H
 #define CHARMAP_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
-#include <map>
 #include <vector>
 
+// Compiled charmaps start with this magic, followed by the tables described
+// in charmap.cpp. They can be written with --compile-charmap and are mapped
+// straight into memory instead of being parsed.
+const char kCharmapMagic[8] = { 'P', 'P', 'C', 'H', 'M', 'A', 'P', '1' };
+
+struct CharmapString
+{
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct CharmapChar
+{
+    std::int32_t code;
+    CharmapString sequence;
+};
+
+struct CharmapConstant
+{
+    CharmapString name;
+    CharmapString sequence;
+};
+
+struct CharmapHeader
+{
+    char magic[8];
+    std::uint32_t numChars;
+    std::uint32_t numConstants;
+    std::uint32_t stringsSize;
+    CharmapString escapes[128];
+};
+
 class Charmap
 {
 public:
     Charmap(std::string filename);
+    Charmap(const Charmap&) = delete;
+    ~Charmap();
 
-    std::string Char(std::int32_t code)
-    {
-        auto it = m_chars.find(code);
-
-        if (it == m_chars.end())
-            return std::string();
-
-        return it->second;
-    }
+    std::string Char(std::int32_t code) const;
+    std::string Escape(unsigned char code) const;
+    std::string Constant(const std::string& identifier) const;
+    void Save(std::string filename) const;
+private:
+    void Parse(std::string filename);
+    bool Map(std::string filename);
+    void SetTables(const char* data, std::size_t size, std::string filename);
 
-    std::string Escape(unsigned char code)
+    std::string GetString(CharmapString string) const
     {
-        return m_escapes[code];
+        return std::string(m_strings + string.offset, string.length);
     }
 
-    std::string Constant(std::string identifier)
-    {
-        auto it = m_constants.find(identifier);
-
-        if (it == m_constants.end())
-            return std::string();
-
-        return it->second;
-    }
-private:
-    std::map<std::int32_t, std::string> m_chars;
-    std::string m_escapes[128];
-    std::map<std::string, std::string> m_constants;
+    std::vector<char> m_ownedData;
+    void* m_mapping;
+    std::size_t m_mappingSize;
+    const char* m_data;
+    std::size_t m_size;
+    const CharmapHeader* m_header;
+    const CharmapChar* m_chars;
+    const CharmapConstant* m_constants;
+    const char* m_strings;
 };
 
 #endif // CHARMAP_H
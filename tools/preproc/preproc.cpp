@@ -20,26 +20,32 @@
 
 #include <string>
 #include <stack>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstring>
 #include "preproc.h"
 #include "asm_file.h"
 #include "c_file.h"
 #include "charmap.h"
 
 Charmap* g_charmap;
+bool g_incbinAsm = false;
+thread_local std::FILE* g_outputFile = stdout;
 
 void PrintAsmBytes(unsigned char *s, int length)
 {
     if (length > 0)
     {
-        std::printf("\t.byte ");
+        std::fprintf(g_outputFile, "\t.byte ");
         for (int i = 0; i < length; i++)
         {
-            std::printf("0x%02X", s[i]);
+            std::fprintf(g_outputFile, "0x%02X", s[i]);
 
             if (i < length - 1)
-                std::printf(", ");
+                std::fprintf(g_outputFile, ", ");
         }
-        std::putchar('\n');
+        std::fputc('\n', g_outputFile);
     }
 }
 
@@ -90,7 +96,7 @@ void PreprocAsmFile(std::string filename)
             if (globalLabel.length() != 0)
             {
                 const char *s = globalLabel.c_str();
-                std::printf("%s: ; .global %s\n", s, s);
+                std::fprintf(g_outputFile, "%s: ; .global %s\n", s, s);
             }
             else
             {
@@ -130,35 +136,180 @@ char* GetFileExtension(char* filename)
     return extension;
 }
 
+void PreprocFile(char* filename, bool isStdin)
+{
+    char* extension = GetFileExtension(filename);
+
+    if (!extension)
+        FATAL_ERROR("\"%s\" has no file extension.\n", filename);
+
+    if ((extension[0] == 's') && extension[1] == 0)
+        PreprocAsmFile(filename);
+    else if ((extension[0] == 'c' || extension[0] == 'i') && extension[1] == 0)
+        PreprocCFile(filename, isStdin);
+    else
+        FATAL_ERROR("\"%s\" has an unknown file extension of \"%s\".\n", filename, extension);
+}
+
+struct BatchJob
+{
+    std::string sourcePath;
+    std::string outputPath;
+};
+
+// Reads a manifest of "SOURCE OUTPUT" lines. Blank lines and lines starting
+// with '#' are ignored.
+std::vector<BatchJob> ReadBatchManifest(const char* manifestPath)
+{
+    std::FILE* fp = std::fopen(manifestPath, "r");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", manifestPath);
+
+    std::vector<BatchJob> jobs;
+    char line[2 * kMaxPath + 2];
+    int lineNum = 0;
+
+    while (std::fgets(line, sizeof(line), fp) != NULL)
+    {
+        lineNum++;
+
+        char sourcePath[kMaxPath + 1];
+        char outputPath[kMaxPath + 1];
+        char extra;
+        int count = std::sscanf(line, "%256s %256s %c", sourcePath, outputPath, &extra);
+
+        if (count <= 0 || sourcePath[0] == '#')
+            continue;
+
+        if (count != 2)
+            FATAL_ERROR("%s:%d: expected \"SOURCE OUTPUT\".\n", manifestPath, lineNum);
+
+        jobs.push_back({ sourcePath, outputPath });
+    }
+
+    std::fclose(fp);
+
+    return jobs;
+}
+
+// Preprocesses every file in the manifest with one shared charmap. Each
+// output is written to a temporary file and renamed into place, so a failed
+// run never leaves a truncated output that looks up to date.
+void PreprocBatch(const char* manifestPath, int numThreads)
+{
+    std::vector<BatchJob> jobs = ReadBatchManifest(manifestPath);
+    std::atomic<std::size_t> nextJob(0);
+
+    auto worker = [&]()
+    {
+        std::size_t i;
+
+        while ((i = nextJob++) < jobs.size())
+        {
+            const BatchJob& job = jobs[i];
+            std::string tempPath = job.outputPath + ".tmp";
+
+            g_outputFile = std::fopen(tempPath.c_str(), "w");
+
+            if (g_outputFile == NULL)
+                FATAL_ERROR("Failed to open \"%s\" for writing.\n", tempPath.c_str());
+
+            std::vector<char> sourcePath(job.sourcePath.begin(), job.sourcePath.end());
+            sourcePath.push_back(0);
+
+            PreprocFile(sourcePath.data(), false);
+
+            if (std::fclose(g_outputFile) != 0)
+                FATAL_ERROR("Failed to write \"%s\".\n", tempPath.c_str());
+
+            g_outputFile = stdout;
+
+            if (std::rename(tempPath.c_str(), job.outputPath.c_str()) != 0)
+                FATAL_ERROR("Failed to rename \"%s\" to \"%s\".\n", tempPath.c_str(), job.outputPath.c_str());
+        }
+    };
+
+    if ((std::size_t)numThreads > jobs.size())
+        numThreads = jobs.size();
+
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void PrintUsage(const char* programName)
+{
+    std::fprintf(stderr,
+        "Usage: %s SRC_FILE CHARMAP_FILE [-i] [--incbin-asm]\n"
+        "       %s --batch MANIFEST CHARMAP_FILE [-j N] [--incbin-asm]\n"
+        "       %s --compile-charmap CHARMAP_FILE OUTPUT_FILE\n"
+        "where -i denotes if input is from stdin\n"
+        "--incbin-asm emits INCBIN arrays in C files as .incbin directives\n"
+        "CHARMAP_FILE may be a charmap compiled with --compile-charmap\n",
+        programName, programName, programName);
+}
+
 int main(int argc, char **argv)
 {
-    if (argc < 3 || argc > 4)
+    if (argc >= 2 && std::strcmp(argv[1], "--compile-charmap") == 0)
     {
-        std::fprintf(stderr, "Usage: %s SRC_FILE CHARMAP_FILE [-i]\nwhere -i denotes if input is from stdin\n", argv[0]);
-        return 1;
+        if (argc != 4)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        Charmap(argv[2]).Save(argv[3]);
+        return 0;
     }
 
-    g_charmap = new Charmap(argv[2]);
+    bool isBatch = argc >= 2 && std::strcmp(argv[1], "--batch") == 0;
+    int firstArg = isBatch ? 2 : 1;
+    bool isStdin = false;
+    int numThreads = std::thread::hardware_concurrency();
 
-    char* extension = GetFileExtension(argv[1]);
+    if (argc < firstArg + 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
 
-    if (!extension)
-        FATAL_ERROR("\"%s\" has no file extension.\n", argv[1]);
+    for (int i = firstArg + 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--incbin-asm") == 0)
+        {
+            g_incbinAsm = true;
+        }
+        else if (!isBatch && std::strcmp(argv[i], "-i") == 0)
+        {
+            isStdin = true;
+        }
+        else if (isBatch && std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            numThreads = std::atoi(argv[++i]);
 
-    if ((extension[0] == 's') && extension[1] == 0)
-        PreprocAsmFile(argv[1]);
-    else if ((extension[0] == 'c' || extension[0] == 'i') && extension[1] == 0) {
-        if (argc == 4) {
-            if (argv[3][0] == '-' && argv[3][1] == 'i' && argv[3][2] == '\0') {
-                PreprocCFile(argv[1], true);
-            } else {
-                FATAL_ERROR("unknown argument flag \"%s\".\n", argv[3]);
-            }
-        } else {
-            PreprocCFile(argv[1], false);
+            if (numThreads < 1)
+                FATAL_ERROR("Number of threads must be positive.\n");
+        }
+        else
+        {
+            FATAL_ERROR("unknown argument flag \"%s\".\n", argv[i]);
         }
-    } else
-        FATAL_ERROR("\"%s\" has an unknown file extension of \"%s\".\n", argv[1], extension);
+    }
+
+    g_charmap = new Charmap(argv[firstArg + 1]);
+
+    if (isBatch)
+        PreprocBatch(argv[firstArg], numThreads < 1 ? 1 : numThreads);
+    else
+        PreprocFile(argv[firstArg], isStdin);
 
     return 0;
 }
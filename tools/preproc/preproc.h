@@ -51,4 +51,12 @@ const unsigned long kMaxCharmapSequenceLength = 16;
 
 extern Charmap* g_charmap;
 
+// Whether INCBINs that initialize a const array are emitted as .incbin
+// directives instead of initializer lists.
+extern bool g_incbinAsm;
+
+// Where preprocessed output goes. Each batch worker points its own copy at
+// the file it is currently writing.
+extern thread_local std::FILE* g_outputFile;
+
 #endif // PREPROC_H
@@ -0,0 +1,88 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "profdecode.h"
+#include "buffer.h"
+
+// Size of the fields before the events in struct ProfilerBuffer.
+#define HEADER_SIZE 12
+#define EVENT_SIZE 8
+
+static std::uint32_t ReadU32(const std::string& data, std::size_t offset)
+{
+    return (unsigned char)data[offset]
+         | ((unsigned char)data[offset + 1] << 8)
+         | ((unsigned char)data[offset + 2] << 16)
+         | ((std::uint32_t)(unsigned char)data[offset + 3] << 24);
+}
+
+static std::uint16_t ReadU16(const std::string& data, std::size_t offset)
+{
+    return (unsigned char)data[offset] | ((unsigned char)data[offset + 1] << 8);
+}
+
+// Checks that what follows a copy of the magic number looks like a buffer
+// header, since the number can also appear in the code that sets it.
+static bool IsBuffer(const std::string& data, std::size_t offset)
+{
+    if (offset + HEADER_SIZE > data.size() || ReadU32(data, offset) != kProfilerMagic)
+        return false;
+
+    std::uint32_t eventCount = ReadU16(data, offset + 4);
+    std::uint32_t next = ReadU16(data, offset + 6);
+    std::uint32_t totalEvents = ReadU32(data, offset + 8);
+
+    if (eventCount < 2 || (eventCount & (eventCount - 1)) != 0 || next >= eventCount)
+        return false;
+
+    if (totalEvents < eventCount && next != totalEvents)
+        return false;
+
+    return offset + HEADER_SIZE + (std::size_t)eventCount * EVENT_SIZE <= data.size();
+}
+
+// Finds gProfilerBuffer in a dump of the GBA's memory (or any file that has a
+// copy of EWRAM in it, like an uncompressed save state) and returns its
+// events from oldest to newest.
+std::vector<Event> ReadProfilerBuffer(std::string dumpPath)
+{
+    std::ifstream file(dumpPath, std::ios::binary);
+
+    if (!file.is_open())
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", dumpPath.c_str());
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string data = contents.str();
+
+    std::size_t offset = 0;
+
+    while (offset < data.size() && !IsBuffer(data, offset))
+        offset++;
+
+    if (offset >= data.size())
+        FATAL_ERROR("error: no profiler buffer in \"%s\" (was the ROM built with PROFILER defined?)\n", dumpPath.c_str());
+
+    std::uint32_t eventCount = ReadU16(data, offset + 4);
+    std::uint32_t next = ReadU16(data, offset + 6);
+    std::uint32_t totalEvents = ReadU32(data, offset + 8);
+
+    // Once the ring buffer has wrapped around, the oldest event is the one
+    // that will be overwritten next.
+    std::uint32_t first = totalEvents > eventCount ? next : 0;
+    std::uint32_t count = totalEvents > eventCount ? eventCount : totalEvents;
+    std::vector<Event> events;
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::size_t eventOffset = offset + HEADER_SIZE + (std::size_t)((first + i) & (eventCount - 1)) * EVENT_SIZE;
+        Event event;
+
+        event.time = ReadU32(data, eventOffset);
+        event.id = ReadU32(data, eventOffset + 4);
+        events.push_back(event);
+    }
+
+    return events;
+}
@@ -0,0 +1,10 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <string>
+#include <vector>
+#include "profdecode.h"
+
+std::vector<Event> ReadProfilerBuffer(std::string dumpPath);
+
+#endif // BUFFER_H
@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "profdecode.h"
+#include "buffer.h"
+#include "symbols.h"
+#include "profile.h"
+#include "report.h"
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+        "Usage: profdecode [-top N] [-folded FOLDED_PATH] [-svg SVG_PATH] DUMP_PATH SYM_PATH\n"
+        "\n"
+        "Decodes the frame profiler's buffer (see include/profiler.h) from a dump of\n"
+        "the game's memory, using the symbol file made by \"make syms\", and prints\n"
+        "how busy the frames were.\n"
+        "\n"
+        "  -top N              list the N slowest frames (default 10, 0 for all)\n"
+        "  -folded FOLDED_PATH also write the time of each call stack in the format\n"
+        "                      flamegraph.pl reads (\"-\" for standard output)\n"
+        "  -svg SVG_PATH       also write a flame graph\n");
+    std::exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int top = 10;
+    std::string foldedPath;
+    std::string svgPath;
+    std::string paths[2];
+    int numPaths = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-top") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("error: missing number after \"-top\"\n");
+
+            top = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "-folded") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("error: missing path after \"-folded\"\n");
+
+            foldedPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-svg") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("error: missing path after \"-svg\"\n");
+
+            svgPath = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            FATAL_ERROR("error: unrecognized argument \"%s\"\n", argv[i]);
+        }
+        else
+        {
+            if (numPaths == 2)
+                PrintUsage();
+
+            paths[numPaths++] = argv[i];
+        }
+    }
+
+    if (numPaths != 2)
+        PrintUsage();
+
+    std::vector<Event> events = ReadProfilerBuffer(paths[0]);
+    SymbolTable symbols(paths[1]);
+    Profile profile = BuildProfile(events, symbols);
+
+    // Keep standard output clean for the folded stacks.
+    if (foldedPath != "-")
+        PrintSummary(profile, top);
+
+    if (!foldedPath.empty())
+        WriteFoldedStacks(profile, foldedPath);
+
+    if (!svgPath.empty())
+        WriteFlameGraph(profile, "Frame profile (" + std::to_string(profile.frames.size()) + " frames)", svgPath);
+
+    return 0;
+}
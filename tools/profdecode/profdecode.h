@@ -0,0 +1,45 @@
+#ifndef PROFDECODE_H
+#define PROFDECODE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef _MSC_VER
+
+#define FATAL_ERROR(format, ...)               \
+do                                             \
+{                                              \
+    std::fprintf(stderr, format, __VA_ARGS__); \
+    std::exit(1);                              \
+} while (0)
+
+#else
+
+#define FATAL_ERROR(format, ...)                 \
+do                                               \
+{                                                \
+    std::fprintf(stderr, format, ##__VA_ARGS__); \
+    std::exit(1);                                \
+} while (0)
+
+#endif // _MSC_VER
+
+// These match include/profiler.h.
+const std::uint32_t kProfilerMagic = 0x31525046;
+const std::uint32_t kEventEnd = 0x80000000;
+const std::uint32_t kEventInterrupt = 0x40000000;
+const std::uint32_t kEventFrame = 0x20000000;
+const std::uint32_t kEventBroken = 0x10000000;
+const std::uint32_t kEventPayloadMask = 0x0FFFFFFF;
+
+// CPU cycles from one VBlank to the next.
+const std::uint32_t kCyclesPerFrame = 280896;
+
+struct Event
+{
+    std::uint32_t time;
+    std::uint32_t id;
+};
+
+#endif // PROFDECODE_H
@@ -0,0 +1,143 @@
+#include <string>
+#include <utility>
+#include <vector>
+#include "profdecode.h"
+#include "symbols.h"
+#include "profile.h"
+
+const char *const kInterruptsNodeName = "[interrupts]";
+
+static std::size_t GetChild(Profile& profile, std::size_t parent, const std::string& name)
+{
+    auto it = profile.nodes[parent].children.find(name);
+
+    if (it != profile.nodes[parent].children.end())
+        return it->second;
+
+    CallNode node;
+    node.name = name;
+    node.selfCycles = 0;
+    node.totalCycles = 0;
+    profile.nodes.push_back(node);
+    profile.nodes[parent].children[name] = profile.nodes.size() - 1;
+    return profile.nodes.size() - 1;
+}
+
+// Attributes the time between the frame markers at events[start] and
+// events[end] to the functions that were running. Returns false if the begin
+// and end events don't match up, in which case nothing is added.
+static bool AddFrame(Profile& profile, const std::vector<Event>& events, std::size_t start, std::size_t end, const SymbolTable& symbols)
+{
+    std::size_t mainNode = GetChild(profile, 0, "AgbMain");
+    std::size_t interruptsNode = GetChild(profile, 0, kInterruptsNodeName);
+    std::vector<std::size_t> mainStack(1, mainNode);
+    std::vector<std::size_t> interruptStack;
+    std::vector<std::pair<std::size_t, std::uint32_t>> samples;
+    Frame frame;
+
+    frame.vblankCounter = events[start].id & kEventPayloadMask;
+    frame.vblanks = ((events[end].id & kEventPayloadMask) - frame.vblankCounter) & kEventPayloadMask;
+    frame.cycles = 0;
+    frame.idleCycles = 0;
+
+    for (std::size_t i = start + 1; i <= end; i++)
+    {
+        std::uint32_t cycles = events[i].time - events[i - 1].time;
+        std::size_t node = interruptStack.empty() ? mainStack.back() : interruptStack.back();
+        std::string callback;
+
+        if (!interruptStack.empty())
+            callback = profile.nodes[interruptStack.front()].name;
+        else if (mainStack.size() > 1)
+            callback = profile.nodes[mainStack[1]].name;
+        else
+            callback = profile.nodes[mainNode].name;
+
+        samples.push_back(std::make_pair(node, cycles));
+        frame.cycles += cycles;
+        frame.cyclesByCallback[callback] += cycles;
+
+        if (interruptStack.empty() && profile.nodes[node].name == "WaitForVBlank")
+            frame.idleCycles += cycles;
+
+        if (i == end)
+            break;
+
+        std::uint32_t id = events[i].id;
+
+        if (id & kEventFrame)
+            return false;
+
+        std::vector<std::size_t>& stack = (id & kEventInterrupt) ? interruptStack : mainStack;
+
+        if (id & kEventEnd)
+        {
+            if (stack.size() <= ((id & kEventInterrupt) ? 0u : 1u))
+                return false;
+
+            stack.pop_back();
+        }
+        else
+        {
+            std::size_t parent = stack.empty() ? interruptsNode : stack.back();
+            stack.push_back(GetChild(profile, parent, symbols.GetName(id & kEventPayloadMask)));
+        }
+    }
+
+    if (mainStack.size() != 1 || !interruptStack.empty())
+        return false;
+
+    for (std::size_t i = 0; i < samples.size(); i++)
+        profile.nodes[samples[i].first].selfCycles += samples[i].second;
+
+    profile.frames.push_back(frame);
+    return true;
+}
+
+static std::uint64_t SumTotals(Profile& profile, std::size_t index)
+{
+    std::uint64_t total = profile.nodes[index].selfCycles;
+
+    for (const auto& child : profile.nodes[index].children)
+        total += SumTotals(profile, child.second);
+
+    profile.nodes[index].totalCycles = total;
+    return total;
+}
+
+// Builds a call tree from the events, using only the frames that were timed
+// completely. The events before the first frame marker and after the last one
+// are partial frames, so they are dropped too.
+Profile BuildProfile(const std::vector<Event>& events, const SymbolTable& symbols)
+{
+    Profile profile;
+    CallNode root;
+
+    root.selfCycles = 0;
+    root.totalCycles = 0;
+    profile.nodes.push_back(root);
+    profile.untimedFrames = 0;
+    profile.unmatchedFrames = 0;
+
+    std::size_t start = events.size();
+
+    for (std::size_t i = 0; i < events.size(); i++)
+    {
+        if (!(events[i].id & kEventFrame))
+            continue;
+
+        if (start < events.size())
+        {
+            // The marker that ends a frame says whether it was timed.
+            if (events[i].id & kEventBroken)
+                profile.untimedFrames++;
+            else if (!AddFrame(profile, events, start, i, symbols))
+                profile.unmatchedFrames++;
+        }
+
+        start = i;
+    }
+
+    SumTotals(profile, 0);
+    return profile;
+}
@@ -0,0 +1,41 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "profdecode.h"
+#include "symbols.h"
+
+// One function in one call stack. Node 0 is the root, whose children are
+// AgbMain and kInterruptsNodeName.
+struct CallNode
+{
+    std::string name;
+    std::uint64_t selfCycles;
+    std::uint64_t totalCycles;
+    std::map<std::string, std::size_t> children;
+};
+
+struct Frame
+{
+    std::uint32_t vblankCounter;
+    std::uint32_t vblanks; // How many VBlanks passed before the next frame started.
+    std::uint64_t cycles;
+    std::uint64_t idleCycles; // Spent in WaitForVBlank, not counting interrupts.
+    std::map<std::string, std::uint64_t> cyclesByCallback; // By child of AgbMain or interrupt handler.
+};
+
+struct Profile
+{
+    std::vector<CallNode> nodes;
+    std::vector<Frame> frames;
+    int untimedFrames;
+    int unmatchedFrames;
+};
+
+extern const char *const kInterruptsNodeName;
+
+Profile BuildProfile(const std::vector<Event>& events, const SymbolTable& symbols);
+
+#endif // PROFILE_H
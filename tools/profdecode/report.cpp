@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "profdecode.h"
+#include "profile.h"
+#include "report.h"
+
+static double FramePercent(std::uint64_t cycles)
+{
+    return cycles * 100.0 / kCyclesPerFrame;
+}
+
+static std::uint64_t BusyCycles(const Frame& frame)
+{
+    return frame.cycles - frame.idleCycles;
+}
+
+void PrintSummary(const Profile& profile, int top)
+{
+    std::printf("Frames: %d (%d skipped because the timers were in use, %d with unmatched events)\n",
+        (int)profile.frames.size(), profile.untimedFrames, profile.unmatchedFrames);
+
+    if (profile.frames.empty())
+        return;
+
+    std::uint64_t totalBusy = 0;
+    std::uint64_t peakBusy = 0;
+    int slowFrames = 0;
+
+    for (const Frame& frame : profile.frames)
+    {
+        totalBusy += BusyCycles(frame);
+        peakBusy = std::max(peakBusy, BusyCycles(frame));
+
+        if (frame.vblanks > 1)
+            slowFrames++;
+    }
+
+    std::uint64_t averageBusy = totalBusy / profile.frames.size();
+
+    std::printf("Frames that took more than one VBlank: %d\n", slowFrames);
+    std::printf("Busy cycles per frame: %llu (%.1f%%) on average, %llu (%.1f%%) at most\n",
+        (unsigned long long)averageBusy, FramePercent(averageBusy),
+        (unsigned long long)peakBusy, FramePercent(peakBusy));
+
+    std::vector<const Frame *> frames;
+
+    for (const Frame& frame : profile.frames)
+        frames.push_back(&frame);
+
+    std::stable_sort(frames.begin(), frames.end(), [](const Frame *a, const Frame *b) {
+        return BusyCycles(*a) > BusyCycles(*b);
+    });
+
+    if (top > 0 && (std::size_t)top < frames.size())
+        frames.resize(top);
+
+    std::printf("\nSlowest frames:\n");
+    std::printf("%10s %12s %8s  %s\n", "VBlank", "Busy cycles", "Frame %", "Biggest parts");
+
+    for (const Frame *frame : frames)
+    {
+        std::vector<std::pair<std::string, std::uint64_t>> parts;
+
+        for (const auto& part : frame->cyclesByCallback)
+        {
+            if (part.first != "WaitForVBlank")
+                parts.push_back(part);
+        }
+
+        std::stable_sort(parts.begin(), parts.end(), [](const std::pair<std::string, std::uint64_t>& a, const std::pair<std::string, std::uint64_t>& b) {
+            return a.second > b.second;
+        });
+
+        std::printf("%10u %12llu %7.1f%% ", frame->vblankCounter, (unsigned long long)BusyCycles(*frame), FramePercent(BusyCycles(*frame)));
+
+        for (std::size_t i = 0; i < parts.size() && i < 3; i++)
+            std::printf(" %s %llu", parts[i].first.c_str(), (unsigned long long)parts[i].second);
+
+        std::printf("\n");
+    }
+}
+
+static void WriteFoldedNode(const Profile& profile, std::size_t index, std::string path, std::FILE *fp)
+{
+    const CallNode& node = profile.nodes[index];
+
+    if (index != 0)
+        path += path.empty() ? node.name : ";" + node.name;
+
+    if (node.selfCycles != 0)
+        std::fprintf(fp, "%s %llu\n", path.c_str(), (unsigned long long)node.selfCycles);
+
+    for (const auto& child : node.children)
+        WriteFoldedNode(profile, child.second, path, fp);
+}
+
+// Writes one line per call stack with the cycles spent in its last function,
+// which is the input format of flamegraph.pl and speedscope.
+void WriteFoldedStacks(const Profile& profile, std::string path)
+{
+    std::FILE *fp = path == "-" ? stdout : std::fopen(path.c_str(), "w");
+
+    if (fp == nullptr)
+        FATAL_ERROR("error: failed to open \"%s\" for writing\n", path.c_str());
+
+    WriteFoldedNode(profile, 0, "", fp);
+
+    if (fp != stdout)
+        std::fclose(fp);
+}
+
+#define SVG_WIDTH 1200
+#define SVG_PADDING 10
+#define SVG_TITLE_HEIGHT 30
+#define SVG_FRAME_HEIGHT 16
+#define SVG_FONT_SIZE 12
+#define SVG_CHAR_WIDTH 7.0
+#define SVG_MIN_WIDTH 0.1
+
+static std::string EscapeXml(const std::string& text)
+{
+    std::string escaped;
+
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '&': escaped += "&amp;"; break;
+        case '<': escaped += "&lt;"; break;
+        case '>': escaped += "&gt;"; break;
+        case '"': escaped += "&quot;"; break;
+        default: escaped += c; break;
+        }
+    }
+
+    return escaped;
+}
+
+static int GetDepth(const Profile& profile, std::size_t index)
+{
+    int depth = 0;
+
+    for (const auto& child : profile.nodes[index].children)
+        depth = std::max(depth, GetDepth(profile, child.second) + 1);
+
+    return depth;
+}
+
+// Picks a warm color from the name, so a function keeps its color everywhere.
+static void GetColor(const std::string& name, int *r, int *g, int *b)
+{
+    std::uint32_t hash = 2166136261u;
+
+    for (char c : name)
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+
+    *r = 205 + hash % 50;
+    *g = (hash >> 8) % 230;
+    *b = (hash >> 16) % 55;
+}
+
+static void WriteSvgNode(const Profile& profile, std::size_t index, double x, int depth, double cyclesPerPixel, int height, std::FILE *fp)
+{
+    const CallNode& node = profile.nodes[index];
+    double width = node.totalCycles / cyclesPerPixel;
+
+    if (width < SVG_MIN_WIDTH)
+        return;
+
+    std::string name = index == 0 ? "all" : node.name;
+    double y = height - SVG_PADDING - (depth + 1) * SVG_FRAME_HEIGHT;
+    double percent = node.totalCycles * 100.0 / profile.nodes[0].totalCycles;
+    int r, g, b;
+
+    GetColor(name, &r, &g, &b);
+    std::fprintf(fp, "<g><title>%s (%llu cycles, %.2f%%)</title>", EscapeXml(name).c_str(), (unsigned long long)node.totalCycles, percent);
+    std::fprintf(fp, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%d\" fill=\"rgb(%d,%d,%d)\" rx=\"2\" ry=\"2\"/>", x, y, width, SVG_FRAME_HEIGHT - 1, r, g, b);
+
+    std::size_t maxChars = (width - 6) / SVG_CHAR_WIDTH;
+
+    if (maxChars >= 3)
+    {
+        std::string label = name.size() <= maxChars ? name : name.substr(0, maxChars - 2) + "..";
+        std::fprintf(fp, "<text x=\"%.1f\" y=\"%.1f\">%s</text>", x + 3, y + SVG_FRAME_HEIGHT - 4.5, EscapeXml(label).c_str());
+    }
+
+    std::fprintf(fp, "</g>\n");
+
+    for (const auto& child : node.children)
+    {
+        WriteSvgNode(profile, child.second, x, depth + 1, cyclesPerPixel, height, fp);
+        x += profile.nodes[child.second].totalCycles / cyclesPerPixel;
+    }
+}
+
+// Writes a flame graph as a standalone SVG file. Hovering over a function
+// shows its name and how many cycles it took with what it called.
+void WriteFlameGraph(const Profile& profile, std::string title, std::string path)
+{
+    std::FILE *fp = std::fopen(path.c_str(), "w");
+
+    if (fp == nullptr)
+        FATAL_ERROR("error: failed to open \"%s\" for writing\n", path.c_str());
+
+    int height = SVG_TITLE_HEIGHT + (GetDepth(profile, 0) + 1) * SVG_FRAME_HEIGHT + 2 * SVG_PADDING;
+    double cyclesPerPixel = std::max<std::uint64_t>(profile.nodes[0].totalCycles, 1) / (double)(SVG_WIDTH - 2 * SVG_PADDING);
+
+    std::fprintf(fp, "<?xml version=\"1.0\" standalone=\"no\"?>\n");
+    std::fprintf(fp, "<svg version=\"1.1\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\" xmlns=\"http://www.w3.org/2000/svg\">\n", SVG_WIDTH, height, SVG_WIDTH, height);
+    std::fprintf(fp, "<style>text { font-family: Verdana, sans-serif; font-size: %dpx; fill: #000; pointer-events: none; } rect:hover { stroke: #000; stroke-width: 0.5; }</style>\n", SVG_FONT_SIZE);
+    std::fprintf(fp, "<rect x=\"0\" y=\"0\" width=\"100%%\" height=\"100%%\" fill=\"#f8f8f8\"/>\n");
+    std::fprintf(fp, "<text x=\"%d\" y=\"%d\" text-anchor=\"middle\" style=\"font-size: 17px\">%s</text>\n", SVG_WIDTH / 2, SVG_TITLE_HEIGHT - 6, EscapeXml(title).c_str());
+
+    if (profile.nodes[0].totalCycles != 0)
+        WriteSvgNode(profile, 0, SVG_PADDING, 0, cyclesPerPixel, height, fp);
+
+    std::fprintf(fp, "</svg>\n");
+    std::fclose(fp);
+}
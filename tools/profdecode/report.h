@@ -0,0 +1,11 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <string>
+#include "profile.h"
+
+void PrintSummary(const Profile& profile, int top);
+void WriteFoldedStacks(const Profile& profile, std::string path);
+void WriteFlameGraph(const Profile& profile, std::string title, std::string path);
+
+#endif // REPORT_H
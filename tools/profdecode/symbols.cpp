@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "profdecode.h"
+#include "symbols.h"
+
+// Reads a symbol file made by "make syms", where each line is the address,
+// the symbol type, the size and the name.
+SymbolTable::SymbolTable(std::string path)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", path.c_str());
+
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string type;
+        Symbol symbol;
+
+        if (!(fields >> std::hex >> symbol.address >> type >> symbol.size >> symbol.name))
+            continue;
+
+        if (symbol.size == 0)
+            continue;
+
+        // Bit 0 of a Thumb function's address is only a marker.
+        symbol.address &= ~1u;
+        m_symbols.push_back(symbol);
+    }
+
+    if (m_symbols.empty())
+        FATAL_ERROR("error: no symbols in \"%s\"\n", path.c_str());
+
+    std::sort(m_symbols.begin(), m_symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.address < b.address;
+    });
+}
+
+// Returns the name of the symbol that holds address, or the address in hex if
+// no symbol does.
+std::string SymbolTable::GetName(std::uint32_t address) const
+{
+    auto it = std::upper_bound(m_symbols.begin(), m_symbols.end(), address, [](std::uint32_t value, const Symbol& symbol) {
+        return value < symbol.address;
+    });
+
+    if (it != m_symbols.begin())
+    {
+        --it;
+
+        if (address - it->address < it->size)
+            return it->name;
+    }
+
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "0x%08X", address);
+    return buffer;
+}
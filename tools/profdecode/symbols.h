@@ -0,0 +1,25 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <string>
+#include <vector>
+#include "profdecode.h"
+
+class SymbolTable
+{
+public:
+    explicit SymbolTable(std::string path);
+    std::string GetName(std::uint32_t address) const;
+
+private:
+    struct Symbol
+    {
+        std::uint32_t address;
+        std::uint32_t size;
+        std::string name;
+    };
+
+    std::vector<Symbol> m_symbols;
+};
+
+#endif // SYMBOLS_H
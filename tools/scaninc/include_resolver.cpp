@@ -0,0 +1,75 @@
+#include <dirent.h>
+#include "include_resolver.h"
+
+bool IncludeResolver::FileExists(const std::string& path)
+{
+    std::size_t slash = path.rfind('/');
+    std::string dir = slash != std::string::npos ? path.substr(0, slash) : ".";
+    std::string name = slash != std::string::npos ? path.substr(slash + 1) : path;
+
+    if (dir.empty())
+        dir = "/";
+
+    std::lock_guard<std::mutex> lock(m_dirMutex);
+    auto it = m_dirListings.find(dir);
+
+    if (it == m_dirListings.end())
+    {
+        std::set<std::string>& listing = m_dirListings[dir];
+        DIR *dirp = opendir(dir.c_str());
+
+        if (dirp != NULL)
+        {
+            struct dirent *entry;
+
+            while ((entry = readdir(dirp)) != NULL)
+                listing.insert(entry->d_name);
+
+            closedir(dirp);
+        }
+
+        return listing.count(name) != 0;
+    }
+
+    return it->second.count(name) != 0;
+}
+
+bool IncludeResolver::Resolve(const std::string& srcDir, const std::string& include, std::string& path)
+{
+    auto key = std::make_pair(srcDir, include);
+
+    {
+        std::lock_guard<std::mutex> lock(m_resolutionMutex);
+        auto it = m_resolutions.find(key);
+
+        if (it != m_resolutions.end())
+        {
+            m_numMemoHits++;
+            path = it->second.path;
+            return it->second.exists;
+        }
+    }
+
+    Resolution resolution = { false, "" };
+
+    for (std::size_t i = 0; i <= m_includeDirs.size(); i++)
+    {
+        const std::string& includeDir = i < m_includeDirs.size() ? m_includeDirs[i] : srcDir;
+
+        resolution.path = includeDir + include;
+
+        if (FileExists(resolution.path))
+        {
+            resolution.exists = true;
+            break;
+        }
+    }
+
+    m_numResolved++;
+
+    std::lock_guard<std::mutex> lock(m_resolutionMutex);
+    m_resolutions[key] = resolution;
+    path = resolution.path;
+
+    return resolution.exists;
+}
@@ -0,0 +1,43 @@
+#ifndef INCLUDE_RESOLVER_H
+#define INCLUDE_RESOLVER_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Finds the file an include refers to by trying each include directory in
+// turn, followed by the directory of the including file. Directory listings
+// and resolved paths are memoized, so each directory is read once and each
+// (directory, include) pair is only looked up once per run. Safe to use from
+// several threads at once.
+class IncludeResolver
+{
+public:
+    IncludeResolver(const std::vector<std::string>& includeDirs) : m_includeDirs(includeDirs) {}
+    bool Resolve(const std::string& srcDir, const std::string& include, std::string& path);
+    int GetNumResolved() const { return m_numResolved; }
+    int GetNumMemoHits() const { return m_numMemoHits; }
+
+private:
+    struct Resolution
+    {
+        bool exists;
+        std::string path;
+    };
+
+    std::vector<std::string> m_includeDirs;
+    std::map<std::string, std::set<std::string>> m_dirListings;
+    std::map<std::pair<std::string, std::string>, Resolution> m_resolutions;
+    std::mutex m_dirMutex;
+    std::mutex m_resolutionMutex;
+    std::atomic<int> m_numResolved{0};
+    std::atomic<int> m_numMemoHits{0};
+
+    bool FileExists(const std::string& path);
+};
+
+#endif // INCLUDE_RESOLVER_H
@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include "scan_cache.h"
+#include "source_file.h"
+
+// Bump this whenever the scanner's output for a given file could change.
+static const char *const DATABASE_HEADER = "scaninc-cache 1";
+
+static bool GetFileStamp(const std::string& path, long long& mtime, long long& size)
+{
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+
+#if defined(__APPLE__)
+    mtime = (long long)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    mtime = (long long)st.st_mtime * 1000000000;
+#else
+    mtime = (long long)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    size = st.st_size;
+
+    return true;
+}
+
+// The database is a text file. Each scanned file starts with a line
+// "F<TAB>path<TAB>mtime<TAB>size", followed by one "I<TAB>path" line per
+// include and one "B<TAB>path" line per incbin.
+void ScanCache::Load(const std::string& path)
+{
+    std::ifstream in(path);
+
+    if (!in.is_open())
+        return;
+
+    std::string line;
+
+    if (!std::getline(in, line) || line != DATABASE_HEADER)
+        return;
+
+    ScanResult *result = nullptr;
+
+    while (std::getline(in, line))
+    {
+        if (line.size() < 2 || line[1] != '\t')
+            break;
+
+        std::string value = line.substr(2);
+
+        if (line[0] == 'F')
+        {
+            std::istringstream fields(value);
+            std::string filePath;
+            ScanResult entry;
+
+            if (!std::getline(fields, filePath, '\t') || !(fields >> entry.mtime >> entry.size))
+                break;
+
+            entry.verified = false;
+
+            result = &(m_results[filePath] = entry);
+        }
+        else if (line[0] == 'I' && result != nullptr)
+        {
+            result->includes.insert(value);
+        }
+        else if (line[0] == 'B' && result != nullptr)
+        {
+            result->incbins.insert(value);
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+void ScanCache::Save(const std::string& path)
+{
+    if (!m_dirty)
+        return;
+
+    std::string tempPath = path + ".tmp";
+    std::FILE *fp = std::fopen(tempPath.c_str(), "wb");
+
+    if (fp == NULL)
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", tempPath.c_str());
+
+    std::fprintf(fp, "%s\n", DATABASE_HEADER);
+
+    for (const auto& entry : m_results)
+    {
+        const ScanResult& result = entry.second;
+
+        std::fprintf(fp, "F\t%s\t%lld\t%lld\n", entry.first.c_str(), result.mtime, result.size);
+
+        for (const std::string& include : result.includes)
+            std::fprintf(fp, "I\t%s\n", include.c_str());
+
+        for (const std::string& incbin : result.incbins)
+            std::fprintf(fp, "B\t%s\n", incbin.c_str());
+    }
+
+    if (std::fclose(fp) != 0)
+        FATAL_ERROR("Failed to write \"%s\".\n", tempPath.c_str());
+
+    std::remove(path.c_str());
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        FATAL_ERROR("Failed to rename \"%s\" to \"%s\".\n", tempPath.c_str(), path.c_str());
+
+    m_dirty = false;
+}
+
+// Removes "." segments and "dir/.." pairs, e.g. "include/../gflib/./bg.h"
+// becomes "gflib/bg.h".
+std::string NormalizePath(const std::string& path)
+{
+    std::vector<std::string> segments;
+    std::size_t start = 0;
+
+    while (start <= path.size())
+    {
+        std::size_t end = path.find('/', start);
+
+        if (end == std::string::npos)
+            end = path.size();
+
+        std::string segment = path.substr(start, end - start);
+
+        if (segment == "..")
+        {
+            if (!segments.empty() && segments.back() != ".." && !segments.back().empty())
+                segments.pop_back();
+            else
+                segments.push_back(segment);
+        }
+        else if (segment != "." && !(segment.empty() && !segments.empty()))
+        {
+            segments.push_back(segment);
+        }
+
+        start = end + 1;
+    }
+
+    std::string normalized;
+
+    for (std::size_t i = 0; i < segments.size(); i++)
+    {
+        if (i != 0)
+            normalized += '/';
+        normalized += segments[i];
+    }
+
+    return normalized;
+}
+
+const ScanResult& ScanCache::Get(const std::string& path)
+{
+    std::string key = NormalizePath(path);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_results.find(key);
+
+        if (it != m_results.end() && it->second.verified)
+        {
+            m_numHits++;
+            return it->second;
+        }
+    }
+
+    long long mtime = 0;
+    long long size = 0;
+
+    GetFileStamp(path, mtime, size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_results.find(key);
+
+        if (it != m_results.end() && (it->second.verified || (it->second.mtime == mtime && it->second.size == size)))
+        {
+            it->second.verified = true;
+            m_numHits++;
+            return it->second;
+        }
+    }
+
+    // Lex without holding the lock. If another thread scans the same file at
+    // the same time, whichever finishes first wins and the other result is
+    // dropped, so references handed out earlier stay valid.
+    SourceFile file(path);
+    m_numLexed++;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ScanResult& result = m_results[key];
+
+    if (!result.verified)
+    {
+        result.mtime = mtime;
+        result.size = size;
+        result.verified = true;
+        result.includes = file.GetIncludes();
+        result.incbins = file.GetIncbins();
+        m_dirty = true;
+    }
+
+    return result;
+}
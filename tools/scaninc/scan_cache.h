@@ -0,0 +1,46 @@
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include "scaninc.h"
+
+// The includes and incbins found in one file, along with the size and
+// modification time the file had when it was scanned.
+struct ScanResult
+{
+    long long mtime;
+    long long size;
+    bool verified;
+    std::set<std::string> includes;
+    std::set<std::string> incbins;
+};
+
+// Scans source files on demand and remembers the results, optionally across
+// runs in a database file, so that a file is only read again when its size or
+// modification time changes. Files are keyed by their normalized path, so a
+// header reached through two different paths is only scanned once. Get may be
+// called from several threads at once.
+class ScanCache
+{
+public:
+    void Load(const std::string& path);
+    void Save(const std::string& path);
+    const ScanResult& Get(const std::string& path);
+    int GetNumLexed() const { return m_numLexed; }
+    int GetNumHits() const { return m_numHits; }
+
+private:
+    std::map<std::string, ScanResult> m_results;
+    std::mutex m_mutex;
+    bool m_dirty = false;
+    std::atomic<int> m_numLexed{0};
+    std::atomic<int> m_numHits{0};
+};
+
+std::string NormalizePath(const std::string& path);
+
+#endif // SCAN_CACHE_H
@@ -18,34 +18,113 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <list>
 #include <queue>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 #include "scaninc.h"
 #include "source_file.h"
+#include "scan_cache.h"
+#include "include_resolver.h"
 
-bool CanOpenFile(std::string path)
+const char *const USAGE =
+    "Usage: scaninc [-I INCLUDE_PATH] [--cache DB_PATH] [--stats] FILE_PATH\n"
+    "       scaninc [-I INCLUDE_PATH] [--cache DB_PATH] [--stats] [-j THREADS] --obj-dir OBJ_DIR FILE_PATH...\n";
+
+std::set<std::string> ScanDependencies(const std::string& initialPath, IncludeResolver& resolver, ScanCache& cache)
 {
-    FILE *fp = std::fopen(path.c_str(), "rb");
+    std::queue<std::string> filesToProcess;
+    std::set<std::string> dependencies;
+
+    filesToProcess.push(initialPath);
+
+    while (!filesToProcess.empty())
+    {
+        std::string filePath = filesToProcess.front();
+        const ScanResult& file = cache.Get(filePath);
+        SourceFileType fileType = GetFileType(filePath);
+        std::string srcDir = GetDir(filePath);
+        filesToProcess.pop();
+
+        for (auto incbin : file.incbins)
+        {
+            dependencies.insert(incbin);
+        }
+        for (auto include : file.includes)
+        {
+            std::string path;
+            bool exists = resolver.Resolve(srcDir, include, path);
+            if (!exists && (fileType == SourceFileType::Asm || fileType == SourceFileType::Inc))
+            {
+                path = include;
+            }
+            bool inserted = dependencies.insert(path).second;
+            if (inserted && exists)
+            {
+                filesToProcess.push(path);
+            }
+        }
+    }
+
+    return dependencies;
+}
+
+// Writes a make rule "OBJ_DIR/file.o: file deps..." to OBJ_DIR/file.d. The file
+// is left untouched if it already has the same contents.
+void WriteDepFile(const std::string& objDir, const std::string& sourcePath, const std::set<std::string>& dependencies)
+{
+    std::string basePath = objDir + "/" + sourcePath.substr(0, sourcePath.find_last_of('.'));
+    std::string depPath = basePath + ".d";
+    std::string contents = basePath + ".o: " + sourcePath;
+
+    for (const std::string& path : dependencies)
+        contents += " \\\n " + path;
+
+    contents += "\n";
+
+    std::FILE *fp = std::fopen(depPath.c_str(), "rb");
+
+    if (fp != NULL)
+    {
+        std::string existing;
+        char buffer[4096];
+        std::size_t count;
+
+        while ((count = std::fread(buffer, 1, sizeof(buffer), fp)) > 0)
+            existing.append(buffer, count);
+
+        std::fclose(fp);
+
+        if (existing == contents)
+            return;
+    }
+
+    fp = std::fopen(depPath.c_str(), "wb");
 
     if (fp == NULL)
-        return false;
+        FATAL_ERROR("Failed to open \"%s\" for writing.\n", depPath.c_str());
+
+    if (std::fwrite(contents.data(), contents.size(), 1, fp) != 1)
+        FATAL_ERROR("Failed to write \"%s\".\n", depPath.c_str());
 
     std::fclose(fp);
-    return true;
 }
 
-const char *const USAGE = "Usage: scaninc [-I INCLUDE_PATH] FILE_PATH\n";
-
 int main(int argc, char **argv)
 {
-    std::queue<std::string> filesToProcess;
-    std::set<std::string> dependencies;
-
     std::vector<std::string> includeDirs;
+    std::string cachePath;
+    std::string objDir;
+    bool hasObjDir = false;
+    bool printStats = false;
+    int numThreads = std::thread::hardware_concurrency();
+    auto startTime = std::chrono::steady_clock::now();
 
     argc--;
     argv++;
@@ -68,6 +147,35 @@ int main(int argc, char **argv)
             }
             includeDirs.push_back(includeDir);
         }
+        else if (arg == "--cache")
+        {
+            argc--;
+            argv++;
+            cachePath = std::string(argv[0]);
+        }
+        else if (arg == "--stats")
+        {
+            printStats = true;
+        }
+        else if (arg == "-j")
+        {
+            argc--;
+            argv++;
+            numThreads = std::atoi(argv[0]);
+            if (numThreads < 1)
+                FATAL_ERROR("Number of threads must be positive.\n");
+        }
+        else if (arg == "--obj-dir")
+        {
+            argc--;
+            argv++;
+            objDir = std::string(argv[0]);
+            hasObjDir = true;
+        }
+        else if (hasObjDir && arg[0] != '-')
+        {
+            break;
+        }
         else
         {
             FATAL_ERROR(USAGE);
@@ -76,53 +184,58 @@ int main(int argc, char **argv)
         argv++;
     }
 
-    if (argc != 1) {
+    if (argc < 1 || (argc != 1 && !hasObjDir)) {
         FATAL_ERROR(USAGE);
     }
 
-    std::string initialPath(argv[0]);
+    ScanCache cache;
+    IncludeResolver resolver(includeDirs);
 
-    filesToProcess.push(initialPath);
+    if (!cachePath.empty())
+        cache.Load(cachePath);
 
-    while (!filesToProcess.empty())
+    if (hasObjDir)
     {
-        std::string filePath = filesToProcess.front();
-        SourceFile file(filePath);
-        filesToProcess.pop();
-
-        includeDirs.push_back(file.GetSrcDir());
-        for (auto incbin : file.GetIncbins())
+        // Each root is scanned on its own, so roots can be spread across
+        // threads. The cache and resolver are shared between them.
+        std::atomic<int> nextRoot{0};
+        std::vector<std::thread> threads;
+        auto worker = [&]()
         {
-            dependencies.insert(incbin);
-        }
-        for (auto include : file.GetIncludes())
-        {
-            bool exists = false;
-            std::string path("");
-            for (auto includeDir : includeDirs)
-            {
-                path = includeDir + include;
-                if (CanOpenFile(path))
-                {
-                    exists = true;
-                    break;
-                }
-            }
-            if (!exists && (file.FileType() == SourceFileType::Asm || file.FileType() == SourceFileType::Inc))
+            int i;
+            while ((i = nextRoot++) < argc)
             {
-                path = include;
-            }
-            bool inserted = dependencies.insert(path).second;
-            if (inserted && exists)
-            {
-                filesToProcess.push(path);
+                std::string sourcePath(argv[i]);
+                WriteDepFile(objDir, sourcePath, ScanDependencies(sourcePath, resolver, cache));
             }
+        };
+
+        for (int i = 1; i < numThreads && i < argc; i++)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    else
+    {
+        for (const std::string &path : ScanDependencies(std::string(argv[0]), resolver, cache))
+        {
+            std::printf("%s\n", path.c_str());
         }
-        includeDirs.pop_back();
     }
 
-    for (const std::string &path : dependencies)
+    if (!cachePath.empty())
+        cache.Save(cachePath);
+
+    if (printStats)
     {
-        std::printf("%s\n", path.c_str());
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+        std::fprintf(stderr, "scaninc: %d roots, %d files lexed, %d scan cache hits, "
+                             "%d includes resolved, %d resolution memo hits, %.1f ms\n",
+                     argc, cache.GetNumLexed(), cache.GetNumHits(),
+                     resolver.GetNumResolved(), resolver.GetNumMemoHits(), elapsed.count());
     }
 }
@@ -22,7 +22,7 @@
 #include "source_file.h"
 
 
-SourceFileType GetFileType(std::string& path)
+SourceFileType GetFileType(const std::string& path)
 {
     std::size_t pos = path.find_last_of('.');
 
@@ -46,7 +46,7 @@ SourceFileType GetFileType(std::string& path)
     return SourceFileType::Cpp;
 }
 
-std::string GetDir(std::string& path)
+std::string GetDir(const std::string& path)
 {
     std::size_t slash = path.rfind('/');
 
@@ -34,7 +34,8 @@ enum class SourceFileType
     Inc
 };
 
-SourceFileType GetFileType(std::string& path);
+SourceFileType GetFileType(const std::string& path);
+std::string GetDir(const std::string& path);
 
 class SourceFile
 {